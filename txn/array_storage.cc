@@ -0,0 +1,154 @@
+// Flat-array storage backends for dense integer keyspaces.
+
+#include "txn/array_storage.h"
+
+#include <new>
+
+ArrayStorage::ArrayStorage(uint64 size, const vector<cpu_set_t>& affinity)
+    : size_(size) {
+  void* memory;
+  size_t alignment = affinity.empty() ? CACHE_LINE_SIZE : PartitionAlignment();
+  if (posix_memalign(&memory, alignment, size_ * sizeof(Record)) != 0)
+    DIE("Out of memory allocating " << size_ << " records.");
+
+  RunPartitioned(affinity, size_, sizeof(Record), _initRecords, memory);
+  records_ = reinterpret_cast<Record*>(memory);
+  dense_keys_ = size_;
+}
+
+void ArrayStorage::_initRecords(void* records, uint64 begin, uint64 end) {
+  for (uint64 i = begin; i < end; i++) {
+    Record* record = new (&reinterpret_cast<Record*>(records)[i]) Record();
+    record->value_ = 0;
+    record->version_ = 0;
+  }
+}
+
+ArrayStorage::~ArrayStorage() {
+  for (uint64 i = 0; i < size_; i++) {
+    records_[i].~Record();
+  }
+  free(records_);
+}
+
+bool ArrayStorage::Read(Key key, Value* result, uint64 txn_unique_id) {
+  if (key >= size_)
+    return Storage::Read(key, result, txn_unique_id);
+
+  Record* record = &records_[key];
+  if (record->version_.load(std::memory_order_acquire) == 0)
+    return false;
+  *result = record->value_;
+  return true;
+}
+
+bool ArrayStorage::ReadVersion(Key key, Value* result, uint64* version) {
+  if (key >= size_)
+    return Storage::ReadVersion(key, result, version);
+
+  Record* record = &records_[key];
+  *version = record->version_.load(std::memory_order_acquire);
+  if (*version == 0)
+    return false;
+  *result = record->value_;
+  return true;
+}
+
+void ArrayStorage::Write(Key key, Value value, uint64 txn_unique_id) {
+  if (key >= size_) {
+    Storage::Write(key, value, txn_unique_id);
+    return;
+  }
+
+  // Writers of a key are serialized by the CC scheme, so the version needs
+  // no read-modify-write; releasing it publishes the value.
+  Record* record = &records_[key];
+  record->value_ = value;
+  record->version_.store(record->version_.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_release);
+}
+
+uint64 ArrayStorage::RecordVersion(Key key) {
+  if (key >= size_)
+    return Storage::RecordVersion(key);
+  return records_[key].version_.load(std::memory_order_acquire);
+}
+
+void ArrayStorage::InitStorage() {
+  for (Key key = 0; key < INIT_STORAGE_SIZE; key++) {
+    if (key < size_) {
+      records_[key].value_ = 0;
+      records_[key].version_ = 1;
+    } else {
+      Storage::Write(key, 0, 0);
+    }
+  }
+}
+
+void ArrayStorage::BulkLoad(const KeyValue* records, uint64 count) {
+  for (uint64 i = 0; i < count; i++) {
+    if (records[i].key_ < size_) {
+      records_[records[i].key_].value_ = records[i].value_;
+      records_[records[i].key_].version_ = 1;
+    } else {
+      Storage::Write(records[i].key_, records[i].value_, 0);
+    }
+  }
+}
+
+void ArrayStorage::Snapshot(vector<KeyValue>* records, uint64 txn_unique_id) {
+  for (uint64 i = 0; i < size_; i++) {
+    if (records_[i].version_.load() != 0) {
+      KeyValue record = {i, records_[i].value_};
+      records->push_back(record);
+    }
+  }
+  Storage::Snapshot(records, txn_unique_id);
+}
+
+void ArrayStorage::Lock(Key key) {
+  if (key < size_)
+    records_[key].latch_.Lock();
+}
+
+void ArrayStorage::Unlock(Key key) {
+  if (key < size_)
+    records_[key].latch_.Unlock();
+}
+
+MVCCArrayStorage::MVCCArrayStorage(uint64 size,
+                                   const vector<cpu_set_t>& affinity) {
+  dense_data_ = _newVersionLists(size, affinity);
+  dense_size_ = size;
+  dense_keys_ = size;
+}
+
+void MVCCArrayStorage::InitStorage() {
+  for (Key key = 0; key < INIT_STORAGE_SIZE; key++) {
+    if (key < dense_size_)
+      _initVersion(key, 0);
+    else
+      Write(key, 0, 0);
+  }
+}
+
+void MVCCArrayStorage::BulkLoad(const KeyValue* records, uint64 count) {
+  for (uint64 i = 0; i < count; i++) {
+    if (records[i].key_ < dense_size_)
+      _initVersion(records[i].key_, records[i].value_);
+    else
+      Write(records[i].key_, records[i].value_, 0);
+  }
+}
+
+void MVCCArrayStorage::_initVersion(Key key, Value value) {
+  // The list is still empty, so there is nothing to search.
+  Version* version = new Version();
+  version->value_ = value;
+  version->delta_ = false;
+  version->version_id_ = 0;
+  version->max_read_id_ = 0;
+  version->pending_ = false;
+  version->next_ = NULL;
+  dense_data_[key].head_.store(version, std::memory_order_relaxed);
+}
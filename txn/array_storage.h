@@ -0,0 +1,87 @@
+// Storage backends for dense integer keyspaces.
+//
+// Keys [0, size) live in one contiguous, cache-line-aligned array of
+// records, so a lookup is an index instead of a hash probe and everything
+// the CC schemes need for one key (value, timestamp or version list head,
+// latch) sits in a single cache line. All other keys fall back to the
+// hash maps of the base class.
+
+#ifndef _ARRAY_STORAGE_H_
+#define _ARRAY_STORAGE_H_
+
+#include <atomic>
+
+#include "txn/mvcc_storage.h"
+#include "txn/storage.h"
+#include "utils/cpu_affinity.h"
+#include "utils/mutex.h"
+
+// Single-version storage (all modes except MVCC).
+class ArrayStorage : public Storage {
+ public:
+  // Allocates (but does not initialize) records for keys [0, size). With a
+  // non-empty 'affinity' the array is split into one partition per entry,
+  // each placed on the NUMA node of the CPUs in that entry.
+  explicit ArrayStorage(
+      uint64 size = INIT_STORAGE_SIZE,
+      const vector<cpu_set_t>& affinity = vector<cpu_set_t>());
+  virtual ~ArrayStorage();
+
+  virtual bool Read(Key key, Value* result, uint64 txn_unique_id = 0);
+  virtual void Write(Key key, Value value, uint64 txn_unique_id = 0);
+  virtual uint64 RecordVersion(Key key);
+  virtual bool ReadVersion(Key key, Value* result, uint64* version);
+  virtual void Prefetch(Key key) {
+    if (key < size_)
+      __builtin_prefetch(&records_[key]);
+  }
+
+  // Creates records 0 to INIT_STORAGE_SIZE - 1 in one pass, all at version 1.
+  virtual void InitStorage();
+
+  virtual void BulkLoad(const KeyValue* records, uint64 count);
+  virtual void Snapshot(vector<KeyValue>* records, uint64 txn_unique_id);
+
+  // Latch the record for key. Keys outside the array are not latched.
+  virtual void Lock(Key key);
+  virtual void Unlock(Key key);
+
+ private:
+  // Constructs records [begin, end) of the array 'records'.
+  static void _initRecords(void* records, uint64 begin, uint64 end);
+
+  struct Record {
+    Value value_;
+    // Bumped after each write, 0 if the record doesn't exist. Atomic since
+    // OCC reads and validates it while other threads write.
+    std::atomic<uint64> version_;
+    Mutex latch_;
+  } __attribute__((aligned(CACHE_LINE_SIZE)));
+
+  Record* records_;
+  uint64 size_;
+};
+
+// Multi-version storage. The per-key VersionList (head pointer, install
+// sequence and latch) is stored in the array, and all version list logic is
+// inherited from MVCCStorage.
+class MVCCArrayStorage : public MVCCStorage {
+ public:
+  // Allocates empty version lists for keys [0, size), partitioned across
+  // NUMA nodes like ArrayStorage.
+  explicit MVCCArrayStorage(
+      uint64 size = INIT_STORAGE_SIZE,
+      const vector<cpu_set_t>& affinity = vector<cpu_set_t>());
+
+  // Creates records 0 to INIT_STORAGE_SIZE - 1 in one pass.
+  virtual void InitStorage();
+
+  virtual void BulkLoad(const KeyValue* records, uint64 count);
+
+ private:
+  // Installs the first version of a key in the array, whose list must still
+  // be empty.
+  void _initVersion(Key key, Value value);
+};
+
+#endif  // _ARRAY_STORAGE_H_
@@ -0,0 +1,129 @@
+#include "txn/array_storage.h"
+
+#include "utils/testing.h"
+
+TEST(ArrayStorage_ReadWrite) {
+  ArrayStorage storage(100);
+  Value result;
+
+  // Nothing exists before the first write, in the array or outside it.
+  EXPECT_FALSE(storage.Read(5, &result));
+  EXPECT_FALSE(storage.Read(500, &result));
+  EXPECT_EQ(0, storage.RecordVersion(5));
+
+  storage.Write(5, 42);
+  storage.Write(500, 43);
+  EXPECT_TRUE(storage.Read(5, &result));
+  EXPECT_EQ(42, result);
+  EXPECT_TRUE(storage.Read(500, &result));
+  EXPECT_EQ(43, result);
+  EXPECT_EQ(1, storage.RecordVersion(5));
+  EXPECT_EQ(1, storage.RecordVersion(500));
+
+  // Every write bumps the version, and ReadVersion returns both.
+  storage.Write(5, 44);
+  uint64 version;
+  EXPECT_TRUE(storage.ReadVersion(5, &result, &version));
+  EXPECT_EQ(44, result);
+  EXPECT_EQ(2, version);
+  EXPECT_FALSE(storage.ReadVersion(6, &result, &version));
+  EXPECT_EQ(0, version);
+
+  END;
+}
+
+TEST(MVCCArrayStorage_ReadWrite) {
+  MVCCArrayStorage storage(100);
+  Value result;
+
+  EXPECT_FALSE(storage.Read(5, &result, 10));
+
+  // Keys inside and outside the array keep a sorted version list each.
+  storage.Write(5, 1, 1);
+  storage.Write(5, 3, 3);
+  storage.Write(500, 1, 1);
+  storage.Write(500, 3, 3);
+
+  EXPECT_TRUE(storage.Read(5, &result, 2));
+  EXPECT_EQ(1, result);
+  EXPECT_TRUE(storage.Read(5, &result, 3));
+  EXPECT_EQ(3, result);
+  EXPECT_TRUE(storage.Read(500, &result, 2));
+  EXPECT_EQ(1, result);
+
+  // Txn 2 read version 1, so txn 1 may not write after it.
+  storage.Lock(5);
+  EXPECT_FALSE(storage.CheckWrite(5, 1));
+  storage.Unlock(5);
+
+  GCStats stats;
+  storage.GetGCStats(&stats);
+  EXPECT_EQ(2, stats.chain_length_max_);
+
+  END;
+}
+
+TEST(ArrayStorage_Partitioned) {
+  // Three partitions, each built by a thread pinned to CPU 0. 1000 records
+  // don't split evenly into pages, so the last partition takes the rest.
+  vector<cpu_set_t> affinity(3, SingleCpu(0));
+  ArrayStorage storage(1000, affinity);
+  MVCCArrayStorage mvcc_storage(1000, affinity);
+  Value result;
+
+  for (Key key = 0; key < 1000; key++) {
+    EXPECT_FALSE(storage.Read(key, &result));
+    EXPECT_FALSE(mvcc_storage.Read(key, &result, 1));
+  }
+
+  storage.Write(999, 7);
+  mvcc_storage.Write(999, 7, 1);
+  EXPECT_TRUE(storage.Read(999, &result));
+  EXPECT_EQ(7, result);
+  EXPECT_TRUE(mvcc_storage.Read(999, &result, 1));
+  EXPECT_EQ(7, result);
+
+  END;
+}
+
+TEST(ArrayStorage_SeekKeys) {
+  ArrayStorage storage(100);
+  MVCCArrayStorage mvcc_storage(100);
+  storage.Write(500, 1);
+  storage.Write(300, 1);
+  storage.Write(120, 1);
+  mvcc_storage.Write(300, 1, 1);
+
+  // Every key of the array is visited, then the keys outside it that have
+  // records, in order.
+  KeyCursor cursor;
+  Key key;
+  storage.SeekKeys(97, 400, &cursor);
+  Key expected[] = {97, 98, 99, 120, 300};
+  for (int i = 0; i < 5; i++) {
+    EXPECT_TRUE(cursor.Next(&key));
+    EXPECT_EQ(expected[i], key);
+  }
+  EXPECT_FALSE(cursor.Next(&key));
+
+  storage.SeekKeys(200, 500, &cursor);
+  EXPECT_TRUE(cursor.Next(&key));
+  EXPECT_EQ(300, key);
+  EXPECT_FALSE(cursor.Next(&key));
+
+  mvcc_storage.SeekKeys(99, 1000, &cursor);
+  EXPECT_TRUE(cursor.Next(&key));
+  EXPECT_EQ(99, key);
+  EXPECT_TRUE(cursor.Next(&key));
+  EXPECT_EQ(300, key);
+  EXPECT_FALSE(cursor.Next(&key));
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  ArrayStorage_ReadWrite();
+  MVCCArrayStorage_ReadWrite();
+  ArrayStorage_Partitioned();
+  ArrayStorage_SeekKeys();
+}
@@ -0,0 +1,109 @@
+#include "txn/checkpoint.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+static bool KeyLess(const KeyValue& a, const KeyValue& b) {
+  return a.key_ < b.key_;
+}
+
+// Returns the checksum of the fields of 'header' other than checksum_, to
+// be continued over the records.
+static uint32 HeaderChecksum(const CheckpointHeader& header) {
+  uint32 checksum = Checksum(&header.magic_, sizeof(header.magic_));
+  checksum = Checksum(&header.record_count_, sizeof(header.record_count_),
+                      checksum);
+  checksum = Checksum(&header.log_lsn_, sizeof(header.log_lsn_), checksum);
+  return Checksum(&header.snapshot_id_, sizeof(header.snapshot_id_), checksum);
+}
+
+// Writes 'size' bytes at 'data' to 'fd'.
+static void WriteAll(int fd, const void* data, size_t size) {
+  const char* bytes = reinterpret_cast<const char*>(data);
+  size_t written = 0;
+  while (written < size) {
+    ssize_t n = write(fd, bytes + written, size - written);
+    if (n < 0 && errno != EINTR)
+      DIE("Checkpoint write failed: " << strerror(errno));
+    if (n > 0)
+      written += n;
+  }
+}
+
+void WriteCheckpoint(const string& path, LSN log_lsn, uint64 snapshot_id,
+                     vector<KeyValue>* records) {
+  std::sort(records->begin(), records->end(), KeyLess);
+
+  CheckpointHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic_ = CHECKPOINT_MAGIC;
+  header.record_count_ = records->size();
+  header.log_lsn_ = log_lsn;
+  header.snapshot_id_ = snapshot_id;
+  header.checksum_ = Checksum(records->empty() ? NULL : &(*records)[0],
+                              records->size() * sizeof(KeyValue),
+                              HeaderChecksum(header));
+
+  string temp_path = path + ".tmp";
+  int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    DIE("Cannot create checkpoint " << temp_path << ": " << strerror(errno));
+  WriteAll(fd, &header, sizeof(header));
+  if (!records->empty())
+    WriteAll(fd, &(*records)[0], records->size() * sizeof(KeyValue));
+  if (fsync(fd) != 0)
+    DIE("Checkpoint sync failed: " << strerror(errno));
+  close(fd);
+
+  if (rename(temp_path.c_str(), path.c_str()) != 0)
+    DIE("Cannot rename checkpoint to " << path << ": " << strerror(errno));
+
+  // Make the rename itself durable.
+  size_t slash = path.rfind('/');
+  string dir = slash == string::npos ? "." : path.substr(0, slash + 1);
+  int dir_fd = open(dir.c_str(), O_RDONLY);
+  if (dir_fd >= 0) {
+    fsync(dir_fd);
+    close(dir_fd);
+  }
+}
+
+MappedCheckpoint::~MappedCheckpoint() {
+  if (data_ != NULL)
+    munmap(data_, size_);
+}
+
+bool MappedCheckpoint::Open(const string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0 && errno == ENOENT)
+    return false;
+  if (fd < 0)
+    DIE("Cannot open checkpoint " << path << ": " << strerror(errno));
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    DIE("Cannot stat checkpoint " << path << ": " << strerror(errno));
+  if (static_cast<size_t>(st.st_size) < sizeof(CheckpointHeader))
+    DIE("Checkpoint " << path << " is truncated.");
+
+  size_ = st.st_size;
+  data_ = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data_ == MAP_FAILED) {
+    data_ = NULL;
+    DIE("Cannot map checkpoint " << path << ": " << strerror(errno));
+  }
+
+  const CheckpointHeader& header = Header();
+  size_t records_size = header.record_count_ * sizeof(KeyValue);
+  if (header.magic_ != CHECKPOINT_MAGIC ||
+      size_ != sizeof(CheckpointHeader) + records_size ||
+      header.checksum_ !=
+          Checksum(Records(), records_size, HeaderChecksum(header)))
+    DIE("Checkpoint " << path << " is corrupt.");
+  return true;
+}
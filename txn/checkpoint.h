@@ -0,0 +1,68 @@
+// Checkpoints: consistent snapshots of a TxnProcessor's records on disk,
+// from which it recovers together with the tail of its redo log.
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <string>
+#include <vector>
+
+#include "txn/common.h"
+#include "txn/log.h"
+
+using std::string;
+using std::vector;
+
+// "CHCKPNT1"
+#define CHECKPOINT_MAGIC 0x31544e504b434843ULL
+
+// Header of a checkpoint file. It is followed by 'record_count_' KeyValues
+// sorted by key, so the file can be mapped and its records used in place.
+struct CheckpointHeader {
+  uint64 magic_;
+  uint64 record_count_;
+
+  // The checkpoint reflects every log record before 'log_lsn_', and every
+  // later one of a txn whose unique_id is below 'snapshot_id_'.
+  LSN log_lsn_;
+  uint64 snapshot_id_;
+
+  uint32 checksum_;  // Checksum of the fields above and of the records
+  uint32 unused_;
+};
+
+// Sorts 'records' and writes them to a checkpoint at 'path'. The checkpoint
+// is written next to 'path' and synced before it replaces any previous one,
+// so a crash leaves either the old or the new checkpoint behind.
+void WriteCheckpoint(const string& path, LSN log_lsn, uint64 snapshot_id,
+                     vector<KeyValue>* records);
+
+// Read-only mapping of a checkpoint file.
+class MappedCheckpoint {
+ public:
+  MappedCheckpoint() : data_(NULL), size_(0) {}
+  ~MappedCheckpoint();
+
+  // Maps the checkpoint at 'path'. Returns false if there is none, and dies
+  // if it is corrupt.
+  bool Open(const string& path);
+
+  const CheckpointHeader& Header() const {
+    return *reinterpret_cast<const CheckpointHeader*>(data_);
+  }
+
+  const KeyValue* Records() const {
+    return reinterpret_cast<const KeyValue*>(
+        reinterpret_cast<const char*>(data_) + sizeof(CheckpointHeader));
+  }
+
+ private:
+  void* data_;
+  size_t size_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  MappedCheckpoint(const MappedCheckpoint&);
+  MappedCheckpoint& operator=(const MappedCheckpoint&);
+};
+
+#endif  // _CHECKPOINT_H_
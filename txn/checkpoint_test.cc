@@ -0,0 +1,44 @@
+#include "txn/checkpoint.h"
+
+#include <unistd.h>
+
+#include "utils/testing.h"
+
+TEST(Checkpoint_WriteAndMap) {
+  string path = "/tmp/checkpoint_test.ckpt";
+  unlink(path.c_str());
+
+  MappedCheckpoint missing;
+  EXPECT_FALSE(missing.Open(path));
+
+  vector<KeyValue> records;
+  for (Key key = 10; key > 0; key--) {
+    KeyValue record = {key, key * 100};
+    records.push_back(record);
+  }
+  WriteCheckpoint(path, 1234, 56, &records);
+
+  // The records were sorted in place. Replaces the first checkpoint.
+  records.resize(5);
+  WriteCheckpoint(path, 4321, 65, &records);
+
+  MappedCheckpoint checkpoint;
+  EXPECT_TRUE(checkpoint.Open(path));
+  EXPECT_EQ(5, checkpoint.Header().record_count_);
+  EXPECT_EQ(4321, checkpoint.Header().log_lsn_);
+  EXPECT_EQ(65, checkpoint.Header().snapshot_id_);
+
+  // Records are in key order.
+  for (Key i = 0; i < 5; i++) {
+    EXPECT_EQ(1 + i, checkpoint.Records()[i].key_);
+    EXPECT_EQ((1 + i) * 100, checkpoint.Records()[i].value_);
+  }
+
+  unlink(path.c_str());
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  Checkpoint_WriteAndMap();
+}
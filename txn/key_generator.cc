@@ -0,0 +1,55 @@
+#include "txn/key_generator.h"
+
+#include <math.h>
+
+#include "utils/random.h"
+
+// Returns a random double in [0, 1).
+static inline double RandomFraction() {
+  return ThreadRandom()->NextDouble();
+}
+
+Key UniformKeys::Next() {
+  return ThreadRandom()->Uniform(size_);
+}
+
+ZipfianKeys::ZipfianKeys(uint64 size, double theta)
+    : KeyGenerator(size), theta_(theta) {
+  if (size < 2 || theta <= 0 || theta >= 1)
+    DIE("ZipfianKeys needs at least 2 keys and a theta in (0, 1).");
+  zeta_ = 0;
+  for (uint64 i = 1; i <= size; i++)
+    zeta_ += 1 / pow(i, theta);
+  double zeta2 = 1 + 1 / pow(2, theta);
+  alpha_ = 1 / (1 - theta);
+  eta_ = (1 - pow(2.0 / size, 1 - theta)) / (1 - zeta2 / zeta_);
+  half_pow_theta_ = pow(0.5, theta);
+}
+
+Key ZipfianKeys::Next() {
+  double u = RandomFraction();
+  double uz = u * zeta_;
+  if (uz < 1)
+    return 0;
+  if (uz < 1 + half_pow_theta_)
+    return 1;
+  Key key = static_cast<Key>(size_ * pow(eta_ * u - eta_ + 1, alpha_));
+  return key < size_ ? key : size_ - 1;
+}
+
+HotspotKeys::HotspotKeys(uint64 size, double hot_fraction,
+                         double hot_probability)
+    : KeyGenerator(size), hot_probability_(hot_probability) {
+  hot_size_ = static_cast<uint64>(size * hot_fraction);
+  if (hot_size_ < 1)
+    hot_size_ = 1;
+  if (hot_size_ >= size)
+    DIE("HotspotKeys needs a hot set smaller than the keyspace.");
+}
+
+Key HotspotKeys::Next() {
+  if (RandomFraction() < hot_probability_)
+    return static_cast<uint64>(RandomFraction() * hot_size_);
+  return hot_size_ +
+         static_cast<uint64>(RandomFraction() * (size_ - hot_size_));
+}
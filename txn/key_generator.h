@@ -0,0 +1,60 @@
+// Key distributions for generated workloads.
+
+#ifndef _KEY_GENERATOR_H_
+#define _KEY_GENERATOR_H_
+
+#include "txn/common.h"
+
+// Picks keys from [0, Size()) according to some distribution.
+class KeyGenerator {
+ public:
+  explicit KeyGenerator(uint64 size) : size_(size) {}
+  virtual ~KeyGenerator() {}
+
+  virtual Key Next() = 0;
+
+  uint64 Size() const { return size_; }
+
+ protected:
+  uint64 size_;
+};
+
+// Every key equally likely.
+class UniformKeys : public KeyGenerator {
+ public:
+  explicit UniformKeys(uint64 size) : KeyGenerator(size) {}
+  virtual Key Next();
+};
+
+// Key k (counting from 0) is picked with probability proportional to
+// 1 / (k + 1)^theta, so key 0 is the hottest. 'theta' must be in (0, 1);
+// YCSB uses 0.99. Uses the method of Gray et al., "Quickly Generating
+// Billion-Record Synthetic Databases" (SIGMOD '94), which takes O(1) per key
+// after an O(size) setup.
+class ZipfianKeys : public KeyGenerator {
+ public:
+  ZipfianKeys(uint64 size, double theta);
+  virtual Key Next();
+
+ private:
+  double theta_;
+  double zeta_;   // Sum of 1 / i^theta for i in [1, size]
+  double alpha_;
+  double eta_;
+  double half_pow_theta_;
+};
+
+// A fraction 'hot_probability' of the picks go to the first
+// 'hot_fraction' of the keys, the rest to the others, uniformly within
+// each set.
+class HotspotKeys : public KeyGenerator {
+ public:
+  HotspotKeys(uint64 size, double hot_fraction, double hot_probability);
+  virtual Key Next();
+
+ private:
+  uint64 hot_size_;
+  double hot_probability_;
+};
+
+#endif  // _KEY_GENERATOR_H_
@@ -0,0 +1,63 @@
+#include "txn/key_generator.h"
+
+#include <vector>
+
+#include "utils/testing.h"
+
+using std::vector;
+
+// Returns how often each key of 'keys' came up in 'picks' picks.
+static vector<int> Histogram(KeyGenerator* keys, int picks) {
+  vector<int> counts(keys->Size(), 0);
+  for (int i = 0; i < picks; i++) {
+    Key key = keys->Next();
+    EXPECT_TRUE(key < keys->Size());
+    if (key < keys->Size())
+      counts[key]++;
+  }
+  return counts;
+}
+
+TEST(KeyGenerator_Uniform) {
+  UniformKeys keys(10);
+  vector<int> counts = Histogram(&keys, 100000);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_TRUE(counts[i] > 9000);
+    EXPECT_TRUE(counts[i] < 11000);
+  }
+
+  END;
+}
+
+TEST(KeyGenerator_Zipfian) {
+  ZipfianKeys keys(1000, 0.99);
+  vector<int> counts = Histogram(&keys, 100000);
+
+  // With theta close to 1, key k comes up about 1/(k+1) times as often as
+  // key 0, which gets about 13% of the picks here.
+  EXPECT_TRUE(counts[0] > 11000);
+  EXPECT_TRUE(counts[0] < 16000);
+  EXPECT_TRUE(counts[0] > counts[1]);
+  EXPECT_TRUE(counts[1] > counts[10]);
+  EXPECT_TRUE(counts[10] > counts[999]);
+
+  END;
+}
+
+TEST(KeyGenerator_Hotspot) {
+  HotspotKeys keys(1000, 0.01, 0.9);
+  vector<int> counts = Histogram(&keys, 100000);
+  int hot = 0;
+  for (int i = 0; i < 10; i++)
+    hot += counts[i];
+  EXPECT_TRUE(hot > 89000);
+  EXPECT_TRUE(hot < 91000);
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  KeyGenerator_Uniform();
+  KeyGenerator_Zipfian();
+  KeyGenerator_Hotspot();
+}
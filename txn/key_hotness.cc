@@ -0,0 +1,22 @@
+#include "txn/key_hotness.h"
+
+#include <string.h>
+
+KeyHotness::KeyHotness(int slots, uint32 threshold)
+    : slot_count_(slots), shift_(64), threshold_(threshold) {
+  if (slots < 2 || (slots & (slots - 1)) != 0)
+    DIE("KeyHotness needs a power of two of slots, at least 2.");
+  for (int s = slots; s > 1; s >>= 1)
+    shift_--;
+  counts_ = new uint32[slot_count_];
+  memset(counts_, 0, slot_count_ * sizeof(counts_[0]));
+}
+
+KeyHotness::~KeyHotness() {
+  delete[] counts_;
+}
+
+void KeyHotness::Decay() {
+  for (int i = 0; i < slot_count_; i++)
+    counts_[i] >>= 1;
+}
@@ -0,0 +1,43 @@
+// Online estimate of which keys txns keep conflicting on.
+
+#ifndef _KEY_HOTNESS_H_
+#define _KEY_HOTNESS_H_
+
+#include "txn/common.h"
+
+// Conflict counters for a fixed number of slots, each key hashed to one
+// slot (so a cold key rarely shares a slot with a hot one as long as hot
+// keys are few). Decay() halves every counter, so a key only stays hot
+// while it keeps causing conflicts. Not thread-safe.
+class KeyHotness {
+ public:
+  // 'slots' must be a power of two, at least 2. A key is hot once its slot
+  // has counted 'threshold' conflicts.
+  KeyHotness(int slots, uint32 threshold);
+  ~KeyHotness();
+
+  // Counts one conflict on 'key'.
+  void Touch(Key key) { counts_[Slot(key)]++; }
+
+  uint32 Count(Key key) const { return counts_[Slot(key)]; }
+  bool Hot(Key key) const { return counts_[Slot(key)] >= threshold_; }
+
+  // Halves every counter. Takes time proportional to the number of slots.
+  void Decay();
+
+ private:
+  int Slot(Key key) const {
+    return (key * 0x9e3779b97f4a7c15ULL) >> shift_;
+  }
+
+  uint32* counts_;
+  int slot_count_;
+  int shift_;
+  uint32 threshold_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  KeyHotness(const KeyHotness&);
+  KeyHotness& operator=(const KeyHotness&);
+};
+
+#endif  // _KEY_HOTNESS_H_
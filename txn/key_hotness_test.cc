@@ -0,0 +1,31 @@
+#include "txn/key_hotness.h"
+
+#include "utils/testing.h"
+
+TEST(KeyHotness_TouchAndDecay) {
+  KeyHotness hotness(1024, 4);
+  for (int i = 0; i < 3; i++)
+    hotness.Touch(7);
+  EXPECT_FALSE(hotness.Hot(7));
+  hotness.Touch(7);
+  EXPECT_TRUE(hotness.Hot(7));
+  EXPECT_EQ(4, hotness.Count(7));
+
+  // Consecutive keys land in different slots.
+  for (Key key = 100; key < 110; key++)
+    EXPECT_FALSE(hotness.Hot(key));
+
+  // A key cools down once its conflicts stop.
+  hotness.Decay();
+  EXPECT_EQ(2, hotness.Count(7));
+  EXPECT_FALSE(hotness.Hot(7));
+  hotness.Decay();
+  hotness.Decay();
+  EXPECT_EQ(0, hotness.Count(7));
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  KeyHotness_TouchAndDecay();
+}
@@ -1,199 +1,484 @@
-// Author: Alexander Thomson (thomson@cs.yale.edu)
-// Modified by: Kun Ren (kun.ren@yale.edu)
-//
-// Lock manager implementing deterministic two-phase locking as described in
-// 'The Case for Determinism in Database Systems'.
-
-#include <deque>
-
-#include "txn/lock_manager.h"
-
-using std::deque;
-
-LockManager::~LockManager() {
-  // Cleanup lock_table_
-  for (auto it = lock_table_.begin(); it != lock_table_.end(); it++) {
-    delete it->second;
-  }
-}
-
-deque<LockManager::LockRequest>* LockManager::_getLockQueue(const Key& key) {
-  deque<LockRequest> *dq = lock_table_[key];
-  if (!dq) {
-    dq = new deque<LockRequest>();
-    lock_table_[key] = dq;
-  }
-  return dq;
-}
-
-LockManagerA::LockManagerA(deque<Txn*>* ready_txns) {
-  ready_txns_ = ready_txns;
-}
-
-bool LockManagerA::WriteLock(Txn* txn, const Key& key) {
-  // New lock request (set as EXCLUSIVE) for the transaction
-  LockRequest lockreq(EXCLUSIVE, txn);
-
-  // If the lock queue for the current element is empty, then create a new lock request deque
-  // If not then push the lock into the last element of the deque
-  if (lock_table_[key]){
-    lock_table_[key]->push_back(lockreq);
-  } else {
-    deque<LockRequest> *tempdeque = new deque<LockRequest>(1, lockreq);
-    lock_table_[key] = tempdeque;
-  }
-
-  // If the lock table size is 1, then the write is successful
-  // Else the transaction needs to wait longer to be served
-  if(lock_table_[key]->size() == 1){
-    return true;
-  }
-  txn_waits_[txn]++;
-  return false;
-}
-
-bool LockManagerA::ReadLock(Txn* txn, const Key& key) {
-  // Since Part 1A implements ONLY exclusive locks, calls to ReadLock can
-  // simply use the same logic as 'WriteLock'.
-  return WriteLock(txn, key);
-}
-
-void LockManagerA::Release(Txn* txn, const Key& key) {
-  // Add the deque for the requested resource
-  // Assume that the unlock has happened (deleteHappened)
-  deque<LockRequest> *tempQueue = lock_table_[key];
-  bool deleteHappened = true;
-
-  // Loop the deque from the beginning until the end
-  // If the transaction is still in the queue
-  // Delete the transaction from the lock request deque
-  // Delete happened for the current transaction if the transaction is at the front
-  //  of the deque (first element of the lock request deque)
-  for (deque<LockRequest>::iterator itr = tempQueue->begin(); itr < tempQueue->end(); ++itr) {
-    if (itr->txn_ == txn) { 
-        tempQueue->erase(itr);
-        break;
-    }
-    deleteHappened = false;
-  }
-
-  // If the deque is still not empty after the deletion of the transaction
-  // The next transaction is set as the first element of the deque and reduce the wait time
-  // If the transaction wait time for the next transaction is 0 => next transaction is served
-  if (!(tempQueue->size() < 1) && deleteHappened) {
-    Txn *next_transaction = tempQueue->front().txn_;
-    txn_waits_[next_transaction]--;
-
-    if (txn_waits_[next_transaction] <= 0) {
-        ready_txns_->push_back(next_transaction);
-        txn_waits_.erase(next_transaction);
-    }
-  }
-}
-
-LockMode LockManagerA::Status(const Key& key, vector<Txn*>* owners) {
-  // Checking if the lock request queue for certain resource is 0
-  // If it is, then the resource is UNLOCKED => return
-  deque<LockRequest> *tempQueue = lock_table_[key];
-  if (!tempQueue->size()) {
-    return UNLOCKED;
-  }
-
-  // If not, then set the clear current owners
-  // Change the owner with the transaction at the front of the lock request queue
-  // EXCLUSIVE => return
-  owners->clear();
-  owners->push_back(tempQueue->front().txn_);
-  return EXCLUSIVE;
-}
-
-LockManagerB::LockManagerB(deque<Txn*>* ready_txns) {
-  ready_txns_ = ready_txns;
-}
-
-bool LockManagerB::_addLock(LockMode mode, Txn* txn, const Key& key) {
-  LockRequest rq(mode, txn);
-  LockMode status = Status(key, nullptr);
-
-  deque<LockRequest> *dq = _getLockQueue(key);
-  dq->push_back(rq);
-
-  bool granted = status == UNLOCKED;
-  if (mode == SHARED) {
-    granted |= _noExclusiveWaiting(key);
-  } else {
-    _numExclusiveWaiting[key]++;
-  }
-
-  if (!granted)
-    txn_waits_[txn]++;
-
-  return granted;
-}
-
-
-bool LockManagerB::WriteLock(Txn* txn, const Key& key) {
-  return _addLock(EXCLUSIVE, txn, key);
-}
-
-bool LockManagerB::ReadLock(Txn* txn, const Key& key) {
-  return _addLock(SHARED, txn, key);
-}
-
-void LockManagerB::Release(Txn* txn, const Key& key) {
-  deque<LockRequest> *queue = _getLockQueue(key);
-
-  for (auto it = queue->begin(); it < queue->end(); it++) {
-    if (it->txn_ == txn) {
-      queue->erase(it);
-      if (it->mode_ == EXCLUSIVE) {
-        _numExclusiveWaiting[key]--;
-      }
-
-      break;
-    }
-  }
-
-  // Advance the lock, by making new owners ready.
-  // Some in newOwners already own the lock.  These are not in
-  // txn_waits_.
-  vector<Txn*> newOwners;
-  Status(key, &newOwners);
-
-  for (auto&& owner : newOwners) {
-    auto waitCount = txn_waits_.find(owner);
-    if (waitCount != txn_waits_.end() && --(waitCount->second) == 0) {
-      ready_txns_->push_back(owner);
-      txn_waits_.erase(waitCount);
-    }
-  }
-}
-
-LockMode LockManagerB::Status(const Key& key, vector<Txn*>* owners) {
-  deque<LockRequest> *dq = _getLockQueue(key);
-  if (dq->empty()) {
-    return UNLOCKED;
-  }
-
-  LockMode mode = EXCLUSIVE;
-  vector<Txn*> txn_owners;
-  for (auto&& lockRequest : *dq) {
-    if (lockRequest.mode_ == EXCLUSIVE && mode == SHARED)
-        break;
-
-    txn_owners.push_back(lockRequest.txn_);
-    mode = lockRequest.mode_;
-
-    if (mode == EXCLUSIVE)
-      break;
-  }
-
-  if (owners)
-    *owners = txn_owners;
-
-  return mode;
-}
-
-inline bool LockManagerB::_noExclusiveWaiting(const Key& key) {
-  return _numExclusiveWaiting[key] == 0;
-}
+// Author: Alexander Thomson (thomson@cs.yale.edu)
+// Modified by: Kun Ren (kun.ren@yale.edu)
+//
+// Lock manager implementing deterministic two-phase locking as described in
+// 'The Case for Determinism in Database Systems'.
+
+#include "txn/lock_manager.h"
+#include "txn/txn.h"
+
+bool LockTable::Enqueue(Txn* txn, const Key& key, LockMode mode) {
+  LockQueue* queue = _find(key);
+  if (!queue) {
+    queue = queue_pool_.New();
+    queue->head_ = NULL;
+    queue->tail_ = NULL;
+    queue->num_exclusive_ = 0;
+    queue->num_shared_ = 0;
+    queue->num_increment_ = 0;
+    queue->key_ = key;
+    _insert(queue);
+
+    // Ranges of other txns covering key hold it already.
+    for (LockRequest* range = ranges_; range != NULL; range = range->next_) {
+      if (range->txn_ != txn && range->key_ <= key && key < range->range_end_)
+        _append(queue, range->txn_, key, SHARED);
+    }
+  }
+  return _append(queue, txn, key, mode);
+}
+
+int LockTable::EnqueueRange(Txn* txn, Key lo, Key hi) {
+  LockRequest* range = request_pool_.New();
+  range->txn_ = txn;
+  range->mode_ = SHARED;
+  range->granted_ = true;
+  range->key_ = lo;
+  range->range_end_ = hi;
+  range->queue_ = NULL;
+  range->prev_ = NULL;
+  range->next_ = ranges_;
+  if (ranges_)
+    ranges_->prev_ = range;
+  ranges_ = range;
+  range->next_of_txn_ = txn->lock_requests_;
+  txn->lock_requests_ = range;
+
+  // Keys txn has requests for already are locked strongly enough (its
+  // requests for single keys come first).
+  _queuesIn(lo, hi);
+  int waits = 0;
+  for (size_t i = 0; i < queues_.size(); i++) {
+    LockRequest* request = queues_[i].second->head_;
+    while (request != NULL && request->txn_ != txn)
+      request = request->next_;
+    if (request == NULL &&
+        !_append(queues_[i].second, txn, queues_[i].first, SHARED))
+      waits++;
+  }
+  return waits;
+}
+
+void LockTable::_queuesIn(Key lo, Key hi) {
+  queues_.clear();
+  if (hi - lo <= buckets_.size()) {
+    for (Key key = lo; key < hi; key++) {
+      LockQueue* queue = _find(key);
+      if (queue != NULL)
+        queues_.push_back(std::make_pair(key, queue));
+    }
+  } else {
+    for (size_t i = 0; i < buckets_.size(); i++) {
+      for (LockQueue* queue = buckets_[i]; queue != NULL;
+           queue = queue->next_) {
+        if (lo <= queue->key_ && queue->key_ < hi)
+          queues_.push_back(std::make_pair(queue->key_, queue));
+      }
+    }
+  }
+}
+
+LockQueue* LockTable::_find(Key key) {
+  LockQueue* queue = *_bucket(key);
+  while (queue != NULL && queue->key_ != key)
+    queue = queue->next_;
+  return queue;
+}
+
+void LockTable::_insert(LockQueue* queue) {
+  if (++queue_count_ > buckets_.size()) {
+    // Rehash into twice as many buckets.
+    vector<LockQueue*> old(buckets_.size() * 2, static_cast<LockQueue*>(NULL));
+    old.swap(buckets_);
+    for (size_t i = 0; i < old.size(); i++) {
+      while (old[i] != NULL) {
+        LockQueue* moved = old[i];
+        old[i] = moved->next_;
+        LockQueue** bucket = _bucket(moved->key_);
+        moved->next_ = *bucket;
+        *bucket = moved;
+      }
+    }
+  }
+  LockQueue** bucket = _bucket(queue->key_);
+  queue->next_ = *bucket;
+  *bucket = queue;
+}
+
+void LockTable::_erase(LockQueue* queue) {
+  LockQueue** link = _bucket(queue->key_);
+  while (*link != queue)
+    link = &(*link)->next_;
+  *link = queue->next_;
+  queue_count_--;
+}
+
+void LockTable::_count(LockQueue* queue, LockMode mode, int delta) {
+  if (mode == EXCLUSIVE)
+    queue->num_exclusive_ += delta;
+  else if (mode == SHARED)
+    queue->num_shared_ += delta;
+  else
+    queue->num_increment_ += delta;
+}
+
+bool LockTable::_append(LockQueue* queue, Txn* txn, const Key& key,
+                        LockMode mode) {
+  // A request is granted right away if the lock is free, or if it is a read
+  // and only reads are queued (which then all hold the lock), or likewise
+  // an increment.
+  bool granted =
+      queue->head_ == NULL ||
+      (mode == SHARED && queue->num_exclusive_ + queue->num_increment_ == 0) ||
+      (mode == INCREMENT && queue->num_exclusive_ + queue->num_shared_ == 0);
+
+  LockRequest* request = request_pool_.New();
+  request->txn_ = txn;
+  request->mode_ = mode;
+  request->granted_ = granted;
+  request->key_ = key;
+  request->range_end_ = 0;
+  request->queue_ = queue;
+  request->prev_ = queue->tail_;
+  request->next_ = NULL;
+  if (queue->tail_)
+    queue->tail_->next_ = request;
+  else
+    queue->head_ = request;
+  queue->tail_ = request;
+  _count(queue, mode, 1);
+
+  request->next_of_txn_ = txn->lock_requests_;
+  txn->lock_requests_ = request;
+  return granted;
+}
+
+void LockTable::Remove(LockRequest* request, GrantedTxns* granted) {
+  LockQueue* queue = request->queue_;
+  if (queue == NULL) {
+    // A range. Its requests for single keys are removed on their own.
+    if (request->prev_)
+      request->prev_->next_ = request->next_;
+    else
+      ranges_ = request->next_;
+    if (request->next_)
+      request->next_->prev_ = request->prev_;
+    request_pool_.Delete(request);
+    return;
+  }
+
+  if (request->prev_)
+    request->prev_->next_ = request->next_;
+  else
+    queue->head_ = request->next_;
+  if (request->next_)
+    request->next_->prev_ = request->prev_;
+  else
+    queue->tail_ = request->prev_;
+  _count(queue, request->mode_, -1);
+
+  if (queue->head_ == NULL) {
+    _erase(queue);
+    queue_pool_.Delete(queue);
+  } else {
+    // Advance the lock: grant the front request if it is EXCLUSIVE, else the
+    // whole prefix of requests in its mode. Requests that held the lock
+    // already are skipped.
+    LockRequest* next = queue->head_;
+    if (next->mode_ == EXCLUSIVE) {
+      if (!next->granted_) {
+        next->granted_ = true;
+        granted->push_back(next->txn_);
+      }
+    } else {
+      LockMode mode = next->mode_;
+      for (; next != NULL && next->mode_ == mode; next = next->next_) {
+        if (!next->granted_) {
+          next->granted_ = true;
+          granted->push_back(next->txn_);
+        }
+      }
+    }
+  }
+  request_pool_.Delete(request);
+}
+
+LockMode LockTable::Status(const Key& key, vector<Txn*>* owners) {
+  LockQueue* queue = _find(key);
+  if (queue == NULL) {
+    // Keys nobody has queued for are only held by ranges.
+    LockMode mode = UNLOCKED;
+    if (owners)
+      owners->clear();
+    for (LockRequest* range = ranges_; range != NULL; range = range->next_) {
+      if (range->key_ <= key && key < range->range_end_) {
+        mode = SHARED;
+        if (owners)
+          owners->push_back(range->txn_);
+      }
+    }
+    return mode;
+  }
+
+  LockMode mode = queue->head_->mode_;
+  if (owners) {
+    owners->clear();
+    for (LockRequest* request = queue->head_;
+         request != NULL && request->granted_; request = request->next_) {
+      owners->push_back(request->txn_);
+    }
+  }
+  return mode;
+}
+
+LockMode LockTable::RangeStatus(Key lo, Key hi) {
+  LockMode mode = UNLOCKED;
+  for (LockRequest* range = ranges_; range != NULL; range = range->next_) {
+    if (range->key_ < hi && lo < range->range_end_)
+      mode = SHARED;
+  }
+  _queuesIn(lo, hi);
+  for (size_t i = 0; i < queues_.size(); i++) {
+    LockMode held = queues_[i].second->head_->mode_;
+    if (held == EXCLUSIVE || mode == UNLOCKED ||
+        (held == INCREMENT && mode == SHARED))
+      mode = held;
+  }
+  return mode;
+}
+
+bool LockManager::RangeReadLock(Txn* txn, Key lo, Key hi) {
+  int waits = lock_table_.EnqueueRange(txn, lo, hi);
+  _addWaits(txn, waits);
+  return waits == 0;
+}
+
+LockMode LockManager::RangeStatus(Key lo, Key hi) {
+  return lock_table_.RangeStatus(lo, hi);
+}
+
+LockRequest* LockManager::_unlinkRequest(Txn* txn, const Key& key) {
+  for (LockRequest** link = &txn->lock_requests_; *link != NULL;
+       link = &(*link)->next_of_txn_) {
+    if ((*link)->key_ == key && (*link)->queue_ != NULL) {
+      LockRequest* request = *link;
+      *link = request->next_of_txn_;
+      return request;
+    }
+  }
+  return NULL;
+}
+
+LockRequest* LockManager::_popRequest(Txn* txn) {
+  LockRequest* request = txn->lock_requests_;
+  if (request)
+    txn->lock_requests_ = request->next_of_txn_;
+  return request;
+}
+
+bool LockManager::_grant(Txn* txn) {
+  return txn->lock_waits_.fetch_sub(1) == 1;
+}
+
+void LockManager::_addWaits(Txn* txn, int waits) {
+  txn->lock_waits_.fetch_add(waits);
+}
+
+void LockManager::_resetWaits(Txn* txn) {
+  txn->lock_waits_ = 0;
+}
+
+bool LockManager::_lock(Txn* txn, const Key& key, LockMode mode) {
+  bool granted = lock_table_.Enqueue(txn, key, mode);
+  if (!granted)
+    _addWaits(txn, 1);
+  return granted;
+}
+
+void LockManager::_release(Txn* txn, LockRequest* request) {
+  if (request == NULL)
+    return;
+  if (!request->granted_)
+    _addWaits(txn, -1);
+
+  GrantedTxns granted;
+  lock_table_.Remove(request, &granted);
+  for (auto&& owner : granted) {
+    if (_grant(owner))
+      ready_txns_->push_back(owner);
+  }
+}
+
+LockManagerA::LockManagerA(RingDeque<Txn*>* ready_txns) {
+  ready_txns_ = ready_txns;
+}
+
+bool LockManagerA::WriteLock(Txn* txn, const Key& key) {
+  return _lock(txn, key, EXCLUSIVE);
+}
+
+bool LockManagerA::IncrementLock(Txn* txn, const Key& key) {
+  return WriteLock(txn, key);
+}
+
+bool LockManagerA::ReadLock(Txn* txn, const Key& key) {
+  // Since Part 1A implements ONLY exclusive locks, calls to ReadLock can
+  // simply use the same logic as 'WriteLock'.
+  return WriteLock(txn, key);
+}
+
+void LockManagerA::Release(Txn* txn, const Key& key) {
+  _release(txn, _unlinkRequest(txn, key));
+}
+
+void LockManagerA::ReleaseAll(Txn* txn) {
+  while (LockRequest* request = _popRequest(txn))
+    _release(txn, request);
+  _resetWaits(txn);
+}
+
+LockMode LockManagerA::Status(const Key& key, vector<Txn*>* owners) {
+  return lock_table_.Status(key, owners);
+}
+
+LockManagerB::LockManagerB(RingDeque<Txn*>* ready_txns) {
+  ready_txns_ = ready_txns;
+}
+
+bool LockManagerB::WriteLock(Txn* txn, const Key& key) {
+  return _lock(txn, key, EXCLUSIVE);
+}
+
+bool LockManagerB::IncrementLock(Txn* txn, const Key& key) {
+  return _lock(txn, key, INCREMENT);
+}
+
+bool LockManagerB::ReadLock(Txn* txn, const Key& key) {
+  return _lock(txn, key, SHARED);
+}
+
+void LockManagerB::Release(Txn* txn, const Key& key) {
+  _release(txn, _unlinkRequest(txn, key));
+}
+
+void LockManagerB::ReleaseAll(Txn* txn) {
+  while (LockRequest* request = _popRequest(txn))
+    _release(txn, request);
+  _resetWaits(txn);
+}
+
+LockMode LockManagerB::Status(const Key& key, vector<Txn*>* owners) {
+  return lock_table_.Status(key, owners);
+}
+
+LockManagerC::LockManagerC(MPMCQueue<Txn*>* ready_txns, int partitions)
+    : partition_count_(partitions), ready_queue_(ready_txns) {
+  ready_txns_ = NULL;
+  partitions_ = new Partition[partition_count_];
+}
+
+LockManagerC::~LockManagerC() {
+  delete[] partitions_;
+}
+
+bool LockManagerC::LockAll(Txn* txn, const KeySet& readset,
+                           const KeySet& writeset) {
+  // Latch every partition involved, in partition order.
+  typedef SmallSet<int, 2 * TXN_INLINE_KEYS> PartitionSet;
+  PartitionSet involved;
+  for (KeySet::const_iterator it = readset.begin(); it != readset.end(); ++it)
+    involved.insert(_partitionOf(*it));
+  for (KeySet::const_iterator it = writeset.begin(); it != writeset.end(); ++it)
+    involved.insert(_partitionOf(*it));
+  for (PartitionSet::const_iterator it = involved.begin();
+       it != involved.end(); ++it)
+    partitions_[*it].mutex_.Lock();
+
+  int waits = 0;
+  for (KeySet::const_iterator it = readset.begin();
+       it != readset.end(); ++it) {
+    if (!partitions_[_partitionOf(*it)].table_.Enqueue(txn, *it, SHARED))
+      waits++;
+  }
+  for (KeySet::const_iterator it = writeset.begin();
+       it != writeset.end(); ++it) {
+    if (!partitions_[_partitionOf(*it)].table_.Enqueue(txn, *it, EXCLUSIVE))
+      waits++;
+  }
+
+  // No lock of txn can be granted before its partition is unlatched, so the
+  // count is in place before anyone decrements it.
+  _addWaits(txn, waits);
+
+  for (PartitionSet::const_iterator it = involved.begin();
+       it != involved.end(); ++it)
+    partitions_[*it].mutex_.Unlock();
+  return waits == 0;
+}
+
+bool LockManagerC::_lockOne(Txn* txn, const Key& key, LockMode mode) {
+  Partition* partition = &partitions_[_partitionOf(key)];
+  partition->mutex_.Lock();
+  bool granted = partition->table_.Enqueue(txn, key, mode);
+  if (!granted)
+    _addWaits(txn, 1);
+  partition->mutex_.Unlock();
+  return granted;
+}
+
+bool LockManagerC::WriteLock(Txn* txn, const Key& key) {
+  return _lockOne(txn, key, EXCLUSIVE);
+}
+
+bool LockManagerC::IncrementLock(Txn* txn, const Key& key) {
+  return _lockOne(txn, key, INCREMENT);
+}
+
+bool LockManagerC::ReadLock(Txn* txn, const Key& key) {
+  return _lockOne(txn, key, SHARED);
+}
+
+void LockManagerC::_releaseRequest(LockRequest* request) {
+  Partition* partition = &partitions_[_partitionOf(request->key_)];
+  GrantedTxns granted;
+  partition->mutex_.Lock();
+  // Requests are only granted under the latch.
+  if (!request->granted_)
+    _addWaits(request->txn_, -1);
+  partition->table_.Remove(request, &granted);
+  partition->mutex_.Unlock();
+
+  for (auto&& owner : granted) {
+    if (_grant(owner))
+      ready_queue_->Push(owner);
+  }
+}
+
+void LockManagerC::Release(Txn* txn, const Key& key) {
+  LockRequest* request = _unlinkRequest(txn, key);
+  if (request)
+    _releaseRequest(request);
+}
+
+void LockManagerC::ReleaseAll(Txn* txn) {
+  while (LockRequest* request = _popRequest(txn))
+    _releaseRequest(request);
+}
+
+LockMode LockManagerC::Status(const Key& key, vector<Txn*>* owners) {
+  Partition* partition = &partitions_[_partitionOf(key)];
+  partition->mutex_.Lock();
+  LockMode mode = partition->table_.Status(key, owners);
+  partition->mutex_.Unlock();
+  return mode;
+}
+
+bool LockManagerC::RangeReadLock(Txn* txn, Key lo, Key hi) {
+  DIE("LockManagerC does not support range locks.");
+  return false;
+}
+
+LockMode LockManagerC::RangeStatus(Key lo, Key hi) {
+  DIE("LockManagerC does not support range locks.");
+  return UNLOCKED;
+}
@@ -1,158 +1,369 @@
-// Author: Alexander Thomson (thomson@cs.yale.edu)
-// Modified by: Kun Ren (kun.ren@yale.edu)
-//
-// Interface for lock managers in the system.
-
-#ifndef _LOCK_MANAGER_H_
-#define _LOCK_MANAGER_H_
-
-#include <tr1/unordered_map>
-#include <deque>
-#include <map>
-#include <vector>
-
-#include "txn/common.h"
-
-using std::map;
-using std::deque;
-using std::vector;
-using std::tr1::unordered_map;
-
-class Txn;
-
-// This interface supports locks being held in both read/shared and
-// write/exclusive modes.
-enum LockMode {
-  UNLOCKED = 0,
-  SHARED = 1,
-  EXCLUSIVE = 2,
-};
-
-class LockManager {
- public:
-  virtual ~LockManager();
-
-  // Attempts to grant a read lock to the specified transaction, enqueueing
-  // request in lock table. Returns true if lock is immediately granted, else
-  // returns false.
-  //
-  // Requires: Neither ReadLock nor WriteLock has previously been called with
-  //           this txn and key.
-  virtual bool ReadLock(Txn* txn, const Key& key) = 0;
-
-  // Attempts to grant a write lock to the specified transaction, enqueueing
-  // request in lock table. Returns true if lock is immediately granted, else
-  // returns false.
-  //
-  // Requires: Neither ReadLock nor WriteLock has previously been called with
-  //           this txn and key.
-  virtual bool WriteLock(Txn* txn, const Key& key) = 0;
-
-  // Releases lock held by 'txn' on 'key', or cancels any pending request for
-  // a lock on 'key' by 'txn'. If 'txn' held an EXCLUSIVE lock on 'key' (or was
-  // the sole holder of a SHARED lock on 'key'), then the next request(s) in the
-  // request queue is granted. If the granted request(s) corresponds to a
-  // transaction that has now acquired ALL of its locks, that transaction is
-  // appended to the 'ready_txns_' queue.
-  //
-  // CPSC 438/538:
-  // IMPORTANT NOTE: In order to know WHEN a transaction is ready to run, you
-  // may need to track its lock acquisition progress during the lock request
-  // process.
-  // (Hint: Use 'LockManager::txn_waits_' defined below.)
-  virtual void Release(Txn* txn, const Key& key) = 0;
-
-  // Sets '*owners' to contain the txn IDs of all txns holding the lock, and
-  // returns the current LockMode of the lock: UNLOCKED if it is not currently
-  // held, SHARED or EXCLUSIVE if it is, depending on the current state.
-  virtual LockMode Status(const Key& key, vector<Txn*>* owners) = 0;
-
- protected:
-  // The LockManager's lock table tracks all lock requests. For a given key, if
-  // 'lock_table_' contains a nonempty deque, then the item with that key is
-  // locked and either:
-  //
-  //  (a) first element in the deque specifies the owner if that item is a
-  //      request for an EXCLUSIVE lock, or
-  //
-  //  (b) a SHARED lock is held by all elements of the longest prefix of the
-  //      deque containing only SHARED lock requests.
-  //
-  // For example, if lock_table_["key1"] points to a deque containing
-  //
-  //    (&Txn1, SHARED), (&Txn2, SHARED), (&Txn3, EXCLUSIVE), (&Txn4, SHARED)
-  //
-  // then Txn1 and Txn2 currently hold a SHARED lock on the record with key
-  // "key1". Only when they BOTH release their locks will Txn3 acquire its
-  // exclusive lock on the record. (Note that since Txn4 comes after Txn3, it
-  // cannot acquire a lock until after Txn3 has released its lock, so it cannot
-  // share the lock with Txn1 and Txn2.)
-  //
-  // As a second example, if lock_table_["key1"] points to a deque containing
-  //
-  //    (&Txn1, EXCLUSIVE), (&Txn2, SHARED), (&Txn3, SHARED), (Txn4, EXCLUSIVE)
-  //
-  // then Txn1 currently holds an EXCLUSIVE lock on "key1". When Txn1 releases
-  // its lock, Txn2 and Txn3 will simultaneously acquire SHARED locks on "key1".
-  struct LockRequest {
-    LockRequest(LockMode m, Txn* t) : txn_(t), mode_(m) {}
-    Txn* txn_;       // Pointer to txn requesting the lock.
-    LockMode mode_;  // Specifies whether this is a read or write lock request.
-  };
-  unordered_map<Key, deque<LockRequest>*> lock_table_;
-
-  // Queue of pointers to transactions that:
-  //  (a) were previously blocked on acquiring at least one lock, and
-  //  (b) have now acquired all locks that they have requested.
-  deque<Txn*>* ready_txns_;
-
-  // Tracks all txns still waiting on acquiring at least one lock. Entries in
-  // 'txn_waits_' are invalided by any call to Release() with the entry's
-  // txn.
-  unordered_map<Txn*, int> txn_waits_;
-
-  /**
-   * Get the lock queue for key, creating it if it doesn't exist.
-   */
-  deque<LockRequest>* _getLockQueue(const Key& key);
-};
-
-// Version of the LockManager implementing ONLY exclusive locks.
-class LockManagerA : public LockManager {
- public:
-  explicit LockManagerA(deque<Txn*>* ready_txns);
-  inline virtual ~LockManagerA() {}
-
-  virtual bool ReadLock(Txn* txn, const Key& key);
-  virtual bool WriteLock(Txn* txn, const Key& key);
-  virtual void Release(Txn* txn, const Key& key);
-  virtual LockMode Status(const Key& key, vector<Txn*>* owners);
-};
-
-// Version of the LockManager implementing both shared and exclusive locks.
-class LockManagerB : public LockManager {
- public:
-  explicit LockManagerB(deque<Txn*>* ready_txns);
-  inline virtual ~LockManagerB() {}
-
-  virtual bool ReadLock(Txn* txn, const Key& key);
-  virtual bool WriteLock(Txn* txn, const Key& key);
-  virtual void Release(Txn* txn, const Key& key);
-  virtual LockMode Status(const Key& key, vector<Txn*>* owners);
- private:
-  /**
-   * Returns `false` if no exclusive lock is in the lock queue for `key`.
-   */
-
-  /**
-   * Maintains counts of the number of exclusive locks in lock_table_
-   * for each key.
-   */
-  unordered_map<Key, uint64_t> _numExclusiveWaiting;
-
-  bool _addLock(LockMode mode, Txn* txn, const Key& key);
-  bool _noExclusiveWaiting(const Key& key);
-};
-
-#endif  // _LOCK_MANAGER_H_
-
+// Author: Alexander Thomson (thomson@cs.yale.edu)
+// Modified by: Kun Ren (kun.ren@yale.edu)
+//
+// Interface for lock managers in the system.
+
+#ifndef _LOCK_MANAGER_H_
+#define _LOCK_MANAGER_H_
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "txn/common.h"
+#include "txn/txn.h"
+#include "utils/mpmc_queue.h"
+#include "utils/mutex.h"
+#include "utils/object_pool.h"
+#include "utils/ring_deque.h"
+#include "utils/small_vector.h"
+
+using std::map;
+using std::pair;
+using std::set;
+using std::vector;
+
+struct LockQueue;
+
+// This interface supports locks being held in both read/shared and
+// write/exclusive modes.
+enum LockMode {
+  UNLOCKED = 0,
+  SHARED = 1,
+  EXCLUSIVE = 2,
+  INCREMENT = 3,  // Shared among txns that only Increment() the record
+};
+
+// One txn's request for a lock on one key. Requests are drawn from a
+// LockTable's pool and linked into two intrusive lists: the queue of their
+// key, and the list of all requests made by their txn (Txn::lock_requests_),
+// so that a txn's locks can be released without any lookups.
+//
+// A request for a range of keys has no queue of its own. It is linked into
+// its LockTable's list of ranges instead (through 'prev_' and 'next_'), and
+// stands for the SHARED requests it places in the queues of the keys in the
+// range: those queued already and those queued while it is held.
+struct LockRequest {
+  Txn* txn_;                // Pointer to txn requesting the lock.
+  LockMode mode_;           // Specifies whether this is a read or write lock request.
+  bool granted_;            // True once the txn holds the lock.
+  Key key_;                 // First key, for a range request
+  Key range_end_;           // Range requests only: end of [key_, range_end_)
+  LockQueue* queue_;        // Queue of 'key_', or NULL for a range request
+  LockRequest* prev_;       // Neighbours in 'queue_'
+  LockRequest* next_;
+  LockRequest* next_of_txn_;  // Next request of 'txn_'
+};
+
+// The requests for one key, oldest first. For a nonempty queue, the item
+// with that key is locked and either:
+//
+//  (a) first element in the queue specifies the owner if that item is a
+//      request for an EXCLUSIVE lock, or
+//
+//  (b) a SHARED lock is held by all elements of the longest prefix of the
+//      queue containing only SHARED lock requests, or
+//
+//  (c) likewise, an INCREMENT lock is held by all elements of the longest
+//      prefix containing only INCREMENT requests. Increments commute with
+//      each other but not with reads, so the two never share the lock.
+//
+// For example, if the queue of "key1" contains
+//
+//    (&Txn1, SHARED), (&Txn2, SHARED), (&Txn3, EXCLUSIVE), (&Txn4, SHARED)
+//
+// then Txn1 and Txn2 currently hold a SHARED lock on the record with key
+// "key1". Only when they BOTH release their locks will Txn3 acquire its
+// exclusive lock on the record. (Note that since Txn4 comes after Txn3, it
+// cannot acquire a lock until after Txn3 has released its lock, so it cannot
+// share the lock with Txn1 and Txn2.)
+//
+// As a second example, if the queue of "key1" contains
+//
+//    (&Txn1, EXCLUSIVE), (&Txn2, SHARED), (&Txn3, SHARED), (Txn4, EXCLUSIVE)
+//
+// then Txn1 currently holds an EXCLUSIVE lock on "key1". When Txn1 releases
+// its lock, Txn2 and Txn3 will simultaneously acquire SHARED locks on "key1".
+struct LockQueue {
+  LockRequest* head_;
+  LockRequest* tail_;
+  uint64 num_exclusive_;  // EXCLUSIVE requests in the queue
+  uint64 num_shared_;     // SHARED requests in the queue
+  uint64 num_increment_;  // INCREMENT requests in the queue
+  Key key_;
+  LockQueue* next_;       // Next queue in the same LockTable bucket
+};
+
+// Txns that one release hands a lock on to. Rarely more than a few, so they
+// are kept inline.
+typedef SmallVector<Txn*, 16> GrantedTxns;
+
+// Initial number of buckets of a LockTable. The table doubles whenever it
+// holds more queues than it has buckets.
+#define LOCK_TABLE_BUCKETS 64
+
+// Lock queues of a set of keys, with pools for queues and requests. A key's
+// queue only exists while it has requests, so memory is proportional to the
+// number of outstanding requests rather than to the number of keys ever
+// locked. The queues are chained into a hash table through
+// LockQueue::next_, so once the table has grown to the number of keys
+// locked at once, locking and unlocking never allocate. Not thread-safe.
+class LockTable {
+ public:
+  LockTable()
+      : buckets_(LOCK_TABLE_BUCKETS, static_cast<LockQueue*>(NULL)),
+        queue_count_(0), ranges_(NULL) {}
+
+  // Queues a request of txn for key, links it into txn's request list and
+  // returns true if it is granted right away.
+  bool Enqueue(Txn* txn, const Key& key, LockMode mode);
+
+  // Queues a SHARED request of txn for every key in [lo, hi), whether or
+  // not the key has a record, links it into txn's request list and returns
+  // how many keys it is not granted right away. Takes time in the smaller of
+  // the size of the range and the number of queued keys.
+  //
+  // Requires: txn queues no requests for single keys after this one.
+  int EnqueueRange(Txn* txn, Key lo, Key hi);
+
+  // Removes 'request' from its queue (but not from its txn's list) and frees
+  // it. Appends the txns of requests it unblocked to '*granted'.
+  void Remove(LockRequest* request, GrantedTxns* granted);
+
+  // Sets '*owners' (if not NULL) to the holders of the lock on key and
+  // returns its mode.
+  LockMode Status(const Key& key, vector<Txn*>* owners);
+
+  // Returns the mode in which [lo, hi) is locked, as for
+  // LockManager::RangeStatus.
+  LockMode RangeStatus(Key lo, Key hi);
+
+ private:
+  // Appends a request of txn to 'queue', the queue of key, links it into
+  // txn's request list and returns true if it is granted right away.
+  bool _append(LockQueue* queue, Txn* txn, const Key& key, LockMode mode);
+
+  // Adds 'delta' to the count of mode's requests in 'queue'.
+  static void _count(LockQueue* queue, LockMode mode, int delta);
+
+  // Sets 'queues_' to the keys in [lo, hi) that have queues, with their
+  // queues.
+  void _queuesIn(Key lo, Key hi);
+
+  // Returns the bucket of key.
+  LockQueue** _bucket(Key key) {
+    return &buckets_[(key * 0x9e3779b97f4a7c15ULL) >> 32 &
+                     (buckets_.size() - 1)];
+  }
+
+  // Returns the queue of key, or NULL if it has none.
+  LockQueue* _find(Key key);
+
+  // Adds/removes 'queue' to/from the table.
+  void _insert(LockQueue* queue);
+  void _erase(LockQueue* queue);
+
+  // Hash table of the queues, chained through LockQueue::next_. Its size is
+  // a power of two.
+  vector<LockQueue*> buckets_;
+  uint64 queue_count_;
+
+  // Range requests, newest first.
+  LockRequest* ranges_;
+
+  // Result of _queuesIn(), kept so that its storage is reused.
+  vector<pair<Key, LockQueue*> > queues_;
+
+  ObjectPool<LockQueue> queue_pool_;
+  ObjectPool<LockRequest> request_pool_;
+};
+
+class LockManager {
+ public:
+  virtual ~LockManager() {}
+
+  // Attempts to grant a read lock to the specified transaction, enqueueing
+  // request in lock table. Returns true if lock is immediately granted, else
+  // returns false.
+  //
+  // Requires: Neither ReadLock nor WriteLock has previously been called with
+  //           this txn and key.
+  virtual bool ReadLock(Txn* txn, const Key& key) = 0;
+
+  // Attempts to grant a write lock to the specified transaction, enqueueing
+  // request in lock table. Returns true if lock is immediately granted, else
+  // returns false.
+  //
+  // Requires: Neither ReadLock nor WriteLock has previously been called with
+  //           this txn and key.
+  virtual bool WriteLock(Txn* txn, const Key& key) = 0;
+
+  // Attempts to grant an increment lock to the specified transaction, as
+  // WriteLock does. Increment locks are compatible with each other, and with
+  // nothing else.
+  //
+  // Requires: Neither ReadLock, WriteLock nor IncrementLock has previously
+  //           been called with this txn and key.
+  virtual bool IncrementLock(Txn* txn, const Key& key) = 0;
+
+  // Releases lock held by 'txn' on 'key', or cancels any pending request for
+  // a lock on 'key' by 'txn'. If 'txn' held an EXCLUSIVE lock on 'key' (or was
+  // the sole holder of a SHARED lock on 'key'), then the next request(s) in the
+  // request queue is granted. If the granted request(s) corresponds to a
+  // transaction that has now acquired ALL of its locks, that transaction is
+  // appended to the 'ready_txns_' queue.
+  //
+  // Lock acquisition progress is tracked in Txn::lock_waits_, the number of
+  // the txn's requests not yet granted.
+  virtual void Release(Txn* txn, const Key& key) = 0;
+
+  // Releases every lock held or requested by 'txn'. Takes time proportional
+  // to the number of its requests, with no lookups.
+  virtual void ReleaseAll(Txn* txn) = 0;
+
+  // Sets '*owners' to contain the txn IDs of all txns holding the lock, and
+  // returns the current LockMode of the lock: UNLOCKED if it is not currently
+  // held, or the mode it is held in otherwise.
+  virtual LockMode Status(const Key& key, vector<Txn*>* owners) = 0;
+
+  // Attempts to grant a read lock on every key in [lo, hi) to the specified
+  // transaction, including keys with no record, so that no record can be
+  // created in the range while it is held. Returns true if the lock is
+  // immediately granted; otherwise the txn waits for it as for ReadLock.
+  // Released by ReleaseAll.
+  //
+  // Requires: The txn requests no single-key locks after its ranges.
+  virtual bool RangeReadLock(Txn* txn, Key lo, Key hi);
+
+  // Returns EXCLUSIVE if any key of [lo, hi) is held EXCLUSIVE, else
+  // INCREMENT if any is held INCREMENT, else SHARED if any is held at all.
+  virtual LockMode RangeStatus(Key lo, Key hi);
+
+ protected:
+  // Lock table used by the single-threaded lock managers.
+  LockTable lock_table_;
+
+  // Queue of pointers to transactions that:
+  //  (a) were previously blocked on acquiring at least one lock, and
+  //  (b) have now acquired all locks that they have requested.
+  RingDeque<Txn*>* ready_txns_;
+
+  // Unlinks txn's request for key from txn's request list and returns it, or
+  // NULL if there is none.
+  static LockRequest* _unlinkRequest(Txn* txn, const Key& key);
+
+  // Unlinks and returns txn's first request, or NULL if it has none.
+  static LockRequest* _popRequest(Txn* txn);
+
+  // Counts one more request of txn as granted. Returns true if it was the
+  // last one txn waited for.
+  static bool _grant(Txn* txn);
+
+  // Adds 'waits' to the number of requests txn waits for.
+  static void _addWaits(Txn* txn, int waits);
+
+  // Forgets txn's wait count. Called by ReleaseAll, so that a txn restarted
+  // after releasing its locks starts counting from scratch.
+  static void _resetWaits(Txn* txn);
+
+  // Request/Release implementation for 'lock_table_'. Releasing a request
+  // that was not granted yet leaves txn waiting for one request less.
+  bool _lock(Txn* txn, const Key& key, LockMode mode);
+  void _release(Txn* txn, LockRequest* request);
+};
+
+// Version of the LockManager implementing ONLY exclusive locks.
+class LockManagerA : public LockManager {
+ public:
+  explicit LockManagerA(RingDeque<Txn*>* ready_txns);
+  inline virtual ~LockManagerA() {}
+
+  virtual bool ReadLock(Txn* txn, const Key& key);
+  virtual bool WriteLock(Txn* txn, const Key& key);
+  virtual bool IncrementLock(Txn* txn, const Key& key);
+  virtual void Release(Txn* txn, const Key& key);
+  virtual void ReleaseAll(Txn* txn);
+  virtual LockMode Status(const Key& key, vector<Txn*>* owners);
+};
+
+// Version of the LockManager implementing shared, exclusive and increment
+// locks.
+class LockManagerB : public LockManager {
+ public:
+  explicit LockManagerB(RingDeque<Txn*>* ready_txns);
+  inline virtual ~LockManagerB() {}
+
+  virtual bool ReadLock(Txn* txn, const Key& key);
+  virtual bool WriteLock(Txn* txn, const Key& key);
+  virtual bool IncrementLock(Txn* txn, const Key& key);
+  virtual void Release(Txn* txn, const Key& key);
+  virtual void ReleaseAll(Txn* txn);
+  virtual LockMode Status(const Key& key, vector<Txn*>* owners);
+};
+
+// Number of lock table partitions of a LockManagerC.
+#define LOCK_PARTITIONS 1024
+
+// Version of LockManagerB that any number of threads may call at once. The
+// lock table is split into partitions by key hash, each with its own latch,
+// and txns that become ready are handed off through a thread-safe queue.
+class LockManagerC : public LockManager {
+ public:
+  explicit LockManagerC(MPMCQueue<Txn*>* ready_txns,
+                        int partitions = LOCK_PARTITIONS);
+  virtual ~LockManagerC();
+
+  // Requests read locks on 'readset' and write locks on 'writeset' for txn,
+  // atomically with respect to every other LockAll call sharing a partition:
+  // the latches of all partitions involved are held, in partition order,
+  // while the requests are queued. Conflicting txns are therefore queued in
+  // the same order on every key they share, which rules out deadlocks.
+  // Returns true if all locks were granted immediately. Otherwise txn is
+  // pushed to 'ready_txns' once the last of them is granted.
+  //
+  // Requires: 'readset' and 'writeset' are disjoint, and txn has no other
+  //           requests in this lock manager.
+  bool LockAll(Txn* txn, const KeySet& readset, const KeySet& writeset);
+
+  // Single-key requests. These are only atomic per key: a txn requesting
+  // several keys from more than one thread should use LockAll.
+  //
+  // A txn's requests may only be made and released by one thread at a time.
+  virtual bool ReadLock(Txn* txn, const Key& key);
+  virtual bool WriteLock(Txn* txn, const Key& key);
+  virtual bool IncrementLock(Txn* txn, const Key& key);
+  virtual void Release(Txn* txn, const Key& key);
+  virtual void ReleaseAll(Txn* txn);
+  virtual LockMode Status(const Key& key, vector<Txn*>* owners);
+
+  // Not supported: a range spans every partition.
+  virtual bool RangeReadLock(Txn* txn, Key lo, Key hi);
+  virtual LockMode RangeStatus(Key lo, Key hi);
+
+ private:
+  struct Partition {
+    Mutex mutex_;  // Guards 'table_'
+    LockTable table_;
+    char padding_[64];
+  };
+
+  inline int _partitionOf(const Key& key) const {
+    return (key * 0x9E3779B97F4A7C15ULL) % partition_count_;
+  }
+
+  bool _lockOne(Txn* txn, const Key& key, LockMode mode);
+
+  // Removes and frees 'request' and hands off the txns it unblocked. If it
+  // was not granted yet, its txn waits for one request less.
+  void _releaseRequest(LockRequest* request);
+
+  int partition_count_;
+  Partition* partitions_;
+
+  // Replaces LockManager::ready_txns_.
+  MPMCQueue<Txn*>* ready_queue_;
+};
+
+#endif  // _LOCK_MANAGER_H_
+
@@ -1,196 +1,433 @@
-// Author: Alexander Thomson (thomson@cs.yale.edu)
-// Modified by: Kun Ren (kun.ren@yale.edu)
-
-#include "txn/lock_manager.h"
-
-#include <set>
-#include <string>
-
-#include "utils/testing.h"
-
-using std::set;
-
-TEST(LockManagerA_SimpleLocking) {
-  deque<Txn*> ready_txns;
-  LockManagerA lm(&ready_txns);
-  vector<Txn*> owners;
-
-  Txn* t1 = reinterpret_cast<Txn*>(1);
-  Txn* t2 = reinterpret_cast<Txn*>(2);
-  Txn* t3 = reinterpret_cast<Txn*>(3);
-
-  // Txn 1 acquires read lock.
-  lm.ReadLock(t1, 101);
-  ready_txns.push_back(t1);   // Txn 1 is ready.
-  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t1, owners[0]);
-  EXPECT_EQ(1, ready_txns.size());
-  EXPECT_EQ(t1, ready_txns.at(0));
-
-  // Txn 2 requests write lock. Not granted.
-  lm.WriteLock(t2, 101);
-  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t1, owners[0]);
-  EXPECT_EQ(1, ready_txns.size());
-
-  // Txn 3 requests read lock. Not granted.
-  lm.ReadLock(t3, 101);
-  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t1, owners[0]);
-  EXPECT_EQ(1, ready_txns.size());
-
-  // Txn 1 releases lock.  Txn 2 is granted write lock.
-  lm.Release(t1, 101);
-  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t2, owners[0]);
-  EXPECT_EQ(2, ready_txns.size());
-  EXPECT_EQ(t2, ready_txns.at(1));
-
-  // Txn 2 releases lock.  Txn 3 is granted read lock.
-  lm.Release(t2, 101);
-  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t3, owners[0]);
-  EXPECT_EQ(3, ready_txns.size());
-  EXPECT_EQ(t3, ready_txns.at(2));
-
-  END;
-}
-
-TEST(LockManagerA_LocksReleasedOutOfOrder) {
-  deque<Txn*> ready_txns;
-  LockManagerA lm(&ready_txns);
-  vector<Txn*> owners;
-
-  Txn* t1 = reinterpret_cast<Txn*>(1);
-  Txn* t2 = reinterpret_cast<Txn*>(2);
-  Txn* t3 = reinterpret_cast<Txn*>(3);
-  Txn* t4 = reinterpret_cast<Txn*>(4);
-
-  lm.ReadLock(t1, 101);   // Txn 1 acquires read lock.
-  ready_txns.push_back(t1);  // Txn 1 is ready.
-  lm.WriteLock(t2, 101);  // Txn 2 requests write lock. Not granted.
-  lm.ReadLock(t3, 101);   // Txn 3 requests read lock. Not granted.
-  lm.ReadLock(t4, 101);   // Txn 4 requests read lock. Not granted.
-
-  lm.Release(t2, 101);    // Txn 2 cancels write lock request.
-
-  // Txn 1 should now have a read lock and Txns 3 and 4 should be next in line.
-  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t1, owners[0]);
-
-  // Txn 1 releases lock.  Txn 3 is granted read lock.
-  lm.Release(t1, 101);
-  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t3, owners[0]);
-  EXPECT_EQ(2, ready_txns.size());
-  EXPECT_EQ(t3, ready_txns.at(1));
-
-  // Txn 3 releases lock.  Txn 4 is granted read lock.
-  lm.Release(t3, 101);
-  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t4, owners[0]);
-  EXPECT_EQ(3, ready_txns.size());
-  EXPECT_EQ(t4, ready_txns.at(2));
-
-  END;
-}
-
-
-TEST(LockManagerB_SimpleLocking) {
-  deque<Txn*> ready_txns;
-  LockManagerB lm(&ready_txns);
-  vector<Txn*> owners;
-
-  Txn* t1 = reinterpret_cast<Txn*>(1);
-  Txn* t2 = reinterpret_cast<Txn*>(2);
-  Txn* t3 = reinterpret_cast<Txn*>(3);
-
-  // Txn 1 acquires read lock.
-  lm.ReadLock(t1, 101);
-  ready_txns.push_back(t1);   // Txn 1 is ready.
-  EXPECT_EQ(SHARED, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t1, owners[0]);
-  EXPECT_EQ(1, ready_txns.size());
-  EXPECT_EQ(t1, ready_txns.at(0));
-
-  // Txn 2 requests write lock. Not granted.
-  lm.WriteLock(t2, 101);
-  EXPECT_EQ(SHARED, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t1, owners[0]);
-  EXPECT_EQ(1, ready_txns.size());
-
-  // Txn 3 requests read lock. Not granted.
-  lm.ReadLock(t3, 101);
-  EXPECT_EQ(SHARED, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t1, owners[0]);
-  EXPECT_EQ(1, ready_txns.size());
-
-  // Txn 1 releases lock.  Txn 2 is granted write lock.
-  lm.Release(t1, 101);
-  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t2, owners[0]);
-  EXPECT_EQ(2, ready_txns.size());
-  EXPECT_EQ(t2, ready_txns.at(1));
-
-  // Txn 2 releases lock.  Txn 3 is granted read lock.
-  lm.Release(t2, 101);
-  EXPECT_EQ(SHARED, lm.Status(101, &owners));
-  EXPECT_EQ(1, owners.size());
-  EXPECT_EQ(t3, owners[0]);
-  EXPECT_EQ(3, ready_txns.size());
-  EXPECT_EQ(t3, ready_txns.at(2));
-
-  END;
-}
-
-TEST(LockManagerB_LocksReleasedOutOfOrder) {
-  deque<Txn*> ready_txns;
-  LockManagerB lm(&ready_txns);
-  vector<Txn*> owners;
-
-  Txn* t1 = reinterpret_cast<Txn*>(1);
-  Txn* t2 = reinterpret_cast<Txn*>(2);
-  Txn* t3 = reinterpret_cast<Txn*>(3);
-  Txn* t4 = reinterpret_cast<Txn*>(4);
-
-  lm.ReadLock(t1, 101);   // Txn 1 acquires read lock.
-  ready_txns.push_back(t1);  // Txn 1 is ready.
-  lm.WriteLock(t2, 101);  // Txn 2 requests write lock. Not granted.
-  lm.ReadLock(t3, 101);   // Txn 3 requests read lock. Not granted.
-  lm.ReadLock(t4, 101);   // Txn 4 requests read lock. Not granted.
-
-  lm.Release(t2, 101);    // Txn 2 cancels write lock request.
-
-  // Txns 1, 3 and 4 should now have a shared lock.
-  EXPECT_EQ(SHARED, lm.Status(101, &owners));
-  EXPECT_EQ(3, owners.size());
-  EXPECT_EQ(t1, owners[0]);
-  EXPECT_EQ(t3, owners[1]);
-  EXPECT_EQ(t4, owners[2]);
-  EXPECT_EQ(3, ready_txns.size());
-  EXPECT_EQ(t1, ready_txns.at(0));
-  EXPECT_EQ(t3, ready_txns.at(1));
-  EXPECT_EQ(t4, ready_txns.at(2));
-
-  END;
-}
-
-int main(int argc, char** argv) {
-  LockManagerA_SimpleLocking();
-  LockManagerA_LocksReleasedOutOfOrder();
-  LockManagerB_SimpleLocking();
-  LockManagerB_LocksReleasedOutOfOrder();
-}
-
+// Author: Alexander Thomson (thomson@cs.yale.edu)
+// Modified by: Kun Ren (kun.ren@yale.edu)
+
+#include "txn/lock_manager.h"
+
+#include <set>
+#include <string>
+
+#include "txn/txn_types.h"
+#include "utils/testing.h"
+
+using std::set;
+
+TEST(LockManagerA_SimpleLocking) {
+  RingDeque<Txn*> ready_txns;
+  LockManagerA lm(&ready_txns);
+  vector<Txn*> owners;
+
+  Noop txn1, txn2, txn3;
+  Txn* t1 = &txn1;
+  Txn* t2 = &txn2;
+  Txn* t3 = &txn3;
+
+  // Txn 1 acquires read lock.
+  lm.ReadLock(t1, 101);
+  ready_txns.push_back(t1);   // Txn 1 is ready.
+  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t1, owners[0]);
+  EXPECT_EQ(1, ready_txns.size());
+  EXPECT_EQ(t1, ready_txns.at(0));
+
+  // Txn 2 requests write lock. Not granted.
+  lm.WriteLock(t2, 101);
+  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t1, owners[0]);
+  EXPECT_EQ(1, ready_txns.size());
+
+  // Txn 3 requests read lock. Not granted.
+  lm.ReadLock(t3, 101);
+  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t1, owners[0]);
+  EXPECT_EQ(1, ready_txns.size());
+
+  // Txn 1 releases lock.  Txn 2 is granted write lock.
+  lm.Release(t1, 101);
+  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t2, owners[0]);
+  EXPECT_EQ(2, ready_txns.size());
+  EXPECT_EQ(t2, ready_txns.at(1));
+
+  // Txn 2 releases lock.  Txn 3 is granted read lock.
+  lm.Release(t2, 101);
+  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t3, owners[0]);
+  EXPECT_EQ(3, ready_txns.size());
+  EXPECT_EQ(t3, ready_txns.at(2));
+
+  END;
+}
+
+TEST(LockManagerA_LocksReleasedOutOfOrder) {
+  RingDeque<Txn*> ready_txns;
+  LockManagerA lm(&ready_txns);
+  vector<Txn*> owners;
+
+  Noop txn1, txn2, txn3, txn4;
+  Txn* t1 = &txn1;
+  Txn* t2 = &txn2;
+  Txn* t3 = &txn3;
+  Txn* t4 = &txn4;
+
+  lm.ReadLock(t1, 101);   // Txn 1 acquires read lock.
+  ready_txns.push_back(t1);  // Txn 1 is ready.
+  lm.WriteLock(t2, 101);  // Txn 2 requests write lock. Not granted.
+  lm.ReadLock(t3, 101);   // Txn 3 requests read lock. Not granted.
+  lm.ReadLock(t4, 101);   // Txn 4 requests read lock. Not granted.
+
+  lm.Release(t2, 101);    // Txn 2 cancels write lock request.
+
+  // Txn 1 should now have a read lock and Txns 3 and 4 should be next in line.
+  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t1, owners[0]);
+
+  // Txn 1 releases lock.  Txn 3 is granted read lock.
+  lm.Release(t1, 101);
+  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t3, owners[0]);
+  EXPECT_EQ(2, ready_txns.size());
+  EXPECT_EQ(t3, ready_txns.at(1));
+
+  // Txn 3 releases lock.  Txn 4 is granted read lock.
+  lm.Release(t3, 101);
+  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t4, owners[0]);
+  EXPECT_EQ(3, ready_txns.size());
+  EXPECT_EQ(t4, ready_txns.at(2));
+
+  END;
+}
+
+
+TEST(LockManagerB_SimpleLocking) {
+  RingDeque<Txn*> ready_txns;
+  LockManagerB lm(&ready_txns);
+  vector<Txn*> owners;
+
+  Noop txn1, txn2, txn3;
+  Txn* t1 = &txn1;
+  Txn* t2 = &txn2;
+  Txn* t3 = &txn3;
+
+  // Txn 1 acquires read lock.
+  lm.ReadLock(t1, 101);
+  ready_txns.push_back(t1);   // Txn 1 is ready.
+  EXPECT_EQ(SHARED, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t1, owners[0]);
+  EXPECT_EQ(1, ready_txns.size());
+  EXPECT_EQ(t1, ready_txns.at(0));
+
+  // Txn 2 requests write lock. Not granted.
+  lm.WriteLock(t2, 101);
+  EXPECT_EQ(SHARED, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t1, owners[0]);
+  EXPECT_EQ(1, ready_txns.size());
+
+  // Txn 3 requests read lock. Not granted.
+  lm.ReadLock(t3, 101);
+  EXPECT_EQ(SHARED, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t1, owners[0]);
+  EXPECT_EQ(1, ready_txns.size());
+
+  // Txn 1 releases lock.  Txn 2 is granted write lock.
+  lm.Release(t1, 101);
+  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t2, owners[0]);
+  EXPECT_EQ(2, ready_txns.size());
+  EXPECT_EQ(t2, ready_txns.at(1));
+
+  // Txn 2 releases lock.  Txn 3 is granted read lock.
+  lm.Release(t2, 101);
+  EXPECT_EQ(SHARED, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t3, owners[0]);
+  EXPECT_EQ(3, ready_txns.size());
+  EXPECT_EQ(t3, ready_txns.at(2));
+
+  END;
+}
+
+TEST(LockManagerB_LocksReleasedOutOfOrder) {
+  RingDeque<Txn*> ready_txns;
+  LockManagerB lm(&ready_txns);
+  vector<Txn*> owners;
+
+  Noop txn1, txn2, txn3, txn4;
+  Txn* t1 = &txn1;
+  Txn* t2 = &txn2;
+  Txn* t3 = &txn3;
+  Txn* t4 = &txn4;
+
+  lm.ReadLock(t1, 101);   // Txn 1 acquires read lock.
+  ready_txns.push_back(t1);  // Txn 1 is ready.
+  lm.WriteLock(t2, 101);  // Txn 2 requests write lock. Not granted.
+  lm.ReadLock(t3, 101);   // Txn 3 requests read lock. Not granted.
+  lm.ReadLock(t4, 101);   // Txn 4 requests read lock. Not granted.
+
+  lm.Release(t2, 101);    // Txn 2 cancels write lock request.
+
+  // Txns 1, 3 and 4 should now have a shared lock.
+  EXPECT_EQ(SHARED, lm.Status(101, &owners));
+  EXPECT_EQ(3, owners.size());
+  EXPECT_EQ(t1, owners[0]);
+  EXPECT_EQ(t3, owners[1]);
+  EXPECT_EQ(t4, owners[2]);
+  EXPECT_EQ(3, ready_txns.size());
+  EXPECT_EQ(t1, ready_txns.at(0));
+  EXPECT_EQ(t3, ready_txns.at(1));
+  EXPECT_EQ(t4, ready_txns.at(2));
+
+  END;
+}
+
+TEST(LockManagerB_WaitOnSeveralLocks) {
+  RingDeque<Txn*> ready_txns;
+  LockManagerB lm(&ready_txns);
+
+  Noop txn1, txn2, txn3, txn4;
+  Txn* t1 = &txn1;
+  Txn* t2 = &txn2;
+  Txn* t3 = &txn3;
+  Txn* t4 = &txn4;
+
+  lm.WriteLock(t1, 101);  // Txn 1 acquires write lock on 101.
+  lm.WriteLock(t3, 102);  // Txn 3 acquires write lock on 102.
+  lm.ReadLock(t2, 101);   // Txn 2 waits for both 101 and 102.
+  lm.ReadLock(t2, 102);
+  lm.ReadLock(t4, 101);   // Txn 4 waits for 101.
+
+  // Txns 2 and 4 now share 101, only Txn 4 is ready.
+  lm.Release(t1, 101);
+  EXPECT_EQ(1, ready_txns.size());
+  EXPECT_EQ(t4, ready_txns.at(0));
+
+  // Txn 2 still holds 101, which must not count as another grant.
+  lm.Release(t4, 101);
+  EXPECT_EQ(1, ready_txns.size());
+
+  // Txn 2 is granted its last lock.
+  lm.Release(t3, 102);
+  EXPECT_EQ(2, ready_txns.size());
+  EXPECT_EQ(t2, ready_txns.at(1));
+
+  END;
+}
+
+TEST(LockManagerB_ReleaseWhileWaiting) {
+  RingDeque<Txn*> ready_txns;
+  LockManagerB lm(&ready_txns);
+  Noop txn1, txn2, txn3;
+
+  // Txn 2 holds 101 and waits for 102 and 103.
+  EXPECT_TRUE(lm.WriteLock(&txn1, 102));
+  EXPECT_TRUE(lm.WriteLock(&txn3, 103));
+  EXPECT_TRUE(lm.WriteLock(&txn2, 101));
+  EXPECT_FALSE(lm.ReadLock(&txn2, 102));
+  EXPECT_FALSE(lm.ReadLock(&txn2, 103));
+
+  // Releasing a granted lock leaves both waits in place; cancelling the
+  // request for 103 leaves only 102.
+  lm.Release(&txn2, 101);
+  lm.Release(&txn2, 103);
+  EXPECT_EQ(0, ready_txns.size());
+
+  // Txn 2 is granted the lock it still waits for.
+  lm.Release(&txn1, 102);
+  EXPECT_EQ(1, ready_txns.size());
+  EXPECT_EQ(&txn2, ready_txns.at(0));
+
+  END;
+}
+
+TEST(LockManagerB_ManyKeys) {
+  RingDeque<Txn*> ready_txns;
+  LockManagerB lm(&ready_txns);
+  vector<Txn*> owners;
+  Noop txn1, txn2;
+
+  // Enough keys to grow the lock table several times over, a few of them
+  // in the same bucket, and a range over some of them.
+  for (Key key = 0; key < 5000; key++)
+    EXPECT_TRUE(lm.WriteLock(&txn1, key * 4096));
+  EXPECT_FALSE(lm.ReadLock(&txn2, 4096));
+  EXPECT_EQ(EXCLUSIVE, lm.Status(4096, &owners));
+  EXPECT_EQ(&txn1, owners[0]);
+  EXPECT_EQ(EXCLUSIVE, lm.RangeStatus(0, 3 * 4096));
+  EXPECT_EQ(UNLOCKED, lm.Status(4095, &owners));
+
+  lm.ReleaseAll(&txn1);
+  EXPECT_EQ(1, ready_txns.size());
+  EXPECT_EQ(SHARED, lm.Status(4096, &owners));
+  EXPECT_EQ(UNLOCKED, lm.Status(2 * 4096, &owners));
+  lm.ReleaseAll(&txn2);
+  EXPECT_EQ(UNLOCKED, lm.Status(4096, &owners));
+
+  END;
+}
+
+TEST(LockManagerB_RangeLocks) {
+  RingDeque<Txn*> ready_txns;
+  LockManagerB lm(&ready_txns);
+  vector<Txn*> owners;
+
+  Noop txn1, txn2, txn3, txn4;
+  Txn* t1 = &txn1;
+  Txn* t2 = &txn2;
+  Txn* t3 = &txn3;
+  Txn* t4 = &txn4;
+
+  // Txn 2 waits for Txn 1's write lock on 105 to read [100, 110).
+  lm.WriteLock(t1, 105);
+  EXPECT_FALSE(lm.RangeReadLock(t2, 100, 110));
+  EXPECT_EQ(EXCLUSIVE, lm.RangeStatus(100, 110));
+
+  // Keys nobody has requested are held by the range alone.
+  EXPECT_EQ(SHARED, lm.Status(107, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t2, owners[0]);
+  EXPECT_EQ(UNLOCKED, lm.Status(110, NULL));
+
+  // Txn 3 reads inside the range and writes past it. Txn 4 wants to create
+  // a record inside the range and waits for Txn 2.
+  EXPECT_TRUE(lm.ReadLock(t3, 107));
+  EXPECT_TRUE(lm.WriteLock(t3, 110));
+  EXPECT_FALSE(lm.WriteLock(t4, 103));
+  EXPECT_EQ(SHARED, lm.Status(103, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t2, owners[0]);
+
+  // Txn 2 gets the range, then releases it, and Txn 4 gets 103.
+  lm.ReleaseAll(t1);
+  EXPECT_EQ(1, ready_txns.size());
+  EXPECT_EQ(t2, ready_txns.at(0));
+  lm.ReleaseAll(t2);
+  EXPECT_EQ(2, ready_txns.size());
+  EXPECT_EQ(t4, ready_txns.at(1));
+  EXPECT_EQ(EXCLUSIVE, lm.Status(103, &owners));
+  EXPECT_EQ(SHARED, lm.Status(107, &owners));
+  EXPECT_EQ(1, owners.size());
+  EXPECT_EQ(t3, owners[0]);
+
+  lm.ReleaseAll(t3);
+  lm.ReleaseAll(t4);
+  EXPECT_EQ(UNLOCKED, lm.RangeStatus(100, 111));
+
+  END;
+}
+
+TEST(LockManagerB_IncrementLocks) {
+  RingDeque<Txn*> ready_txns;
+  LockManagerB lm(&ready_txns);
+  vector<Txn*> owners;
+
+  Noop txn1, txn2, txn3, txn4, txn5;
+  Txn* t1 = &txn1;
+  Txn* t2 = &txn2;
+  Txn* t3 = &txn3;
+  Txn* t4 = &txn4;
+  Txn* t5 = &txn5;
+
+  // Increments commute, so Txns 1 and 2 share 101.
+  EXPECT_TRUE(lm.IncrementLock(t1, 101));
+  EXPECT_TRUE(lm.IncrementLock(t2, 101));
+  EXPECT_EQ(INCREMENT, lm.Status(101, &owners));
+  EXPECT_EQ(2, owners.size());
+
+  // A read waits for both. Txn 4 queues behind the read rather than
+  // overtaking it, and Txn 5's write behind Txn 4.
+  EXPECT_FALSE(lm.ReadLock(t3, 101));
+  EXPECT_FALSE(lm.IncrementLock(t4, 101));
+  EXPECT_FALSE(lm.WriteLock(t5, 101));
+
+  lm.Release(t1, 101);
+  EXPECT_EQ(0, ready_txns.size());
+  lm.Release(t2, 101);
+  EXPECT_EQ(1, ready_txns.size());
+  EXPECT_EQ(t3, ready_txns.at(0));
+  EXPECT_EQ(SHARED, lm.Status(101, &owners));
+
+  lm.Release(t3, 101);
+  EXPECT_EQ(2, ready_txns.size());
+  EXPECT_EQ(t4, ready_txns.at(1));
+  EXPECT_EQ(INCREMENT, lm.Status(101, &owners));
+  EXPECT_EQ(1, owners.size());
+
+  lm.Release(t4, 101);
+  EXPECT_EQ(3, ready_txns.size());
+  EXPECT_EQ(t5, ready_txns.at(2));
+  EXPECT_EQ(EXCLUSIVE, lm.Status(101, &owners));
+
+  lm.Release(t5, 101);
+  EXPECT_EQ(UNLOCKED, lm.Status(101, NULL));
+
+  END;
+}
+
+TEST(LockManagerC_LockAll) {
+  MPMCQueue<Txn*> ready_txns;
+  LockManagerC lm(&ready_txns, 4);
+  vector<Txn*> owners;
+  Txn* txn;
+
+  Noop txn1, txn2, txn3;
+  Txn* t1 = &txn1;
+  Txn* t2 = &txn2;
+  Txn* t3 = &txn3;
+
+  KeySet empty;
+  KeySet keys;
+  keys.insert(101);
+  keys.insert(102);
+  KeySet key101;
+  key101.insert(101);
+
+  // Txn 1 writes 101 and 102, Txn 2 reads them, Txn 3 reads 101.
+  EXPECT_TRUE(lm.LockAll(t1, empty, keys));
+  EXPECT_FALSE(lm.LockAll(t2, keys, empty));
+  EXPECT_FALSE(lm.LockAll(t3, key101, empty));
+  EXPECT_EQ(EXCLUSIVE, lm.Status(102, &owners));
+  EXPECT_EQ(t1, owners[0]);
+
+  // Txns 2 and 3 are handed off together once Txn 1 is done.
+  lm.ReleaseAll(t1);
+  EXPECT_EQ(SHARED, lm.Status(101, &owners));
+  EXPECT_EQ(2, owners.size());
+  EXPECT_EQ(2, ready_txns.Size());
+  EXPECT_TRUE(ready_txns.Pop(&txn));
+  EXPECT_TRUE(txn == t2 || txn == t3);
+  EXPECT_TRUE(ready_txns.Pop(&txn));
+  EXPECT_TRUE(txn == t2 || txn == t3);
+
+  lm.ReleaseAll(t2);
+  lm.ReleaseAll(t3);
+  EXPECT_EQ(UNLOCKED, lm.Status(101, &owners));
+  EXPECT_EQ(0, ready_txns.Size());
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  LockManagerA_SimpleLocking();
+  LockManagerA_LocksReleasedOutOfOrder();
+  LockManagerB_SimpleLocking();
+  LockManagerB_LocksReleasedOutOfOrder();
+  LockManagerB_WaitOnSeveralLocks();
+  LockManagerB_ReleaseWhileWaiting();
+  LockManagerB_ManyKeys();
+  LockManagerB_RangeLocks();
+  LockManagerB_IncrementLocks();
+  LockManagerC_LockAll();
+}
+
@@ -0,0 +1,262 @@
+#include "txn/log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+uint32 Checksum(const void* data, size_t size, uint32 hash) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+RedoLog::RedoLog(const string& path, TxnCallback* durable, double window,
+                 size_t group_bytes)
+    : durable_(durable), window_(window), group_bytes_(group_bytes),
+      stopping_(false), group_start_(0), durable_lsn_(0) {
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd_ < 0)
+    DIE("Cannot open log " << path << ": " << strerror(errno));
+  off_t size = lseek(fd_, 0, SEEK_END);
+  tail_ = durable_lsn_ = size > 0 ? size : 0;
+  memset(&stats_, 0, sizeof(stats_));
+
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&flush_cv_, NULL);
+  pthread_create(&thread_, NULL, RunFlusher, this);
+}
+
+RedoLog::~RedoLog() {
+  pthread_mutex_lock(&mutex_);
+  stopping_ = true;
+  pthread_cond_signal(&flush_cv_);
+  pthread_mutex_unlock(&mutex_);
+  pthread_join(thread_, NULL);
+
+  close(fd_);
+  pthread_cond_destroy(&flush_cv_);
+  pthread_mutex_destroy(&mutex_);
+}
+
+uint32 RedoLog::_headerChecksum(const LogRecordHeader& header) {
+  uint32 checksum =
+      Checksum(&header.write_count_, sizeof(header.write_count_));
+  checksum = Checksum(&header.unique_id_, sizeof(header.unique_id_), checksum);
+  return Checksum(&header.increment_count_, sizeof(header.increment_count_),
+                  checksum);
+}
+
+LSN RedoLog::Append(Txn* txn) {
+  LogRecordHeader header;
+  header.write_count_ = txn->writes_.size();
+  header.increment_count_ = txn->increments_.size();
+  header.padding_ = 0;
+  header.unique_id_ = txn->unique_id_;
+  header.checksum_ = _headerChecksum(header);
+  for (KeyValueMap::const_iterator it = txn->writes_.begin();
+       it != txn->writes_.end(); ++it) {
+    header.checksum_ = Checksum(&it->first, sizeof(Key), header.checksum_);
+    header.checksum_ = Checksum(&it->second, sizeof(Value), header.checksum_);
+  }
+  for (KeyValueMap::const_iterator it = txn->increments_.begin();
+       it != txn->increments_.end(); ++it) {
+    header.checksum_ = Checksum(&it->first, sizeof(Key), header.checksum_);
+    header.checksum_ = Checksum(&it->second, sizeof(Value), header.checksum_);
+  }
+
+  pthread_mutex_lock(&mutex_);
+  if (buffer_.empty())
+    group_start_ = GetTime();
+  size_t start = buffer_.size();
+  size_t size = sizeof(header) +
+                (header.write_count_ + header.increment_count_) *
+                    (sizeof(Key) + sizeof(Value));
+  buffer_.resize(start + size);
+  char* record = &buffer_[start];
+  memcpy(record, &header, sizeof(header));
+  record += sizeof(header);
+  for (KeyValueMap::const_iterator it = txn->writes_.begin();
+       it != txn->writes_.end(); ++it) {
+    memcpy(record, &it->first, sizeof(Key));
+    memcpy(record + sizeof(Key), &it->second, sizeof(Value));
+    record += sizeof(Key) + sizeof(Value);
+  }
+  for (KeyValueMap::const_iterator it = txn->increments_.begin();
+       it != txn->increments_.end(); ++it) {
+    memcpy(record, &it->first, sizeof(Key));
+    memcpy(record + sizeof(Key), &it->second, sizeof(Value));
+    record += sizeof(Key) + sizeof(Value);
+  }
+  tail_ += size;
+  LSN lsn = tail_;
+  stats_.records_++;
+
+  // Start the window of a new group, or cut a full one short.
+  if (start == 0 || (start < group_bytes_ && buffer_.size() >= group_bytes_))
+    pthread_cond_signal(&flush_cv_);
+  pthread_mutex_unlock(&mutex_);
+  return lsn;
+}
+
+LSN RedoLog::Tail() {
+  pthread_mutex_lock(&mutex_);
+  LSN lsn = tail_;
+  pthread_mutex_unlock(&mutex_);
+  return lsn;
+}
+
+void RedoLog::NotifyWhenDurable(Txn* txn, LSN lsn) {
+  pthread_mutex_lock(&mutex_);
+  bool durable = lsn <= durable_lsn_;
+  if (!durable)
+    waiters_.push_back(std::make_pair(lsn, txn));
+  pthread_mutex_unlock(&mutex_);
+
+  if (durable)
+    durable_->Done(txn);
+}
+
+void RedoLog::GetStats(LogStats* stats) {
+  pthread_mutex_lock(&mutex_);
+  *stats = stats_;
+  pthread_mutex_unlock(&mutex_);
+}
+
+void* RedoLog::RunFlusher(void* arg) {
+  reinterpret_cast<RedoLog*>(arg)->Flush();
+  return NULL;
+}
+
+void RedoLog::Flush() {
+  vector<char> group;
+  vector<Txn*> ready;
+
+  pthread_mutex_lock(&mutex_);
+  while (true) {
+    if (buffer_.empty()) {
+      if (stopping_)
+        break;
+      pthread_cond_wait(&flush_cv_, &mutex_);
+      continue;
+    }
+
+    // Let the group fill up until its window has passed.
+    double deadline = group_start_ + window_;
+    if (!stopping_ && buffer_.size() < group_bytes_ && GetTime() < deadline) {
+      struct timespec until;
+      until.tv_sec = static_cast<time_t>(deadline);
+      until.tv_nsec = static_cast<long>((deadline - until.tv_sec) * 1e9);
+      pthread_cond_timedwait(&flush_cv_, &mutex_, &until);
+      continue;
+    }
+
+    // Take the group, and let appends start the next one meanwhile.
+    group.swap(buffer_);
+    buffer_.clear();
+    LSN end = tail_;
+    pthread_mutex_unlock(&mutex_);
+
+    WriteAndSync(group);
+
+    pthread_mutex_lock(&mutex_);
+    durable_lsn_ = end;
+    stats_.groups_++;
+    stats_.bytes_ += group.size();
+    size_t kept = 0;
+    for (size_t i = 0; i < waiters_.size(); i++) {
+      if (waiters_[i].first <= end)
+        ready.push_back(waiters_[i].second);
+      else
+        waiters_[kept++] = waiters_[i];
+    }
+    waiters_.resize(kept);
+    pthread_mutex_unlock(&mutex_);
+
+    for (size_t i = 0; i < ready.size(); i++)
+      durable_->Done(ready[i]);
+    ready.clear();
+
+    pthread_mutex_lock(&mutex_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void RedoLog::WriteAndSync(const vector<char>& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t n = write(fd_, &data[written], data.size() - written);
+    if (n < 0 && errno != EINTR)
+      DIE("Log write failed: " << strerror(errno));
+    if (n > 0)
+      written += n;
+  }
+  if (fdatasync(fd_) != 0)
+    DIE("Log sync failed: " << strerror(errno));
+}
+
+LSN RedoLog::Replay(const string& path, LSN start, LogReader* reader) {
+  int fd = open(path.c_str(), O_RDWR);
+  if (fd < 0 && errno == ENOENT)
+    return start;
+  if (fd < 0)
+    DIE("Cannot open log " << path << ": " << strerror(errno));
+  struct stat st;
+  if (fstat(fd, &st) != 0)
+    DIE("Cannot stat log " << path << ": " << strerror(errno));
+  LSN size = st.st_size;
+  if (size < start)
+    DIE("Log " << path << " ends before LSN " << start << ".");
+
+  vector<char> data(size - start);
+  size_t read_bytes = 0;
+  while (read_bytes < data.size()) {
+    ssize_t n = pread(fd, &data[read_bytes], data.size() - read_bytes,
+                      start + read_bytes);
+    if (n < 0 && errno != EINTR)
+      DIE("Log read failed: " << strerror(errno));
+    if (n == 0)
+      break;
+    if (n > 0)
+      read_bytes += n;
+  }
+
+  // Stop at the first record that is cut short or fails its checksum.
+  size_t offset = 0;
+  vector<KeyValue> writes;
+  while (offset + sizeof(LogRecordHeader) <= read_bytes) {
+    LogRecordHeader header;
+    memcpy(&header, &data[offset], sizeof(header));
+    uint64 count = uint64(header.write_count_) + header.increment_count_;
+    size_t pairs = count * sizeof(KeyValue);
+    if (offset + sizeof(header) + pairs > read_bytes)
+      break;
+    const char* record = &data[offset + sizeof(header)];
+    uint32 checksum = _headerChecksum(header);
+    checksum = Checksum(record, pairs, checksum);
+    if (checksum != header.checksum_)
+      break;
+
+    writes.resize(count);
+    if (pairs > 0)
+      memcpy(&writes[0], record, pairs);
+    reader->Record(header.unique_id_, writes.empty() ? NULL : &writes[0],
+                   header.write_count_,
+                   writes.empty() ? NULL : &writes[0] + header.write_count_,
+                   header.increment_count_);
+    offset += sizeof(header) + pairs;
+  }
+
+  LSN end = start + offset;
+  if (end < size) {
+    if (ftruncate(fd, end) != 0 || fdatasync(fd) != 0)
+      DIE("Cannot truncate log " << path << ": " << strerror(errno));
+  }
+  close(fd);
+  return end;
+}
@@ -0,0 +1,139 @@
+// Redo log with group commit, used by TxnProcessor to make commits durable.
+
+#ifndef _LOG_H_
+#define _LOG_H_
+
+#include <pthread.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "txn/common.h"
+#include "txn/txn.h"
+
+using std::pair;
+using std::string;
+using std::vector;
+
+// Default group commit window: a group is written once its oldest record is
+// this many seconds old, or once it holds this many bytes.
+#define LOG_GROUP_WINDOW 0.001
+#define LOG_GROUP_BYTES (1 << 16)
+
+// Log sequence number: the offset in the log just past a record.
+typedef uint64 LSN;
+
+// Header of a log record. It is followed by 'write_count_' (Key, Value)
+// pairs of writes, then 'increment_count_' (Key, delta) pairs of increments
+// (see Txn::Increment), and 'checksum_' covers the header's other fields
+// and the pairs.
+struct LogRecordHeader {
+  uint32 write_count_;
+  uint32 checksum_;
+  uint64 unique_id_;
+  uint32 increment_count_;
+  uint32 padding_;  // Zero
+};
+
+// FNV-1a hash of 'size' bytes at 'data', continuing from 'hash'. Detects torn
+// or corrupt log records and checkpoints.
+uint32 Checksum(const void* data, size_t size, uint32 hash = 2166136261u);
+
+// Receives the records read back by RedoLog::Replay.
+class LogReader {
+ public:
+  virtual ~LogReader() {}
+
+  // Called once per record with the txn's unique_id, its 'count' writes
+  // and its 'increment_count' increments.
+  virtual void Record(uint64 unique_id, const KeyValue* writes, uint32 count,
+                      const KeyValue* increments, uint32 increment_count) = 0;
+};
+
+// Counters of a RedoLog.
+struct LogStats {
+  uint64 groups_;   // Groups written (one fdatasync each)
+  uint64 records_;  // Records appended
+  uint64 bytes_;    // Bytes written
+};
+
+// Append-only log of the write sets of committed txns, written by group
+// commit: a background thread writes and fdatasyncs everything appended so
+// far once the group's window has passed or it has grown to 'group_bytes',
+// and only then passes the txns waiting for those records on to 'durable'.
+// One fdatasync is thus shared by every txn committing within a window.
+class RedoLog {
+ public:
+  // Opens (creating it if needed) the log at 'path' for appending, and starts
+  // the log thread. A 'window' of 0 writes groups back to back, each holding
+  // whatever was appended while the previous one was being synced.
+  RedoLog(const string& path, TxnCallback* durable,
+          double window = LOG_GROUP_WINDOW,
+          size_t group_bytes = LOG_GROUP_BYTES);
+
+  // Writes out everything appended, passes on every waiting txn, and stops
+  // the log thread.
+  ~RedoLog();
+
+  // Appends a record of txn's writes and increments and returns its LSN.
+  // Must be called before the writes become visible to other txns, so that
+  // the record of any write a txn can read precedes the txn's own record.
+  // Thread-safe.
+  LSN Append(Txn* txn);
+
+  // Returns the LSN of the last record appended.
+  LSN Tail();
+
+  // Passes txn to 'durable' once the log is on disk up to 'lsn': right away
+  // (on the calling thread) if it already is, else on the log thread.
+  // Thread-safe.
+  void NotifyWhenDurable(Txn* txn, LSN lsn);
+
+  void GetStats(LogStats* stats);
+
+  // Passes every intact record of the log at 'path' from LSN 'start' on to
+  // 'reader', in log order, and returns the LSN after the last one. A torn or
+  // corrupt tail left by a crash is cut off, so that new records follow the
+  // last intact one. A missing log counts as empty.
+  static LSN Replay(const string& path, LSN start, LogReader* reader);
+
+ private:
+  static void* RunFlusher(void* arg);
+
+  // Main loop of the log thread.
+  void Flush();
+
+  // Checksum of the fields of 'header' other than 'checksum_'.
+  static uint32 _headerChecksum(const LogRecordHeader& header);
+
+  // Writes 'data' to the log file and syncs it.
+  void WriteAndSync(const vector<char>& data);
+
+  int fd_;
+  TxnCallback* durable_;
+  double window_;
+  size_t group_bytes_;
+
+  pthread_t thread_;
+  pthread_mutex_t mutex_;   // Guards everything below
+  pthread_cond_t flush_cv_;  // Signalled when the log thread has work
+  bool stopping_;
+
+  // Records appended since the current group started, the time it started,
+  // and the LSN after its last record.
+  vector<char> buffer_;
+  double group_start_;
+  LSN tail_;
+
+  // The log is on disk up to 'durable_lsn_'. Txns waiting for a later LSN.
+  LSN durable_lsn_;
+  vector<pair<LSN, Txn*> > waiters_;
+
+  LogStats stats_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  RedoLog(const RedoLog&);
+  RedoLog& operator=(const RedoLog&);
+};
+
+#endif  // _LOG_H_
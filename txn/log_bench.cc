@@ -0,0 +1,102 @@
+/// @file
+///
+/// Benchmark of durable commit mode. Keeps ACTIVE_TXNS write txns in flight
+/// in a TxnProcessor for a second at a time, once without a redo log and then
+/// with a log at each group commit window, and prints throughput, commit
+/// latency and the average number of txns sharing an fdatasync.
+///
+/// Usage: bin/log_bench [mode] [log_path]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "txn/txn_processor.h"
+#include "txn/txn_types.h"
+
+using std::vector;
+
+#define ACTIVE_TXNS 100
+#define DB_SIZE 1000000
+#define WRITES_PER_TXN 5
+
+// Runs one configuration and prints its row.
+static void Run(CCMode mode, const string& log_path, double window) {
+  TxnProcessorConfig config;
+  if (!log_path.empty()) {
+    unlink(log_path.c_str());
+    config.log_path_ = log_path;
+    config.log_window_ = window;
+  }
+  TxnProcessor* p = new TxnProcessor(mode, config);
+
+  // Each in-flight txn is identified by its slot in 'txns'.
+  RMW* txns = new RMW[ACTIVE_TXNS];
+  double submitted[ACTIVE_TXNS];
+  Txn* batch[ACTIVE_TXNS];
+  vector<double> latencies;
+
+  double start = GetTime();
+  for (int i = 0; i < ACTIVE_TXNS; i++) {
+    txns[i].Init(DB_SIZE, 0, WRITES_PER_TXN);
+    submitted[i] = start;
+    batch[i] = &txns[i];
+  }
+  p->NewTxnRequests(batch, ACTIVE_TXNS);
+
+  int pending = ACTIVE_TXNS;
+  while (pending > 0) {
+    size_t count = p->GetTxnResults(batch, ACTIVE_TXNS);
+    double now = GetTime();
+    size_t resubmit = 0;
+    for (size_t i = 0; i < count; i++) {
+      int slot = static_cast<RMW*>(batch[i]) - txns;
+      latencies.push_back(now - submitted[slot]);
+      if (now < start + 1) {
+        txns[slot].Reset();
+        txns[slot].Init(DB_SIZE, 0, WRITES_PER_TXN);
+        submitted[slot] = now;
+        batch[resubmit++] = &txns[slot];
+      } else {
+        pending--;
+      }
+    }
+    p->NewTxnRequests(batch, resubmit);
+  }
+  double end = GetTime();
+
+  LogStats stats;
+  p->GetLogStats(&stats);
+  delete p;
+  delete[] txns;
+  if (!log_path.empty())
+    unlink(log_path.c_str());
+
+  sort(latencies.begin(), latencies.end());
+  double p50 = latencies[latencies.size() / 2];
+  double p99 = latencies[latencies.size() * 99 / 100];
+  if (log_path.empty())
+    printf("none\t\t");
+  else
+    printf("%.2f\t\t", window * 1000);
+  printf("%.0f\t\t%.3f\t%.3f\t", latencies.size() / (end - start), p50 * 1000,
+         p99 * 1000);
+  if (stats.groups_ > 0)
+    printf("%.1f\n", static_cast<double>(stats.records_) / stats.groups_);
+  else
+    printf("-\n");
+}
+
+int main(int argc, char** argv) {
+  CCMode mode = argc > 1 ? static_cast<CCMode>(atoi(argv[1])) : LOCKING;
+  string log_path = argc > 2 ? argv[2] : "/tmp/log_bench.log";
+
+  printf("window(ms)\ttxns/s\t\tp50(ms)\tp99(ms)\ttxns/group\n");
+  Run(mode, "", 0);
+  double windows[] = {0, 0.0001, 0.0005, 0.001, 0.002, 0.005, 0.01};
+  for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); i++)
+    Run(mode, log_path, windows[i]);
+  return 0;
+}
@@ -0,0 +1,173 @@
+#include "txn/log.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "txn/txn_types.h"
+#include "utils/testing.h"
+
+using std::map;
+using std::set;
+using std::vector;
+
+// Counts the txns handed to it.
+class CountingCallback : public TxnCallback {
+ public:
+  CountingCallback() : count_(0) {}
+  virtual void Done(Txn* txn) { count_++; }
+  std::atomic<int> count_;
+};
+
+TEST(RedoLog_GroupCommit) {
+  string path = "/tmp/redo_log_test.log";
+  unlink(path.c_str());
+  CountingCallback durable;
+
+  map<Key, Value> m;
+  m[101] = 1;
+  m[102] = 2;
+  Put put(m);
+  put.Run();
+  LSN record_size = sizeof(LogRecordHeader) + 2 * (sizeof(Key) + sizeof(Value));
+
+  {
+    // The window is far longer than the test, so the group is only written
+    // when the log is destroyed.
+    RedoLog log(path, &durable, 60);
+    LSN lsn = log.Append(&put);
+    EXPECT_EQ(record_size, lsn);
+    EXPECT_EQ(lsn, log.Tail());
+    log.NotifyWhenDurable(&put, lsn);
+    EXPECT_EQ(0, durable.count_);
+
+    // Nothing before LSN 0 is pending, so this is passed on right away.
+    Noop noop;
+    log.NotifyWhenDurable(&noop, 0);
+    EXPECT_EQ(1, durable.count_);
+  }
+  EXPECT_EQ(2, durable.count_);
+
+  struct stat st;
+  EXPECT_EQ(0, stat(path.c_str(), &st));
+  EXPECT_EQ(record_size, static_cast<LSN>(st.st_size));
+
+  {
+    // A reopened log carries on at its end. A group that reaches
+    // 'group_bytes' is written without waiting for the window.
+    RedoLog log(path, &durable, 60, 1);
+    LSN lsn = log.Append(&put);
+    EXPECT_EQ(2 * record_size, lsn);
+    log.NotifyWhenDurable(&put, lsn);
+    double start = GetTime();
+    while (durable.count_ < 3 && GetTime() < start + 10)
+      usleep(100);
+    EXPECT_EQ(3, durable.count_);
+
+    LogStats stats;
+    log.GetStats(&stats);
+    EXPECT_EQ(1, stats.groups_);
+    EXPECT_EQ(1, stats.records_);
+    EXPECT_EQ(record_size, stats.bytes_);
+  }
+
+  unlink(path.c_str());
+
+  END;
+}
+
+// Collects the records handed to it.
+class CollectingReader : public LogReader {
+ public:
+  virtual void Record(uint64 unique_id, const KeyValue* writes, uint32 count,
+                      const KeyValue* increments, uint32 increment_count) {
+    ids_.push_back(unique_id);
+    writes_.insert(writes_.end(), writes, writes + count);
+    increments_.insert(increments_.end(), increments,
+                       increments + increment_count);
+  }
+  vector<uint64> ids_;
+  vector<KeyValue> writes_;
+  vector<KeyValue> increments_;
+};
+
+TEST(RedoLog_ReplayTruncatesTornTail) {
+  string path = "/tmp/redo_log_replay_test.log";
+  unlink(path.c_str());
+  CountingCallback durable;
+
+  map<Key, Value> m;
+  m[7] = 70;
+  Put put(m);
+  put.Run();
+  LSN record_size = sizeof(LogRecordHeader) + sizeof(KeyValue);
+  {
+    RedoLog log(path, &durable);
+    log.Append(&put);
+    log.Append(&put);
+  }
+
+  // A crash in the middle of a write leaves part of a record behind.
+  FILE* f = fopen(path.c_str(), "a");
+  fwrite("torn", 1, 4, f);
+  fclose(f);
+
+  CollectingReader reader;
+  EXPECT_EQ(2 * record_size, RedoLog::Replay(path, 0, &reader));
+  EXPECT_EQ(2, reader.ids_.size());
+  EXPECT_EQ(2, reader.writes_.size());
+  EXPECT_EQ(7, reader.writes_[1].key_);
+  EXPECT_EQ(70, reader.writes_[1].value_);
+
+  struct stat st;
+  EXPECT_EQ(0, stat(path.c_str(), &st));
+  EXPECT_EQ(2 * record_size, static_cast<LSN>(st.st_size));
+
+  // Replay can start at any record boundary.
+  CollectingReader tail;
+  EXPECT_EQ(2 * record_size, RedoLog::Replay(path, record_size, &tail));
+  EXPECT_EQ(1, tail.ids_.size());
+
+  unlink(path.c_str());
+
+  END;
+}
+
+TEST(RedoLog_Increments) {
+  string path = "/tmp/redo_log_increments_test.log";
+  unlink(path.c_str());
+  CountingCallback durable;
+
+  // An MVCC txn commits its increments as deltas, after any writes.
+  set<Key> none;
+  set<Key> keys;
+  keys.insert(8);
+  keys.insert(9);
+  RMW rmw(none, none, keys);
+  rmw.Run();
+  {
+    RedoLog log(path, &durable);
+    EXPECT_EQ(sizeof(LogRecordHeader) + 2 * sizeof(KeyValue), log.Append(&rmw));
+  }
+
+  CollectingReader reader;
+  RedoLog::Replay(path, 0, &reader);
+  EXPECT_EQ(1, reader.ids_.size());
+  EXPECT_EQ(0, reader.writes_.size());
+  EXPECT_EQ(2, reader.increments_.size());
+  EXPECT_EQ(9, reader.increments_[1].key_);
+  EXPECT_EQ(1, reader.increments_[1].value_);
+
+  unlink(path.c_str());
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  RedoLog_GroupCommit();
+  RedoLog_ReplayTruncatesTornTail();
+  RedoLog_Increments();
+}
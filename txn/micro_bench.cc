@@ -0,0 +1,204 @@
+/// @file
+///
+/// Microbenchmark suite for the utils primitives and the building blocks of
+/// the CC modes, run by 'make bench'. Prints one JSON record per benchmark
+/// and thread count; see utils/benchmark.h for the record fields and the
+/// options. Benchmarks of components that only ever run on the scheduler
+/// thread (the lock managers) run on one thread.
+///
+/// Usage: bin/micro_bench [--filter=...] [--threads=...] [--repetitions=...]
+///                        [--warmup=...] [--scale=...]
+
+#include <sched.h>
+#include <stdio.h>
+#include <atomic>
+#include <string>
+
+#include "txn/array_storage.h"
+#include "txn/lock_manager.h"
+#include "txn/txn_types.h"
+#include "utils/atomic.h"
+#include "utils/benchmark.h"
+#include "utils/mpmc_queue.h"
+#include "utils/mutex.h"
+#include "utils/static_thread_pool.h"
+
+
+// Keys the MVCC read benchmarks spread their reads over.
+#define MVCC_KEYS 1024
+
+// Returns 'name' followed by "/chain=" and 'chain'.
+static string WithChain(const string& name, int chain) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), "/chain=%d", chain);
+  return name + suffix;
+}
+
+// Sets '*done_' when run, so that whoever submitted it can wait for it.
+class Ping : public Task {
+ public:
+  explicit Ping(std::atomic<bool>* done) : done_(done) {}
+  virtual void Run() { done_->store(true, std::memory_order_release); }
+
+ private:
+  std::atomic<bool>* done_;
+};
+
+// A flag per submitting thread, on a cache line of its own.
+struct alignas(64) PaddedFlag {
+  std::atomic<bool> set_;
+};
+
+static void BenchUtils(Benchmarks* bench, int threads) {
+  Mutex mutex;
+  bench->Run("mutex/lock_unlock", threads, 1000000,
+             [&](int thread, uint64_t i) {
+    mutex.Lock();
+    mutex.Unlock();
+  });
+
+  MutexRW rw;
+  bench->Run("mutex_rw/read_lock_unlock", threads, 1000000,
+             [&](int thread, uint64_t i) {
+    rw.ReadLock();
+    rw.Unlock();
+  });
+  bench->Run("mutex_rw/write_lock_unlock", threads, 1000000,
+             [&](int thread, uint64_t i) {
+    rw.WriteLock();
+    rw.Unlock();
+  });
+
+  Atomic<int> counter(0);
+  bench->Run("atomic/increment", threads, 1000000,
+             [&](int thread, uint64_t i) {
+    ++counter;
+  });
+  bench->Run("atomic/assignment", threads, 1000000,
+             [&](int thread, uint64_t i) {
+    counter = i;
+  });
+
+  AtomicQueue<int> atomic_queue;
+  bench->Run("atomic_queue/push_pop", threads, 1000000,
+             [&](int thread, uint64_t i) {
+    int item;
+    atomic_queue.Push(i);
+    atomic_queue.Pop(&item);
+  });
+  MPMCQueue<int> mpmc_queue;
+  bench->Run("mpmc_queue/push_pop", threads, 1000000,
+             [&](int thread, uint64_t i) {
+    int item;
+    mpmc_queue.Push(i);
+    mpmc_queue.Pop(&item);
+  });
+
+  AtomicMap<int, int> map;
+  for (int i = 0; i < 1000; i++)
+    map.Set(i, i);
+  bench->Run("atomic_map/lookup", threads, 1000000,
+             [&](int thread, uint64_t i) {
+    int value;
+    map.Lookup(i % 1000, &value);
+  });
+  bench->Run("atomic_map/set_erase", threads, 1000000,
+             [&](int thread, uint64_t i) {
+    int key = 1000 + thread;
+    map.Set(key, i);
+    map.Erase(key);
+  });
+}
+
+// The scheduler thread's side of lock management: uncontended grants and
+// their releases, as LOCKING_EXCLUSIVE_ONLY (A) and LOCKING (B) make them.
+static void BenchLockManagers(Benchmarks* bench) {
+  RingDeque<Txn*> ready;
+  LockManagerA a(&ready);
+  LockManagerB b(&ready);
+  Noop txn;
+  Noop holder;
+
+  bench->Run("lock_manager_a/write_lock_release", 1000000,
+             [&](int thread, uint64_t i) {
+    a.WriteLock(&txn, i % 1024);
+    a.Release(&txn, i % 1024);
+  });
+  bench->Run("lock_manager_b/write_lock_release", 1000000,
+             [&](int thread, uint64_t i) {
+    b.WriteLock(&txn, i % 1024);
+    b.Release(&txn, i % 1024);
+  });
+
+  // Joining a key that another txn already holds shared.
+  for (Key key = 0; key < 1024; key++)
+    b.ReadLock(&holder, key);
+  bench->Run("lock_manager_b/shared_lock_release", 1000000,
+             [&](int thread, uint64_t i) {
+    b.ReadLock(&txn, i % 1024);
+    b.Release(&txn, i % 1024);
+  });
+  b.ReleaseAll(&holder);
+
+  // A whole txn's worth of locks, dropped as the scheduler drops them.
+  bench->Run("lock_manager_b/lock5_release_all", 200000,
+             [&](int thread, uint64_t i) {
+    for (Key key = 0; key < 5; key++)
+      b.WriteLock(&txn, (i * 5 + key) % 1024);
+    b.ReleaseAll(&txn);
+  });
+}
+
+// MVCCStorage::Read of the newest and of the oldest version of keys with
+// 'chain' versions each, by concurrent readers.
+static void BenchMVCCReads(Benchmarks* bench, int threads, int chain) {
+  MVCCArrayStorage storage(MVCC_KEYS);
+  for (Key key = 0; key < MVCC_KEYS; key++) {
+    storage.Lock(key);
+    for (int version = 1; version <= chain; version++)
+      storage.Write(key, version, version);
+    storage.Unlock(key);
+  }
+
+  bench->Run(WithChain("mvcc_storage/read_newest", chain), threads,
+             1000000, [&](int thread, uint64_t i) {
+    Value value;
+    storage.Read((i * 7919 + thread) % MVCC_KEYS, &value, chain);
+  });
+  bench->Run(WithChain("mvcc_storage/read_oldest", chain), threads,
+             1000000, [&](int thread, uint64_t i) {
+    Value value;
+    storage.Read((i * 7919 + thread) % MVCC_KEYS, &value, 1);
+  });
+}
+
+// Round trip from StaticThreadPool::RunTask() to the task having run, with
+// as many threads submitting as the pool has workers.
+static void BenchThreadPool(Benchmarks* bench, int threads) {
+  StaticThreadPool pool(threads);
+  vector<PaddedFlag> done(threads);
+  bench->Run("static_thread_pool/dispatch", threads, 20000,
+             [&](int thread, uint64_t i) {
+    std::atomic<bool>* flag = &done[thread].set_;
+    flag->store(false, std::memory_order_relaxed);
+    pool.RunTask(new Ping(flag));
+    while (!flag->load(std::memory_order_acquire))
+      sched_yield();
+  });
+}
+
+int main(int argc, char** argv) {
+  Benchmarks bench(argc, argv);
+  const vector<int>& threads = bench.ThreadCounts();
+  for (size_t i = 0; i < threads.size(); i++)
+    BenchUtils(&bench, threads[i]);
+  BenchLockManagers(&bench);
+  int chains[] = {1, 8, 64};
+  for (size_t i = 0; i < threads.size(); i++) {
+    for (int c = 0; c < 3; c++)
+      BenchMVCCReads(&bench, threads[i], chains[c]);
+  }
+  for (size_t i = 0; i < threads.size(); i++)
+    BenchThreadPool(&bench, threads[i]);
+  return 0;
+}
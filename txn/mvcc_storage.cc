@@ -1,148 +1,403 @@
-// Author: Kun Ren (kun.ren@yale.edu)
-// Modified by Daniel Abadi
-
-#include "txn/mvcc_storage.h"
-
-// Init the storage
-void MVCCStorage::InitStorage() {
-  for (int i = 0; i < 1000000;i++) {
-    Write(i, 0, 0);
-    Mutex* key_mutex = new Mutex();
-    mutexs_[i] = key_mutex;
-  }
-}
-
-// Free memory.
-MVCCStorage::~MVCCStorage() {
-  for (unordered_map<Key, deque<Version*>*>::iterator it = mvcc_data_.begin();
-       it != mvcc_data_.end(); ++it) {
-    delete it->second;          
-  }
-  
-  mvcc_data_.clear();
-  
-  for (unordered_map<Key, Mutex*>::iterator it = mutexs_.begin();
-       it != mutexs_.end(); ++it) {
-    delete it->second;          
-  }
-  
-  mutexs_.clear();
-}
-
-// Lock the key to protect its version_list. Remember to lock the key when you read/update the version_list 
-void MVCCStorage::Lock(Key key) {
-  mutexs_[key]->Lock();
-}
-
-// Unlock the key.
-void MVCCStorage::Unlock(Key key) {
-  mutexs_[key]->Unlock();
-}
-
-// MVCC Read
-bool MVCCStorage::Read(Key key, Value* result, int txn_unique_id) {
-  // CPSC 638:
-	//
-  // Hint: Iterate the version_lists and return the verion whose write timestamp
-  // (version_id) is the largest write timestamp less than or equal to txn_unique_id.
-  
-  //key not found
-  if (!mvcc_data_.count(key)){
-    return false;
-  }
-
-  deque<Version*> *data = mvcc_data_[key];
-  if (data->empty()) {
-    //no data
-    return false;
-  }
-  else {
-    int maxlessthan = 0;
-    deque<Version*> version_list = *data;
-    for (deque<Version*>::iterator itr = version_list.begin(); itr != version_list.end(); itr++){
-        Version* version = *itr;
-        //get largest less than version
-        if (version->version_id_ <= txn_unique_id && version->version_id_ > maxlessthan){
-          //set new version
-          *result = version->value_;
-          version->max_read_id_ = txn_unique_id;
-        }  
-    }
-  }
-  return true;
-}
-
-
-
-// Check whether apply or abort the write
-bool MVCCStorage::CheckWrite(Key key, int txn_unique_id) {
-  // CPSC 638:
-  //
-  // Implement this method!
-	
-  // Hint: Before all writes are applied, we need to make sure that each write
-  // can be safely applied based on MVCC timestamp ordering protocol. This method
-  // only checks one key, so you should call this method for each key in the
-  // write_set. Return true if this key passes the check, return false if not. 
-  // Note that you don't have to call Lock(key) in this method, just
-  // call Lock(key) before you call this method and call Unlock(key) afterward.
-  
-  //key not found
-  if (!mvcc_data_.count(key)){
-    return false;
-  }
-
-  deque<Version*> *data = mvcc_data_[key];
-  
-  if (data->empty()) {
-    //no data
-    return true;
-  }
-  else {
-    deque<Version*> version_list = *data;
-    //get latest version
-    Version* version = version_list.back();
-
-    //check if version valid
-    if (version->max_read_id_ > txn_unique_id){
-      return false;
-    }
-  }
-  return true;
-}
-
-// MVCC Write, call this method only if CheckWrite return true.
-void MVCCStorage::Write(Key key, Value value, int txn_unique_id) {
-  // CPSC 638:
-  //
-  // Implement this method!
-  
-  // Hint: Insert a new version (malloc a Version and specify its value/version_id/max_read_id)
-  // into the version_lists. Note that InitStorage() also calls this method to init storage. 
-  // Note that you don't have to call Lock(key) in this method, just
-  // call Lock(key) before you call this method and call Unlock(key) afterward.
-
-  //create new version
-  Version* new_update = new Version();
-	new_update->value_ 				= value;
-	new_update->version_id_ 	= txn_unique_id;
-	new_update->max_read_id_ 	= 0;
-
-	deque<Version*>* versions;
-
-	if(mvcc_data_.count(key) > 0) {
-    //key exists
-		versions = mvcc_data_[key];
-	}
-  else
-  {
-    //key not exists
-		versions = new deque<Version*>();
-		mvcc_data_[key] = versions;
-	}
-
-  //push to deque
-	versions->push_front(new_update);
-}
-
-
+// Author: Kun Ren (kun.ren@yale.edu)
+// Modified by Daniel Abadi
+
+#include "txn/mvcc_storage.h"
+
+#include <sched.h>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+using std::vector;
+
+// Init the storage
+void MVCCStorage::InitStorage() {
+  mvcc_data_.rehash(INIT_STORAGE_SIZE);
+  for (int i = 0; i < INIT_STORAGE_SIZE;i++) {
+    Write(i, 0, 0);
+  }
+}
+
+void MVCCStorage::BulkLoad(const KeyValue* records, uint64 count) {
+  mvcc_data_.rehash(count);
+  for (uint64 i = 0; i < count; i++) {
+    Write(records[i].key_, records[i].value_, 0);
+  }
+}
+
+// Txns never create keys (CheckWrite rejects keys without versions), so
+// 'mvcc_data_' does not change while it is being walked.
+void MVCCStorage::Snapshot(vector<KeyValue>* records, uint64 txn_unique_id) {
+  KeyValue record;
+  for (uint64 i = 0; i < dense_size_; i++) {
+    record.key_ = i;
+    if (Read(i, &record.value_, txn_unique_id))
+      records->push_back(record);
+  }
+  for (unordered_map<Key, VersionList*>::iterator it = mvcc_data_.begin();
+       it != mvcc_data_.end(); ++it) {
+    record.key_ = it->first;
+    if (Read(it->first, &record.value_, txn_unique_id))
+      records->push_back(record);
+  }
+}
+
+// Free memory.
+MVCCStorage::~MVCCStorage() {
+  for (unordered_map<Key, VersionList*>::iterator it = mvcc_data_.begin();
+       it != mvcc_data_.end(); ++it) {
+    _freeVersions(it->second);
+    _deleteVersionLists(it->second, 1);
+  }
+  
+  mvcc_data_.clear();
+
+  for (uint64 i = 0; i < dense_size_; i++) {
+    _freeVersions(&dense_data_[i]);
+  }
+  _deleteVersionLists(dense_data_, dense_size_);
+
+  for (deque<pair<uint64, Version*> >::iterator it = retired_.begin();
+       it != retired_.end(); ++it) {
+    delete it->second;
+  }
+
+  retired_.clear();
+}
+
+void MVCCStorage::_freeVersions(VersionList* versions) {
+  Version* version = versions->head_.load();
+  while (version != NULL) {
+    Version* next = version->next_.load();
+    delete version;
+    version = next;
+  }
+}
+
+VersionList* MVCCStorage::_newVersionLists(uint64 count,
+                                           const vector<cpu_set_t>& affinity) {
+  void* memory;
+  size_t alignment = affinity.empty() ? CACHE_LINE_SIZE : PartitionAlignment();
+  if (posix_memalign(&memory, alignment, count * sizeof(VersionList)) != 0)
+    DIE("Out of memory allocating " << count << " version lists.");
+
+  RunPartitioned(affinity, count, sizeof(VersionList), _initVersionLists, memory);
+  return reinterpret_cast<VersionList*>(memory);
+}
+
+void MVCCStorage::_initVersionLists(void* lists, uint64 begin, uint64 end) {
+  for (uint64 i = begin; i < end; i++) {
+    new (&reinterpret_cast<VersionList*>(lists)[i]) VersionList();
+  }
+}
+
+void MVCCStorage::_deleteVersionLists(VersionList* lists, uint64 count) {
+  if (lists == NULL)
+    return;
+  for (uint64 i = 0; i < count; i++) {
+    lists[i].~VersionList();
+  }
+  free(lists);
+}
+
+// Lock the key to protect its version_list. Remember to lock the key when you
+// update the version_list (reads don't need it).
+void MVCCStorage::Lock(Key key) {
+  _getVersions(key)->mutex_.Lock();
+}
+
+// Unlock the key.
+void MVCCStorage::Unlock(Key key) {
+  _getVersions(key)->mutex_.Unlock();
+}
+
+void MVCCStorage::BeginInstall(Key key, uint64 txn_unique_id, bool pending) {
+  VersionList* versions = _getVersions(key);
+  versions->install_pending_ = pending;
+  versions->installing_.store(txn_unique_id);
+  // Sequentially consistent, so that the CheckWrite after it sees every
+  // max_read_id_ raised by a reader that then saw the old number.
+  versions->install_seq_.fetch_add(1);
+}
+
+void MVCCStorage::EndInstall(Key key) {
+  VersionList* versions = _getVersions(key);
+  versions->install_pending_ = false;
+  versions->install_seq_.fetch_add(1);
+}
+
+void MVCCStorage::Publish(Key key, uint64 txn_unique_id) {
+  Version* version = _getVersions(key)->head_.load(std::memory_order_relaxed);
+  while (version != NULL && version->version_id_ != txn_unique_id)
+    version = version->next_.load(std::memory_order_relaxed);
+  if (version != NULL)
+    version->pending_.store(false, std::memory_order_release);
+}
+
+// MVCC Read
+bool MVCCStorage::Read(Key key, Value* result, uint64 txn_unique_id) {
+  // CPSC 638:
+	//
+  // Hint: Iterate the version_lists and return the verion whose write timestamp
+  // (version_id) is the largest write timestamp less than or equal to txn_unique_id.
+  
+  //key not found
+  VersionList* versions = _getVersions(key);
+  if (versions == NULL) {
+    return false;
+  }
+
+  while (true) {
+    // Wait out a writer that is in the middle of installing a version this
+    // txn would see. One with a larger timestamp installs nothing it can see,
+    // and its CheckWrite either sees this read or precedes it, which the
+    // recheck below detects.
+    uint32 seq = versions->install_seq_.load();
+    if ((seq & 1) && versions->installing_.load() <= txn_unique_id) {
+      sched_yield();
+      continue;
+    }
+
+    // The list is sorted newest-first, so the first version old enough is
+    // the largest write timestamp less than or equal to txn_unique_id.
+    Version* version = versions->head_.load(std::memory_order_acquire);
+    while (version != NULL && version->version_id_ > txn_unique_id) {
+      version = version->next_.load(std::memory_order_acquire);
+    }
+    if (version == NULL) {
+      //no version visible to this txn
+      return false;
+    }
+
+    // Raise max_read_id_ to txn_unique_id on the version and on any it
+    // builds on.
+    Value value = _resolve(version, txn_unique_id);
+
+    // If no writer got in while the read was recorded, it is safe.
+    if (versions->install_seq_.load() == seq) {
+      *result = value;
+      return true;
+    }
+  }
+}
+
+
+
+// Check whether apply or abort the write
+bool MVCCStorage::CheckWrite(Key key, uint64 txn_unique_id) {
+  // CPSC 638:
+  //
+  // Implement this method!
+	
+  // Hint: Before all writes are applied, we need to make sure that each write
+  // can be safely applied based on MVCC timestamp ordering protocol. This method
+  // only checks one key, so you should call this method for each key in the
+  // write_set. Return true if this key passes the check, return false if not. 
+  // Note that you don't have to call Lock(key) in this method, just
+  // call Lock(key) before you call this method and call Unlock(key) afterward.
+  
+  //key not found
+  VersionList* versions = _getVersions(key);
+  if (versions == NULL) {
+    return false;
+  }
+
+  // Find the version this write would follow, i.e. the one this txn read.
+  Version* version = versions->head_.load(std::memory_order_relaxed);
+  while (version != NULL && version->version_id_ > txn_unique_id) {
+    version = version->next_.load(std::memory_order_relaxed);
+  }
+
+  //check if a later txn has already read it
+  if (version != NULL && version->max_read_id_.load() > txn_unique_id) {
+    return false;
+  }
+  return true;
+}
+
+// MVCC Write, call this method only if CheckWrite return true.
+void MVCCStorage::Write(Key key, Value value, uint64 txn_unique_id) {
+  // CPSC 638:
+  //
+  // Implement this method!
+  
+  // Hint: Insert a new version (malloc a Version and specify its value/version_id/max_read_id)
+  // into the version_lists. Note that InitStorage() also calls this method to init storage. 
+  // Note that you don't have to call Lock(key) in this method, just
+  // call Lock(key) before you call this method and call Unlock(key) afterward.
+
+	VersionList* versions = _getVersions(key);
+
+	if (versions == NULL) {
+    //key not exists
+		versions = _newVersionLists(1);
+		mvcc_data_[key] = versions;
+		index_.Insert(key);
+	}
+
+  _insertVersion(versions, value, false, txn_unique_id);
+}
+
+void MVCCStorage::Increment(Key key, Value delta, uint64 txn_unique_id) {
+  VersionList* versions = _getVersions(key);
+  if (versions == NULL ||
+      versions->head_.load(std::memory_order_relaxed) == NULL) {
+    // Nothing to add the delta to.
+    Write(key, delta, txn_unique_id);
+    return;
+  }
+  _insertVersion(versions, delta, true, txn_unique_id);
+}
+
+Value MVCCStorage::_resolve(Version* version, uint64 txn_unique_id) {
+  Value value = 0;
+  for (; version != NULL;
+       version = version->next_.load(std::memory_order_acquire)) {
+    // Raise max_read_id_ to txn_unique_id (atomic fetch-max).
+    // Versions whose txn has not reached the redo log yet must not be read
+    // by a txn that could then become durable first.
+    while (version->pending_.load(std::memory_order_acquire))
+      sched_yield();
+    uint64 max_read_id = version->max_read_id_.load();
+    while (max_read_id < txn_unique_id &&
+           !version->max_read_id_.compare_exchange_weak(max_read_id,
+                                                        txn_unique_id)) {}
+    value += version->value_;
+    if (!version->delta_)
+      break;
+  }
+  return value;
+}
+
+void MVCCStorage::_insertVersion(VersionList* versions, Value value,
+                                 bool delta, uint64 txn_unique_id) {
+  Version* new_update = new Version();
+  new_update->value_ = value;
+  new_update->delta_ = delta;
+  new_update->version_id_ = txn_unique_id;
+  new_update->max_read_id_ = 0;
+  new_update->pending_.store(versions->install_pending_,
+                             std::memory_order_relaxed);
+
+  // Find the first link pointing at an older version and insert in front of
+  // it, keeping the list sorted newest-first. Publishing the link last means
+  // a concurrent reader either sees a complete version or none at all.
+  std::atomic<Version*>* link = &versions->head_;
+  Version* next = link->load(std::memory_order_relaxed);
+  while (next != NULL && next->version_id_ > txn_unique_id) {
+    link = &next->next_;
+    next = link->load(std::memory_order_relaxed);
+  }
+  new_update->next_.store(next, std::memory_order_relaxed);
+  link->store(new_update, std::memory_order_release);
+}
+
+// Unlink all versions that no active or future transaction can read. Note that
+// you don't have to call Lock(key) in this method, just call Lock(key) before
+// you call this method and call Unlock(key) afterward.
+int MVCCStorage::GarbageCollect(Key key, uint64 low_water_mark,
+                                const TimestampOracle& timestamps) {
+  int reclaimed = 0;
+  VersionList* versions = _getVersions(key);
+  if (versions != NULL) {
+    // Find the version that the oldest active transaction would read. Every
+    // version after it in the list is invisible to all transactions.
+    std::atomic<Version*>* link = &versions->head_;
+    Version* oldest_visible = link->load(std::memory_order_relaxed);
+    while (oldest_visible != NULL &&
+           oldest_visible->version_id_ > low_water_mark) {
+      link = &oldest_visible->next_;
+      oldest_visible = link->load(std::memory_order_relaxed);
+    }
+
+    if (oldest_visible != NULL) {
+      Version* version = oldest_visible->next_.load(std::memory_order_relaxed);
+      if (oldest_visible->delta_) {
+        // Deltas above it only need its value, so fold what it adds up to
+        // into a full copy and drop it along with everything older. Readers
+        // that raise the old one's max_read_id_ meanwhile retry, as the
+        // swap counts as an install that every reader waits for.
+        versions->installing_.store(0);
+        versions->install_seq_.fetch_add(1);
+        Version* full = new Version();
+        full->value_ = _resolve(oldest_visible, 0);
+        full->delta_ = false;
+        full->version_id_ = oldest_visible->version_id_;
+        full->max_read_id_ = oldest_visible->max_read_id_.load();
+        full->pending_.store(false, std::memory_order_relaxed);
+        full->next_.store(NULL, std::memory_order_relaxed);
+        link->store(full, std::memory_order_release);
+        versions->install_seq_.fetch_add(1);
+        version = oldest_visible;
+      } else if (version != NULL) {
+        oldest_visible->next_.store(NULL, std::memory_order_release);
+      }
+      if (version != NULL) {
+        // Readers still walking the unlinked versions (through the deltas
+        // above them) took their timestamps before the unlink, so the bound
+        // is read only once it is done.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64 next_id = timestamps.Peek();
+        retired_mutex_.Lock();
+        while (version != NULL) {
+          retired_.push_back(std::make_pair(next_id, version));
+          version = version->next_.load(std::memory_order_relaxed);
+          reclaimed++;
+        }
+        retired_mutex_.Unlock();
+        versions_reclaimed_ += reclaimed;
+      }
+    }
+  }
+
+  // Free whatever no reader can still be looking at.
+  if (retired_mutex_.TryLock()) {
+    while (!retired_.empty() && retired_.front().first <= low_water_mark) {
+      delete retired_.front().second;
+      retired_.pop_front();
+    }
+    retired_mutex_.Unlock();
+  }
+  return reclaimed;
+}
+
+// Collect the GC counters and version chain length percentiles.
+void MVCCStorage::GetGCStats(GCStats* stats) {
+  vector<VersionList*> lists;
+  lists.reserve(dense_size_ + mvcc_data_.size());
+  for (uint64 i = 0; i < dense_size_; i++) {
+    if (dense_data_[i].head_.load() != NULL)
+      lists.push_back(&dense_data_[i]);
+  }
+  for (unordered_map<Key, VersionList*>::iterator it = mvcc_data_.begin();
+       it != mvcc_data_.end(); ++it) {
+    lists.push_back(it->second);
+  }
+
+  vector<int> lengths;
+  lengths.reserve(lists.size());
+  for (vector<VersionList*>::iterator it = lists.begin(); it != lists.end(); ++it) {
+    // Only blocks writers, so there is no need to bump install_seq_.
+    (*it)->mutex_.Lock();
+    int length = 0;
+    for (Version* version = (*it)->head_.load(); version != NULL;
+         version = version->next_.load()) {
+      length++;
+    }
+    (*it)->mutex_.Unlock();
+    lengths.push_back(length);
+  }
+
+  stats->versions_reclaimed_ = *versions_reclaimed_;
+  stats->chain_length_p50_ = 0;
+  stats->chain_length_p99_ = 0;
+  stats->chain_length_max_ = 0;
+  if (lengths.empty()) {
+    return;
+  }
+
+  std::sort(lengths.begin(), lengths.end());
+  stats->chain_length_p50_ = lengths[lengths.size() * 50 / 100];
+  stats->chain_length_p99_ = lengths[lengths.size() * 99 / 100];
+  stats->chain_length_max_ = lengths.back();
+}
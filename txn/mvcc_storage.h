@@ -1,56 +1,199 @@
-// Author: Kun Ren (kun.ren@yale.edu)
-
-#ifndef _MVCC_STORAGE_H_
-#define _MVCC_STORAGE_H_
-
-#include "txn/storage.h"
-
-// MVCC 'version' structure
-struct Version {
-  Value value_;      // The value of this version
-  int max_read_id_;  // Largest timestamp of a transaction that read the version
-  int version_id_;   // Timestamp of the transaction that created(wrote) the version
-};
-
-// MVCC storage
-class MVCCStorage : public Storage {
- public:
-  // If there exists a record for the specified key, sets '*result' equal to
-  // the value associated with the key and returns true, else returns false;
-  // The third parameter is the txn_unique_id(txn timestamp), which is used for MVCC.
-  virtual bool Read(Key key, Value* result, int txn_unique_id = 0);
-
-  // Inserts a new version with key and value
-  // The third parameter is the txn_unique_id(txn timestamp), which is used for MVCC.
-  virtual void Write(Key key, Value value, int txn_unique_id = 0);
-
-  // Returns the timestamp at which the record with the specified key was last
-  // updated (returns 0 if the record has never been updated). This is used for OCC.
-  virtual double Timestamp(Key key) {return 0;}
-  
-  // Init storage
-  virtual void InitStorage();
-  
-  // Lock the version_list of key
-  virtual void Lock(Key key);
-  
-  // Unlock the version_list of key
-  virtual void Unlock(Key key);
-  
-  // Check whether apply or abort the write
-  virtual bool CheckWrite (Key key, int txn_unique_id);
-  
-  virtual ~MVCCStorage();
-
- private:
- 
-  friend class TxnProcessor;
-  
-  // Storage for MVCC, each key has a linklist of versions
-  unordered_map<Key, deque<Version*>*> mvcc_data_;
-  
-  // Mutexs for each key
-  unordered_map<Key, Mutex*> mutexs_;
-};
-
-#endif  // _MVCC_STORAGE_H_
+// Author: Kun Ren (kun.ren@yale.edu)
+
+#ifndef _MVCC_STORAGE_H_
+#define _MVCC_STORAGE_H_
+
+#include <atomic>
+#include <utility>
+
+#include "txn/storage.h"
+#include "utils/atomic.h"
+#include "utils/cpu_affinity.h"
+
+using std::pair;
+
+// MVCC 'version' structure
+struct Version {
+  // The value of this version, or the delta if 'delta_'.
+  Value value_;
+
+  // Whether the value is what an Increment() added to the next version.
+  bool delta_;
+
+  // Largest timestamp of a transaction that read the version.
+  std::atomic<uint64> max_read_id_;
+
+  // Timestamp of the transaction that created (wrote) the version.
+  uint64 version_id_;
+
+  // Installed, but not yet in the redo log (see Publish).
+  std::atomic<bool> pending_;
+
+  // Next older version of the same key (or NULL).
+  std::atomic<Version*> next_;
+};
+
+// All versions of one key, kept as a singly linked list sorted newest-first
+// (by version_id_), so a read stops at the first version it can see.
+//
+// Readers never take 'mutex_', which only orders writers (and GC). A
+// writer bumps 'install_seq_' to odd just for its CheckWrite and the
+// install that follows (BeginInstall/EndInstall). A reader records its read
+// by raising max_read_id_ and retries if 'install_seq_' changed meanwhile,
+// which guarantees that either the reader sees the new version or the
+// writer's CheckWrite sees the reader's max_read_id_. Only readers that
+// would see the new version have to wait for an odd 'install_seq_' to end;
+// for the others, publishing the read is enough.
+//
+// The fields are ordered so that they fill exactly one cache line.
+struct VersionList {
+  VersionList()
+      : head_(NULL), installing_(0), install_seq_(0), install_pending_(false) {}
+  std::atomic<Version*> head_;        // Newest version of the key
+  std::atomic<uint64> installing_;    // Timestamp of the installing writer
+  std::atomic<uint32> install_seq_;   // Odd while a writer is installing
+  bool install_pending_;              // Whether it installs pending versions
+  Mutex mutex_;
+} __attribute__((aligned(CACHE_LINE_SIZE)));
+
+static_assert(sizeof(VersionList) == CACHE_LINE_SIZE,
+              "A VersionList must fit in one cache line.");
+
+// MVCC garbage collection statistics
+struct GCStats {
+  uint64 versions_reclaimed_;  // Versions freed by GarbageCollect so far
+  int chain_length_p50_;       // Median number of versions per key
+  int chain_length_p99_;       // 99th percentile number of versions per key
+  int chain_length_max_;       // Longest version_list
+};
+
+// MVCC storage
+class MVCCStorage : public Storage {
+ public:
+  MVCCStorage() : dense_data_(NULL), dense_size_(0), versions_reclaimed_(0) {}
+
+  // If there exists a record for the specified key, sets '*result' equal to
+  // the value associated with the key and returns true, else returns false;
+  // The third parameter is the txn_unique_id(txn timestamp), which is used for MVCC.
+  // Does not need Lock(key): it may run concurrently with Write/GarbageCollect.
+  virtual bool Read(Key key, Value* result, uint64 txn_unique_id = 0);
+
+  // Inserts a new version with key and value
+  // The third parameter is the txn_unique_id(txn timestamp), which is used for MVCC.
+  virtual void Write(Key key, Value value, uint64 txn_unique_id = 0);
+
+  // Inserts a delta version with 'delta' as the value, so that increments
+  // need not see the versions they follow and can be installed in any
+  // order. Reads add up the deltas down to the next full version. Call it
+  // like Write(), after CheckWrite().
+  virtual void Increment(Key key, Value delta, uint64 txn_unique_id = 0);
+
+  // Record versions are only used by OCC.
+  virtual uint64 RecordVersion(Key key) {return 0;}
+
+  // Init storage
+  virtual void InitStorage();
+
+  // Creates the records as the first version (version_id 0) of each key.
+  virtual void BulkLoad(const KeyValue* records, uint64 count);
+
+  // Reads every key as txn_unique_id would, without locking, so writers
+  // carry on meanwhile. Like any MVCC read this raises the versions'
+  // max_read_id_, so writers with smaller ids that have not installed yet
+  // abort.
+  virtual void Snapshot(vector<KeyValue>* records, uint64 txn_unique_id);
+
+  // Lock the version_list of key against other writers. Readers carry on.
+  virtual void Lock(Key key);
+
+  // Unlock the version_list of key
+  virtual void Unlock(Key key);
+
+  // Bracket the CheckWrite and the Write/Increment of key by txn_unique_id,
+  // which must hold Lock(key). Readers with larger timestamps wait for
+  // EndInstall, younger ones do not. If 'pending', the versions installed
+  // meanwhile stay pending, and readers that would see them wait too, until
+  // Publish(key, txn_unique_id); used to keep them unread until their txn's
+  // redo log record is appended.
+  virtual void BeginInstall(Key key, uint64 txn_unique_id, bool pending);
+  virtual void EndInstall(Key key);
+  virtual void Publish(Key key, uint64 txn_unique_id);
+
+  // Check whether apply or abort the write
+  virtual bool CheckWrite (Key key, uint64 txn_unique_id);
+
+  // Unlinks every version of key that is older than the newest version whose
+  // version_id is less than or equal to low_water_mark. No transaction with a
+  // timestamp of at least low_water_mark can read these versions any more.
+  // If that version is a delta, it is replaced by a full version first, so
+  // the deltas of a key that is only ever incremented do not pile up.
+  // Returns the number of versions unlinked.
+  //
+  // Because readers don't lock, unlinked versions are only freed once the
+  // low-water mark has reached the next timestamp 'timestamps' was to hand
+  // out just after they were unlinked. Only txns with smaller timestamps can
+  // have found them, so by then none can still hold a pointer to them.
+  virtual int GarbageCollect(Key key, uint64 low_water_mark,
+                             const TimestampOracle& timestamps);
+
+  // Fills '*stats' with the reclaimed-version counter and the current version
+  // chain length percentiles. Locks every key in turn, so it is slow.
+  void GetGCStats(GCStats* stats);
+
+  virtual ~MVCCStorage();
+
+ protected:
+  // Returns the version list of key, or NULL if the key has never been
+  // written.
+  inline VersionList* _getVersions(Key key) {
+    if (key < dense_size_)
+      return &dense_data_[key];
+    unordered_map<Key, VersionList*>::iterator it = mvcc_data_.find(key);
+    return it == mvcc_data_.end() ? NULL : it->second;
+  }
+
+  // Frees every version in 'versions'.
+  static void _freeVersions(VersionList* versions);
+
+  // Inserts a new version into 'versions', which must be locked, keeping
+  // the list sorted.
+  static void _insertVersion(VersionList* versions, Value value, bool delta,
+                             uint64 txn_unique_id);
+
+  // Returns the value of 'version': its own, plus, for a delta, that of the
+  // next version. Raises the max_read_id_ of every version it adds up to
+  // 'txn_unique_id', as they have all been read.
+  static Value _resolve(Version* version, uint64 txn_unique_id);
+
+  // Allocates/frees 'count' cache-line-aligned, empty VersionLists. With a
+  // non-empty 'affinity' the array is split into one partition per entry,
+  // each placed on the NUMA node of the CPUs in that entry (see
+  // RunPartitioned).
+  static VersionList* _newVersionLists(
+      uint64 count, const vector<cpu_set_t>& affinity = vector<cpu_set_t>());
+  static void _deleteVersionLists(VersionList* lists, uint64 count);
+  static void _initVersionLists(void* lists, uint64 begin, uint64 end);
+
+  // Storage for MVCC, each key has a linklist of versions
+  unordered_map<Key, VersionList*> mvcc_data_;
+
+  // Optional flat array holding the version lists of keys [0, dense_size_),
+  // allocated by subclasses (see MVCCArrayStorage) with _newVersionLists and
+  // freed here. Keys outside the range fall back to 'mvcc_data_'.
+  VersionList* dense_data_;
+  uint64 dense_size_;
+
+ private:
+
+  friend class TxnProcessor;
+
+  // Total number of versions freed by GarbageCollect.
+  Atomic<uint64> versions_reclaimed_;
+
+  // Versions unlinked by GarbageCollect that are waiting to be freed, each
+  // with the low-water mark that must be reached first.
+  deque<pair<uint64, Version*> > retired_;
+  Mutex retired_mutex_;
+};
+
+#endif  // _MVCC_STORAGE_H_
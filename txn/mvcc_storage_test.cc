@@ -0,0 +1,267 @@
+// Author: Kun Ren (kun.ren@yale.edu)
+
+#include "txn/mvcc_storage.h"
+
+#include <pthread.h>
+
+#include "utils/testing.h"
+
+TEST(MVCCStorage_GarbageCollect) {
+  MVCCStorage storage;
+  TimestampOracle timestamps(1);
+  Value result;
+  GCStats stats;
+  timestamps.Reset(50);
+
+  // Versions written by txns 0, 10, 20 and 30.
+  storage.Write(101, 0, 0);
+  storage.Write(101, 1, 10);
+  storage.Write(101, 2, 20);
+  storage.Write(101, 3, 30);
+
+  // Oldest active txn is 25, so it still reads version 20. Versions 0 and 10
+  // can be freed.
+  EXPECT_EQ(2, storage.GarbageCollect(101, 25, timestamps));
+  EXPECT_TRUE(storage.Read(101, &result, 25));
+  EXPECT_EQ(2, result);
+  EXPECT_TRUE(storage.Read(101, &result, 35));
+  EXPECT_EQ(3, result);
+
+  // Nothing more to free at the same low-water mark.
+  EXPECT_EQ(0, storage.GarbageCollect(101, 25, timestamps));
+
+  // Once every txn is past 30, only the newest version is left.
+  EXPECT_EQ(1, storage.GarbageCollect(101, 40, timestamps));
+  EXPECT_TRUE(storage.Read(101, &result, 40));
+  EXPECT_EQ(3, result);
+
+  storage.Write(102, 0, 0);
+  storage.GetGCStats(&stats);
+  EXPECT_EQ(3, stats.versions_reclaimed_);
+  EXPECT_EQ(1, stats.chain_length_p50_);
+  EXPECT_EQ(1, stats.chain_length_max_);
+
+  END;
+}
+
+TEST(MVCCStorage_ReadVisibleVersion) {
+  MVCCStorage storage;
+  Value result;
+
+  // Versions are installed out of timestamp order.
+  storage.Write(101, 0, 0);
+  storage.Write(101, 30, 30);
+  storage.Write(101, 10, 10);
+  storage.Write(101, 20, 20);
+
+  // Each txn sees the newest version no later than its own timestamp.
+  EXPECT_TRUE(storage.Read(101, &result, 5));
+  EXPECT_EQ(0, result);
+  EXPECT_TRUE(storage.Read(101, &result, 10));
+  EXPECT_EQ(10, result);
+  EXPECT_TRUE(storage.Read(101, &result, 29));
+  EXPECT_EQ(20, result);
+  EXPECT_TRUE(storage.Read(101, &result, 100));
+  EXPECT_EQ(30, result);
+
+  // No such key.
+  EXPECT_FALSE(storage.Read(102, &result, 100));
+
+  // Txn 29 read version 20, so txn 25 may no longer write after it. Txn 35
+  // follows version 30, which only txn 100 has read, so it may not either.
+  // Txn 150 follows version 30 as well, and nobody later has read it.
+  storage.Lock(101);
+  EXPECT_FALSE(storage.CheckWrite(101, 25));
+  EXPECT_FALSE(storage.CheckWrite(101, 35));
+  EXPECT_TRUE(storage.CheckWrite(101, 150));
+  storage.Unlock(101);
+
+  END;
+}
+
+TEST(MVCCStorage_Increment) {
+  MVCCStorage storage;
+  TimestampOracle timestamps(1);
+  Value result;
+  timestamps.Reset(50);
+
+  // Deltas on top of a full version, installed out of timestamp order.
+  storage.Write(101, 10, 0);
+  storage.Increment(101, 1, 10);
+  storage.Increment(101, 2, 20);
+  storage.Increment(101, 4, 15);
+
+  // Each txn adds up the deltas it can see.
+  EXPECT_TRUE(storage.Read(101, &result, 5));
+  EXPECT_EQ(10, result);
+  EXPECT_TRUE(storage.Read(101, &result, 10));
+  EXPECT_EQ(11, result);
+  EXPECT_TRUE(storage.Read(101, &result, 15));
+  EXPECT_EQ(15, result);
+  EXPECT_TRUE(storage.Read(101, &result, 25));
+  EXPECT_EQ(17, result);
+
+  // Txn 25 read through every version, so txn 22 may not increment after
+  // version 20. Incrementers read nothing, so txn 30 may.
+  storage.Lock(101);
+  EXPECT_FALSE(storage.CheckWrite(101, 22));
+  EXPECT_TRUE(storage.CheckWrite(101, 30));
+  storage.Unlock(101);
+  storage.Increment(101, 8, 30);
+
+  // The oldest active txn reads the delta of txn 15, which is folded into a
+  // full version; it and the three versions below it are unlinked.
+  EXPECT_EQ(3, storage.GarbageCollect(101, 17, timestamps));
+  EXPECT_TRUE(storage.Read(101, &result, 17));
+  EXPECT_EQ(15, result);
+  EXPECT_TRUE(storage.Read(101, &result, 40));
+  EXPECT_EQ(25, result);
+
+  // A key with no versions yet gets a full one.
+  storage.Increment(102, 3, 0);
+  EXPECT_TRUE(storage.Read(102, &result, 10));
+  EXPECT_EQ(3, result);
+
+  END;
+}
+
+TEST(MVCCStorage_LargeTimestamps) {
+  MVCCStorage storage;
+  TimestampOracle timestamps(1);
+  Value result;
+  const uint64 kBase = (1ull << 31) - 5;
+  timestamps.Reset((1ull << 33) + 1);
+
+  // Versions on both sides of 2^31 and of 2^32 order as timestamps do.
+  storage.Write(101, 1, kBase);
+  storage.Write(101, 2, kBase + 10);
+  storage.Increment(101, 4, (1ull << 32) + 1);
+  EXPECT_TRUE(storage.Read(101, &result, kBase + 5));
+  EXPECT_EQ(1, result);
+  EXPECT_TRUE(storage.Read(101, &result, kBase + 20));
+  EXPECT_EQ(2, result);
+  EXPECT_TRUE(storage.Read(101, &result, 1ull << 33));
+  EXPECT_EQ(6, result);
+  EXPECT_FALSE(storage.Read(101, &result, kBase - 1));
+
+  // The read at 2^33 is remembered in full.
+  storage.Lock(101);
+  EXPECT_FALSE(storage.CheckWrite(101, (1ull << 33) - 1));
+  EXPECT_TRUE(storage.CheckWrite(101, (1ull << 33) + 1));
+  storage.Unlock(101);
+
+  // The delta is folded into a full version, unlinking all three.
+  EXPECT_EQ(3, storage.GarbageCollect(101, 1ull << 33, timestamps));
+  EXPECT_TRUE(storage.Read(101, &result, 1ull << 33));
+  EXPECT_EQ(6, result);
+
+  END;
+}
+
+TEST(MVCCStorage_InstallWindow) {
+  MVCCStorage storage;
+  Value result;
+  storage.Write(101, 1, 10);
+
+  // While txn 50 checks and installs, older readers go ahead (on this
+  // thread, waiting would never end) and are seen by its CheckWrite.
+  storage.Lock(101);
+  storage.BeginInstall(101, 50, true);
+  EXPECT_TRUE(storage.Read(101, &result, 40));
+  EXPECT_EQ(1, result);
+  EXPECT_TRUE(storage.CheckWrite(101, 50));
+  storage.Write(101, 2, 50);
+  EXPECT_FALSE(storage.CheckWrite(101, 30));
+  storage.EndInstall(101);
+
+  // The pending version is still invisible to older readers, and visible
+  // to newer ones once it is published.
+  EXPECT_TRUE(storage.Read(101, &result, 45));
+  EXPECT_EQ(1, result);
+  storage.Publish(101, 50);
+  storage.Unlock(101);
+  EXPECT_TRUE(storage.Read(101, &result, 60));
+  EXPECT_EQ(2, result);
+
+  END;
+}
+
+struct ConcurrentGC {
+  MVCCStorage storage;
+  TimestampOracle timestamps;
+  std::atomic<Value> increments;  // Started, so at least those installed
+  std::atomic<int> incrementers;
+  std::atomic<bool> ok;
+  ConcurrentGC() : timestamps(4), increments(0), incrementers(0), ok(true) {}
+};
+
+// Increments key 101 like MVCCExecuteTxn, collecting garbage each time.
+static void* IncrementAndCollect(void* arg) {
+  ConcurrentGC* test = reinterpret_cast<ConcurrentGC*>(arg);
+  for (int i = 0; i < 20000; i++) {
+    int shard;
+    uint64 id = test->timestamps.Begin(1, &shard);
+    test->storage.Lock(101);
+    test->storage.BeginInstall(101, id, false);
+    if (test->storage.CheckWrite(101, id)) {
+      test->increments++;
+      test->storage.Increment(101, 1, id);
+    }
+    test->storage.EndInstall(101);
+    test->storage.GarbageCollect(101, test->timestamps.LowWaterMark(),
+                                 test->timestamps);
+    test->storage.Unlock(101);
+    test->timestamps.End(id, shard);
+  }
+  test->incrementers--;
+  return NULL;
+}
+
+// Reads key 101 until the incrementers are done. Later txns see at least
+// as many increments, and never more than were installed.
+static void* ReadDeltas(void* arg) {
+  ConcurrentGC* test = reinterpret_cast<ConcurrentGC*>(arg);
+  Value last = 0;
+  while (test->incrementers > 0) {
+    int shard;
+    uint64 id = test->timestamps.Begin(1, &shard);
+    Value value;
+    if (!test->storage.Read(101, &value, id) || value < last ||
+        value > test->increments)
+      test->ok = false;
+    last = value;
+    test->timestamps.End(id, shard);
+  }
+  return NULL;
+}
+
+TEST(MVCCStorage_ConcurrentGarbageCollect) {
+  // Readers walk chains of deltas while they are folded and freed.
+  ConcurrentGC test;
+  test.storage.Write(101, 0, 0);
+  test.incrementers = 2;
+  pthread_t threads[4];
+  for (int i = 0; i < 2; i++)
+    pthread_create(&threads[i], NULL, IncrementAndCollect, &test);
+  for (int i = 2; i < 4; i++)
+    pthread_create(&threads[i], NULL, ReadDeltas, &test);
+  for (int i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+
+  Value result;
+  EXPECT_TRUE(test.ok);
+  EXPECT_TRUE(test.storage.Read(101, &result, test.timestamps.Next()));
+  EXPECT_EQ(test.increments, result);
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  MVCCStorage_GarbageCollect();
+  MVCCStorage_ReadVisibleVersion();
+  MVCCStorage_Increment();
+  MVCCStorage_LargeTimestamps();
+  MVCCStorage_InstallWindow();
+  MVCCStorage_ConcurrentGarbageCollect();
+}
+
@@ -0,0 +1,112 @@
+#include "txn/ordered_index.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+
+// Bytes of node memory allocated at a time.
+#define ORDERED_INDEX_CHUNK_BYTES (1 << 20)
+
+OrderedIndex::OrderedIndex()
+    : height_(1), size_(0), random_(0x0DDBA11), chunk_used_(0) {
+  head_ = _newNode(0, ORDERED_INDEX_MAX_HEIGHT);
+  for (int i = 0; i < ORDERED_INDEX_MAX_HEIGHT; i++)
+    tail_[i] = head_;
+}
+
+OrderedIndex::~OrderedIndex() {
+  for (size_t i = 0; i < chunks_.size(); i++)
+    free(chunks_[i]);
+}
+
+OrderedIndex::Node* OrderedIndex::_newNode(Key key, int height) {
+  size_t bytes = offsetof(Node, next_) + height * sizeof(std::atomic<Node*>);
+  bytes = (bytes + sizeof(Node*) - 1) & ~(sizeof(Node*) - 1);
+  if (chunks_.empty() || chunk_used_ + bytes > ORDERED_INDEX_CHUNK_BYTES) {
+    char* chunk = reinterpret_cast<char*>(malloc(ORDERED_INDEX_CHUNK_BYTES));
+    if (chunk == NULL)
+      DIE("Out of memory allocating an OrderedIndex chunk.");
+    chunks_.push_back(chunk);
+    chunk_used_ = 0;
+  }
+
+  Node* node = reinterpret_cast<Node*>(chunks_.back() + chunk_used_);
+  chunk_used_ += bytes;
+  node->key_ = key;
+  node->height_ = height;
+  for (int i = 0; i < height; i++)
+    new (&node->next_[i]) std::atomic<Node*>(NULL);
+  return node;
+}
+
+int OrderedIndex::_randomHeight() {
+  // Each level has a quarter of the nodes of the one below.
+  int height = 1;
+  uint64 bits = random_.Next();
+  while (height < ORDERED_INDEX_MAX_HEIGHT && (bits & 3) == 0) {
+    height++;
+    bits >>= 2;
+  }
+  return height;
+}
+
+void OrderedIndex::_findPreds(Key key, Node** preds) const {
+  Node* node = head_;
+  for (int level = ORDERED_INDEX_MAX_HEIGHT - 1; level >= 0; level--) {
+    Node* next = node->next_[level].load(std::memory_order_acquire);
+    while (next != NULL && next->key_ < key) {
+      node = next;
+      next = node->next_[level].load(std::memory_order_acquire);
+    }
+    preds[level] = node;
+  }
+}
+
+bool OrderedIndex::Insert(Key key) {
+  insert_mutex_.Lock();
+  Node* preds[ORDERED_INDEX_MAX_HEIGHT];
+  Node* last = tail_[0];
+  if (last == head_ || last->key_ < key) {
+    // Appending: the last node of each level precedes the new one.
+    for (int i = 0; i < ORDERED_INDEX_MAX_HEIGHT; i++)
+      preds[i] = tail_[i];
+  } else {
+    _findPreds(key, preds);
+    Node* next = preds[0]->next_[0].load(std::memory_order_relaxed);
+    if (next != NULL && next->key_ == key) {
+      insert_mutex_.Unlock();
+      return false;
+    }
+  }
+
+  int height = _randomHeight();
+  Node* node = _newNode(key, height);
+  for (int i = 0; i < height; i++) {
+    Node* next = preds[i]->next_[i].load(std::memory_order_relaxed);
+    node->next_[i].store(next, std::memory_order_relaxed);
+    if (next == NULL)
+      tail_[i] = node;
+  }
+  // Bottom level first, so a node reachable at any level is reachable
+  // below it too.
+  for (int i = 0; i < height; i++)
+    preds[i]->next_[i].store(node, std::memory_order_release);
+  if (height > height_.load(std::memory_order_relaxed))
+    height_.store(height, std::memory_order_relaxed);
+  size_++;
+  insert_mutex_.Unlock();
+  return true;
+}
+
+OrderedIndex::Iterator OrderedIndex::Seek(Key key) const {
+  Node* node = head_;
+  for (int level = height_.load(std::memory_order_relaxed) - 1; level >= 0;
+       level--) {
+    Node* next = node->next_[level].load(std::memory_order_acquire);
+    while (next != NULL && next->key_ < key) {
+      node = next;
+      next = node->next_[level].load(std::memory_order_acquire);
+    }
+  }
+  return Iterator(node->next_[0].load(std::memory_order_acquire));
+}
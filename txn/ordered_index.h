@@ -0,0 +1,134 @@
+// Ordered set of keys, for range scans over storage whose records live in
+// hash maps.
+
+#ifndef _ORDERED_INDEX_H_
+#define _ORDERED_INDEX_H_
+
+#include <atomic>
+#include <vector>
+
+#include "txn/common.h"
+#include "utils/mutex.h"
+#include "utils/random.h"
+
+using std::vector;
+
+// Tallest tower of an OrderedIndex node. With a branching factor of 4 this
+// keeps searches logarithmic up to about 4^12 = 16M keys.
+#define ORDERED_INDEX_MAX_HEIGHT 12
+
+// Insert-only skip list of keys. Readers never lock: a node is fully built
+// before the release store that links it in, level by level from the
+// bottom, so a reader following acquire loads sees either the whole node or
+// none of it. Inserts are serialized by a mutex. Keys are never removed,
+// matching storage, which never deletes records.
+//
+// Nodes are carved from large chunks with their tower inline, so a node is
+// a single allocation, and keys inserted in ascending order (e.g. by
+// InitStorage) are appended at the tail without a search.
+class OrderedIndex {
+ private:
+  struct Node;
+
+ public:
+  OrderedIndex();
+  ~OrderedIndex();
+
+  // Position in the index, or past its end.
+  class Iterator {
+   public:
+    Iterator() : node_(NULL) {}
+    bool Valid() const { return node_ != NULL; }
+    Key key() const { return node_->key_; }
+    void Next() { node_ = node_->next_[0].load(std::memory_order_acquire); }
+
+   private:
+    friend class OrderedIndex;
+    explicit Iterator(const Node* node) : node_(node) {}
+    const Node* node_;
+  };
+
+  // Adds key. Returns false if it was already there.
+  bool Insert(Key key);
+
+  // Returns an iterator at the smallest key that is at least 'key'.
+  Iterator Seek(Key key) const;
+
+  bool Contains(Key key) const {
+    Iterator it = Seek(key);
+    return it.Valid() && it.key() == key;
+  }
+
+  uint64 Size() const { return size_.load(); }
+
+ private:
+  struct Node {
+    Key key_;
+    int height_;
+    std::atomic<Node*> next_[1];  // 'height_' links, allocated inline
+  };
+
+  Node* _newNode(Key key, int height);
+  int _randomHeight();
+
+  // Sets preds[i] to the last node at level i whose key is below 'key'.
+  void _findPreds(Key key, Node** preds) const;
+
+  Node* head_;  // Sentinel of full height
+  std::atomic<int> height_;
+  std::atomic<uint64> size_;
+
+  // Last node at each level, for appends.
+  Node* tail_[ORDERED_INDEX_MAX_HEIGHT];
+
+  Mutex insert_mutex_;
+  Random random_;
+
+  // Node memory, freed only with the index.
+  vector<char*> chunks_;
+  size_t chunk_used_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  OrderedIndex(const OrderedIndex&);
+  OrderedIndex& operator=(const OrderedIndex&);
+};
+
+// Visits, in ascending order, every key of a range that may have a record
+// in storage made of a dense array of keys [0, dense_keys) (visited whether
+// or not their records exist) followed by an OrderedIndex of all other keys.
+// Keys inserted into the index meanwhile may or may not be visited.
+class KeyCursor {
+ public:
+  KeyCursor() : next_(0), dense_end_(0), hi_(0) {}
+
+  // Positions the cursor before the first key in [lo, hi).
+  void Seek(Key lo, Key hi, uint64 dense_keys, const OrderedIndex& index) {
+    next_ = lo;
+    dense_end_ = hi < dense_keys ? hi : dense_keys;
+    hi_ = hi;
+    index_ = index.Seek(lo > dense_keys ? lo : dense_keys);
+  }
+
+  // Sets '*key' to the next key and returns true, or returns false if there
+  // is none.
+  bool Next(Key* key) {
+    if (next_ < dense_end_) {
+      *key = next_++;
+      return true;
+    }
+    if (index_.Valid() && index_.key() < hi_) {
+      *key = index_.key();
+      index_.Next();
+      return true;
+    }
+    return false;
+  }
+
+ private:
+  Key next_;       // Next dense key
+  Key dense_end_;  // End of the dense part of the range
+  Key hi_;
+  OrderedIndex::Iterator index_;
+};
+
+#endif  // _ORDERED_INDEX_H_
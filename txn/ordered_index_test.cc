@@ -0,0 +1,103 @@
+#include "txn/ordered_index.h"
+
+#include <pthread.h>
+#include <set>
+
+#include "utils/testing.h"
+
+using std::set;
+
+TEST(OrderedIndex_InsertAndSeek) {
+  OrderedIndex index;
+  EXPECT_FALSE(index.Seek(0).Valid());
+
+  // Appends, then inserts in the middle and at the front.
+  set<Key> keys;
+  for (Key key = 100; key < 200; key += 2)
+    keys.insert(key);
+  for (Key key = 101; key < 200; key += 10)
+    keys.insert(key);
+  keys.insert(5);
+  for (set<Key>::iterator it = keys.begin(); it != keys.end(); ++it)
+    EXPECT_TRUE(index.Insert(*it));
+  EXPECT_FALSE(index.Insert(150));
+  EXPECT_EQ(keys.size(), index.Size());
+  EXPECT_TRUE(index.Contains(111));
+  EXPECT_FALSE(index.Contains(113));
+
+  // Seek lands on the next key, and iteration is in order.
+  OrderedIndex::Iterator it = index.Seek(103);
+  EXPECT_EQ(104, it.key());
+  it = index.Seek(0);
+  for (set<Key>::iterator expected = keys.begin(); expected != keys.end();
+       ++expected) {
+    EXPECT_TRUE(it.Valid());
+    EXPECT_EQ(*expected, it.key());
+    it.Next();
+  }
+  EXPECT_FALSE(it.Valid());
+  EXPECT_FALSE(index.Seek(200).Valid());
+
+  END;
+}
+
+TEST(OrderedIndex_KeyCursor) {
+  OrderedIndex index;
+  index.Insert(12);
+  index.Insert(15);
+  index.Insert(30);
+
+  // Dense keys [0, 10) come first, whether or not they are in the index.
+  KeyCursor cursor;
+  cursor.Seek(8, 20, 10, index);
+  Key key;
+  Key expected[] = {8, 9, 12, 15};
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(cursor.Next(&key));
+    EXPECT_EQ(expected[i], key);
+  }
+  EXPECT_FALSE(cursor.Next(&key));
+
+  cursor.Seek(13, 30, 10, index);
+  EXPECT_TRUE(cursor.Next(&key));
+  EXPECT_EQ(15, key);
+  EXPECT_FALSE(cursor.Next(&key));
+
+  END;
+}
+
+static void* Insert(void* arg) {
+  OrderedIndex* index = reinterpret_cast<OrderedIndex*>(arg);
+  for (Key key = 0; key < 20000; key++)
+    index->Insert((key * 7919) % 20000);
+  return NULL;
+}
+
+TEST(OrderedIndex_ConcurrentReaders) {
+  // Readers scanning while a writer inserts always see ascending keys.
+  OrderedIndex index;
+  pthread_t writer;
+  pthread_create(&writer, NULL, Insert, &index);
+  bool sorted = true;
+  for (int i = 0; i < 200; i++) {
+    Key last = 0;
+    bool first = true;
+    for (OrderedIndex::Iterator it = index.Seek(0); it.Valid(); it.Next()) {
+      if (!first && it.key() <= last)
+        sorted = false;
+      last = it.key();
+      first = false;
+    }
+  }
+  pthread_join(writer, NULL);
+  EXPECT_TRUE(sorted);
+  EXPECT_EQ(20000, index.Size());
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  OrderedIndex_InsertAndSeek();
+  OrderedIndex_KeyCursor();
+  OrderedIndex_ConcurrentReaders();
+}
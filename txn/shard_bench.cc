@@ -0,0 +1,106 @@
+/// @file
+///
+/// Benchmark of ShardedTxnProcessor. Keeps ACTIVE_TXNS read-modify-write
+/// txns in flight for a second at a time, at each of several fractions of
+/// multi-shard txns, and prints throughput, latency and how often
+/// multi-shard attempts timed out and were retried.
+///
+/// Usage: bin/shard_bench [mode] [shards]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include "txn/sharded_txn_processor.h"
+#include "txn/txn_types.h"
+
+using std::vector;
+
+#define ACTIVE_TXNS 100
+#define DB_SIZE 1000000
+#define WRITES_PER_TXN 4
+
+// An RMW of WRITES_PER_TXN keys, all on one shard or spread over as many
+// shards as it has keys, remembering its slot in the benchmark's array.
+class ShardRMW : public RMW {
+ public:
+  void Init(ShardedTxnProcessor* p, bool multi_shard, int slot) {
+    slot_ = slot;
+    Random* random = ThreadRandom();
+    int shard = random->Uniform(p->ShardCount());
+    while (writeset_.size() < WRITES_PER_TXN) {
+      writeset_.insert(p->GlobalKey(shard, random->Uniform(DB_SIZE)));
+      if (multi_shard)
+        shard = (shard + 1) % p->ShardCount();
+    }
+  }
+
+  int slot_;
+};
+
+// Runs one configuration and prints its row.
+static void Run(CCMode mode, int shards, double multi_shard) {
+  ShardedTxnProcessor* p = new ShardedTxnProcessor(mode, shards);
+  Random* random = ThreadRandom();
+
+  ShardRMW* txns = new ShardRMW[ACTIVE_TXNS];
+  double submitted[ACTIVE_TXNS];
+  Txn* batch[ACTIVE_TXNS];
+  vector<double> latencies;
+
+  double start = GetTime();
+  for (int i = 0; i < ACTIVE_TXNS; i++) {
+    txns[i].Init(p, random->NextDouble() < multi_shard, i);
+    submitted[i] = start;
+    batch[i] = &txns[i];
+  }
+  p->NewTxnRequests(batch, ACTIVE_TXNS);
+
+  int pending = ACTIVE_TXNS;
+  while (pending > 0) {
+    size_t count = p->GetTxnResults(batch, ACTIVE_TXNS);
+    double now = GetTime();
+    size_t resubmit = 0;
+    for (size_t i = 0; i < count; i++) {
+      int slot = static_cast<ShardRMW*>(batch[i])->slot_;
+      latencies.push_back(now - submitted[slot]);
+      if (now < start + 1) {
+        txns[slot].Reset();
+        txns[slot].Init(p, random->NextDouble() < multi_shard, slot);
+        submitted[slot] = now;
+        batch[resubmit++] = &txns[slot];
+      } else {
+        pending--;
+      }
+    }
+    p->NewTxnRequests(batch, resubmit);
+  }
+  double end = GetTime();
+
+  ShardedStats stats;
+  p->GetStats(&stats);
+  delete p;
+  delete[] txns;
+
+  sort(latencies.begin(), latencies.end());
+  double p50 = latencies[latencies.size() / 2];
+  double p99 = latencies[latencies.size() * 99 / 100];
+  printf("%.2f\t\t%.0f\t\t%.3f\t%.3f\t", multi_shard,
+         latencies.size() / (end - start), p50 * 1000, p99 * 1000);
+  if (stats.multi_shard_ > 0)
+    printf("%.3f\n", static_cast<double>(stats.retries_) / stats.multi_shard_);
+  else
+    printf("-\n");
+}
+
+int main(int argc, char** argv) {
+  CCMode mode = argc > 1 ? static_cast<CCMode>(atoi(argv[1])) : LOCKING;
+  int shards = argc > 2 ? atoi(argv[2]) : 2;
+
+  printf("multi-shard\ttxns/s\t\tp50(ms)\tp99(ms)\tretries/txn\n");
+  double fractions[] = {0, 0.01, 0.1, 0.5, 1};
+  for (size_t i = 0; i < sizeof(fractions) / sizeof(fractions[0]); i++)
+    Run(mode, shards, fractions[i]);
+  return 0;
+}
@@ -0,0 +1,276 @@
+#include "txn/sharded_txn_processor.h"
+
+#include <sstream>
+
+ShardedTxnProcessor::ShardedTxnProcessor(CCMode mode, int shards,
+                                         ShardingScheme scheme,
+                                         const TxnProcessorConfig& config)
+    : mode_(mode), scheme_(scheme), shard_count_(shards), callback_(this),
+      result_waiters_(0), single_shard_(0), multi_shard_(0), retries_(0) {
+  if (shards < 1)
+    DIE("ShardedTxnProcessor needs at least one shard.");
+  for (int i = 0; i < shard_count_; i++) {
+    TxnProcessorConfig shard_config = config;
+    std::ostringstream suffix;
+    suffix << "." << i;
+    if (!config.log_path_.empty())
+      shard_config.log_path_ += suffix.str();
+    if (!config.checkpoint_path_.empty())
+      shard_config.checkpoint_path_ += suffix.str();
+    shards_.push_back(new TxnProcessor(mode, shard_config));
+  }
+}
+
+ShardedTxnProcessor::~ShardedTxnProcessor() {
+  for (int i = 0; i < shard_count_; i++)
+    delete shards_[i];
+}
+
+int ShardedTxnProcessor::ShardOf(Key key) const {
+  if (scheme_ == HASH_SHARDING)
+    return key % shard_count_;
+  Key shard = key / INIT_STORAGE_SIZE;
+  return shard < static_cast<Key>(shard_count_) ? shard : shard_count_ - 1;
+}
+
+Key ShardedTxnProcessor::LocalKey(Key key) const {
+  if (scheme_ == HASH_SHARDING)
+    return key / shard_count_;
+  return key - static_cast<Key>(ShardOf(key)) * INIT_STORAGE_SIZE;
+}
+
+Key ShardedTxnProcessor::GlobalKey(int shard, Key local) const {
+  if (scheme_ == HASH_SHARDING)
+    return local * shard_count_ + shard;
+  return static_cast<Key>(shard) * INIT_STORAGE_SIZE + local;
+}
+
+void ShardedTxnProcessor::NewTxnRequest(Txn* txn) {
+  NewTxnRequests(&txn, 1);
+}
+
+void ShardedTxnProcessor::NewTxnRequest(Txn* txn, TxnCallback* callback) {
+  txn->callback_ = callback;
+  NewTxnRequests(&txn, 1);
+}
+
+void ShardedTxnProcessor::NewTxnRequests(Txn** txns, size_t count) {
+  vector<vector<Txn*> > batches(shard_count_);
+  for (size_t i = 0; i < count; i++)
+    Split(txns[i], &batches);
+  for (int i = 0; i < shard_count_; i++) {
+    if (!batches[i].empty())
+      shards_[i]->NewTxnRequests(&batches[i][0], batches[i].size());
+  }
+}
+
+void ShardedTxnProcessor::Split(Txn* txn, vector<vector<Txn*> >* batches) {
+  if (!txn->scanset_.empty())
+    DIE("ShardedTxnProcessor does not support scans.");
+
+  // Find the shards the txn touches.
+  vector<bool> touched(shard_count_, false);
+  int shards = 0;
+  const KeySet* sets[] = {&txn->readset_, &txn->writeset_,
+                          &txn->incrementset_};
+  for (int s = 0; s < 3; s++) {
+    for (KeySet::const_iterator it = sets[s]->begin(); it != sets[s]->end();
+         ++it) {
+      int shard = ShardOf(*it);
+      if (!touched[shard]) {
+        touched[shard] = true;
+        shards++;
+      }
+    }
+  }
+  if (shards == 0)
+    DIE("Txn with empty read, write and increment sets.");
+  if (shards > 1 && (mode_ == OCC || mode_ == P_OCC || mode_ == MVCC))
+    DIE("Multi-shard txns need a mode that runs txns under their locks, not "
+        "mode " << mode_ << ".");
+
+  ShardVote* vote = shards > 1 ? new ShardVote(txn) : NULL;
+  vector<ShardPart*> parts(shard_count_, static_cast<ShardPart*>(NULL));
+  for (int i = 0; i < shard_count_; i++) {
+    if (!touched[i])
+      continue;
+    parts[i] = new ShardPart(this, txn, i, vote);
+    parts[i]->callback_ = &callback_;
+    if (vote != NULL)
+      vote->parts_.push_back(parts[i]);
+    (*batches)[i].push_back(parts[i]);
+  }
+
+  KeySet Txn::* part_sets[] = {&Txn::readset_, &Txn::writeset_,
+                               &Txn::incrementset_};
+  for (int s = 0; s < 3; s++) {
+    for (KeySet::const_iterator it = sets[s]->begin(); it != sets[s]->end();
+         ++it)
+      (parts[ShardOf(*it)]->*part_sets[s]).insert(LocalKey(*it));
+  }
+}
+
+void ShardedTxnProcessor::PartCallback::Done(Txn* txn) {
+  processor_->PartDone(static_cast<ShardPart*>(txn));
+}
+
+void ShardedTxnProcessor::PartDone(ShardPart* part) {
+  Txn* txn = part->txn_;
+  ShardVote* vote = part->vote_;
+  if (vote == NULL) {
+    txn->status_ = part->status_;
+    delete part;
+    single_shard_++;
+    Deliver(txn);
+    return;
+  }
+
+  // The last part to finish ends the attempt. Every part has run by now, so
+  // the decision is final.
+  if (vote->done_.fetch_add(1) + 1 < vote->parts_.size())
+    return;
+  ShardVote::Decision decision = vote->decision_;
+  for (size_t i = 0; i < vote->parts_.size(); i++)
+    delete vote->parts_[i];
+  delete vote;
+
+  // Retried txns are resubmitted past the shards' admission limits: this
+  // runs on a shard's thread, which must not wait for room.
+  if (decision == ShardVote::RETRYING) {
+    retries_++;
+    txn->Restart();
+    vector<vector<Txn*> > batches(shard_count_);
+    Split(txn, &batches);
+    for (int i = 0; i < shard_count_; i++) {
+      if (!batches[i].empty())
+        shards_[i]->ResubmitTxnRequests(&batches[i][0], batches[i].size());
+    }
+    return;
+  }
+  txn->status_ = decision == ShardVote::COMMITTING ? COMMITTED : ABORTED;
+  multi_shard_++;
+  Deliver(txn);
+}
+
+void ShardedTxnProcessor::Deliver(Txn* txn) {
+  if (txn->callback_ != NULL) {
+    TxnCallback* callback = txn->callback_;
+    txn->callback_ = NULL;
+    callback->Done(txn);
+    return;
+  }
+  results_.Push(txn);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (result_waiters_.load(std::memory_order_relaxed) > 0)
+    results_ready_.Signal();
+}
+
+Txn* ShardedTxnProcessor::GetTxnResult() {
+  Txn* txn;
+  while (GetTxnResults(&txn, 1) == 0) {}
+  return txn;
+}
+
+size_t ShardedTxnProcessor::GetTxnResults(Txn** results, size_t max,
+                                          double timeout) {
+  size_t count = 0;
+  for (int round = 0; ; round++) {
+    while (count < max && results_.Pop(&results[count]))
+      count++;
+    if (count > 0 || timeout == 0)
+      return count;
+    if (round == RESULT_POLLS_BEFORE_SLEEPING)
+      break;
+    sched_yield();
+  }
+
+  result_waiters_.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  results_ready_.WaitUntil([&]() {
+    while (count < max && results_.Pop(&results[count]))
+      count++;
+    return count > 0;
+  }, timeout);
+  result_waiters_.fetch_sub(1);
+  return count;
+}
+
+void ShardedTxnProcessor::GetStats(ShardedStats* stats) {
+  stats->single_shard_ = single_shard_.load();
+  stats->multi_shard_ = multi_shard_.load();
+  stats->retries_ = retries_.load();
+}
+
+void ShardPart::CopyReads() {
+  for (KeyValueMap::iterator it = reads_.begin(); it != reads_.end(); ++it)
+    txn_->reads_[processor_->GlobalKey(shard_, it->first)] = it->second;
+}
+
+void ShardPart::CopyWrites() {
+  for (KeyValueMap::iterator it = txn_->writes_.begin();
+       it != txn_->writes_.end(); ++it) {
+    if (processor_->ShardOf(it->first) == shard_)
+      Write(processor_->LocalKey(it->first), it->second);
+  }
+  for (KeyValueMap::iterator it = txn_->increments_.begin();
+       it != txn_->increments_.end(); ++it) {
+    if (processor_->ShardOf(it->first) == shard_)
+      Increment(processor_->LocalKey(it->first), it->second);
+  }
+}
+
+void ShardPart::Run() {
+  // A single-shard txn is just its part: OCC and MVCC may run it more than
+  // once, so each attempt starts the client txn afresh.
+  if (vote_ == NULL) {
+    txn_->Restart();
+    CopyReads();
+    txn_->Run();
+    if (txn_->status_ != COMPLETED_C)
+      ABORT;
+    CopyWrites();
+    COMMIT;
+  }
+
+  // Vote, unless an attempt that has already failed is being finished off.
+  // The last part to vote decides for all of them.
+  ShardVote::Decision decision;
+  bool decided = false;
+  vote_->mutex_.Lock();
+  if (vote_->decision_ == ShardVote::UNDECIDED) {
+    CopyReads();
+    if (++vote_->votes_ == vote_->parts_.size()) {
+      txn_->Run();
+      vote_->decision_ = txn_->status_ == COMPLETED_C ? ShardVote::COMMITTING
+                                                      : ShardVote::ABORTING;
+      decided = true;
+    }
+  }
+  decision = vote_->decision_;
+  vote_->mutex_.Unlock();
+
+  if (decided) {
+    vote_->decided_.Broadcast();
+  } else if (decision == ShardVote::UNDECIDED) {
+    // Wait for the other parts, holding this shard's locks, and give the
+    // attempt up if they take too long.
+    ShardVote* vote = vote_;
+    vote->decided_.WaitUntil([vote]() {
+      return vote->decision_ != ShardVote::UNDECIDED;
+    }, SHARD_VOTE_TIMEOUT);
+    vote->mutex_.Lock();
+    if (vote->decision_ == ShardVote::UNDECIDED) {
+      vote->decision_ = ShardVote::RETRYING;
+      decided = true;
+    }
+    decision = vote->decision_;
+    vote->mutex_.Unlock();
+    if (decided)
+      vote->decided_.Broadcast();
+  }
+
+  if (decision != ShardVote::COMMITTING)
+    ABORT;
+  CopyWrites();
+  COMMIT;
+}
@@ -0,0 +1,202 @@
+// Several TxnProcessors acting as one database whose keys are split among
+// them.
+
+#ifndef _SHARDED_TXN_PROCESSOR_H_
+#define _SHARDED_TXN_PROCESSOR_H_
+
+#include <atomic>
+#include <vector>
+
+#include "txn/txn.h"
+#include "txn/txn_processor.h"
+#include "utils/condition.h"
+#include "utils/mpmc_queue.h"
+#include "utils/mutex.h"
+
+using std::vector;
+
+// How keys are assigned to shards. Each shard stores its keys under local
+// keys [0, INIT_STORAGE_SIZE), so the shards together hold
+// shards * INIT_STORAGE_SIZE records in their record arrays.
+enum ShardingScheme {
+  HASH_SHARDING = 0,   // Key k goes to shard k % shards, as local key k / shards
+  RANGE_SHARDING = 1,  // Shard i holds the INIT_STORAGE_SIZE keys from
+                       // i * INIT_STORAGE_SIZE; the last one all keys above
+};
+
+// Seconds a part of a multi-shard txn that holds its locks waits for the
+// other parts to get theirs before the attempt is given up and retried.
+// Parts of different txns can wait for each other across shards, and this
+// is what breaks such cycles.
+#define SHARD_VOTE_TIMEOUT 0.005
+
+// Counters of a ShardedTxnProcessor. See ShardedTxnProcessor::GetStats.
+struct ShardedStats {
+  uint64 single_shard_;  // Finished txns that touched one shard
+  uint64 multi_shard_;   // Finished txns that touched several
+  uint64 retries_;       // Attempts of multi-shard txns given up on timeout
+};
+
+class ShardPart;
+
+// Runs txns over 'shards' TxnProcessors, all in the same CC mode, each
+// owning its own storage, thread pool and scheduler. Client txns name
+// global keys; the processor splits each one into a part per shard it
+// touches, with the keys translated to that shard's local keys, and runs
+// the part there as an ordinary txn.
+//
+// A txn that touches a single shard is simply run by it, under its CC
+// mode. A multi-shard txn commits by two-phase commit: each part takes its
+// locks on its shard, reads its keys and then votes by handing the reads
+// over. The last part to vote runs the client txn's logic on all the reads
+// and decides; every part then applies its shard's share of the writes (or
+// none) and finishes, releasing its locks. Parts thus hold their locks
+// across the whole protocol, so multi-shard txns need a mode that runs txns
+// under their locks: every mode except OCC, P_OCC and MVCC. A part that
+// waits longer than SHARD_VOTE_TIMEOUT for a decision gives the attempt up,
+// and the txn is run again from the start.
+//
+// The parts going to one shard are submitted together, one
+// TxnProcessor::NewTxnRequests() call per shard for each NewTxnRequests()
+// batch. Scans are not supported. In durable mode each shard logs its own
+// parts; there are no prepare records, so recovery does not restore the
+// atomicity of a multi-shard txn that was committing during a crash.
+class ShardedTxnProcessor {
+ public:
+  // Starts 'shards' TxnProcessors running 'mode' with 'config'. Shard i
+  // suffixes the config's log and checkpoint paths with ".<i>".
+  ShardedTxnProcessor(CCMode mode, int shards,
+                      ShardingScheme scheme = HASH_SHARDING,
+                      const TxnProcessorConfig& config = TxnProcessorConfig());
+
+  // Stops every shard. Txns still in flight are not freed.
+  ~ShardedTxnProcessor();
+
+  // Registers a new txn request, as TxnProcessor::NewTxnRequest does, with
+  // its outcome going to GetTxnResult() or to 'callback'.
+  void NewTxnRequest(Txn* txn);
+  void NewTxnRequest(Txn* txn, TxnCallback* callback);
+
+  // Registers the 'count' txn requests in 'txns', submitting the parts that
+  // go to each shard in one batch.
+  void NewTxnRequests(Txn** txns, size_t count);
+
+  // As TxnProcessor::GetTxnResult() and GetTxnResults().
+  Txn* GetTxnResult();
+  size_t GetTxnResults(Txn** results, size_t max, double timeout = -1);
+
+  // Shard of 'key', its local key there, and the global key of local key
+  // 'local' of shard 'shard'.
+  int ShardOf(Key key) const;
+  Key LocalKey(Key key) const;
+  Key GlobalKey(int shard, Key local) const;
+
+  int ShardCount() const { return shard_count_; }
+
+  // The TxnProcessor of shard 'i', e.g. for its stats.
+  TxnProcessor* Shard(int i) { return shards_[i]; }
+
+  // Fills '*stats' with the counters of the txns finished so far.
+  void GetStats(ShardedStats* stats);
+
+ private:
+  friend class ShardPart;
+
+  // Receives every part when its shard has finished it.
+  class PartCallback : public TxnCallback {
+   public:
+    explicit PartCallback(ShardedTxnProcessor* processor)
+        : processor_(processor) {}
+    virtual void Done(Txn* txn);
+
+   private:
+    ShardedTxnProcessor* processor_;
+  };
+
+  // Splits 'txn' into parts and appends each to 'batches' at its shard.
+  void Split(Txn* txn, vector<vector<Txn*> >* batches);
+
+  // Called with each part its shard has finished. Finishes the client txn
+  // once all of its parts are done, or runs it again.
+  void PartDone(ShardPart* part);
+
+  // Hands a finished client txn to its callback or to 'results_'.
+  void Deliver(Txn* txn);
+
+  CCMode mode_;
+  ShardingScheme scheme_;
+  int shard_count_;
+  vector<TxnProcessor*> shards_;
+  PartCallback callback_;
+
+  // Finished client txns not taken by GetTxnResults() yet, and the wakeup
+  // of clients waiting for them (as in TxnProcessor).
+  MPMCQueue<Txn*> results_;
+  Condition results_ready_;
+  std::atomic<int> result_waiters_;
+
+  std::atomic<uint64> single_shard_;
+  std::atomic<uint64> multi_shard_;
+  std::atomic<uint64> retries_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  ShardedTxnProcessor(const ShardedTxnProcessor&);
+  ShardedTxnProcessor& operator=(const ShardedTxnProcessor&);
+};
+
+// One attempt of a multi-shard txn, shared by its parts. Guarded by
+// 'mutex_', except for 'parts_', which is fixed, and 'done_'.
+struct ShardVote {
+  enum Decision { UNDECIDED, COMMITTING, ABORTING, RETRYING };
+
+  explicit ShardVote(Txn* txn)
+      : txn_(txn), decided_(&mutex_), votes_(0), decision_(UNDECIDED),
+        done_(0) {}
+
+  Txn* txn_;  // The client txn
+  vector<ShardPart*> parts_;
+  Mutex mutex_;
+  Condition decided_;  // Signalled once 'decision_' is set
+  size_t votes_;       // Parts that hold their locks and have read
+  Decision decision_;
+  std::atomic<size_t> done_;  // Parts finished by their shards
+};
+
+// The part of a client txn that runs on one shard, with the client txn's
+// keys of that shard, translated to local keys, as its read, write and
+// increment sets.
+class ShardPart : public Txn {
+ public:
+  // 'vote' is NULL for the only part of a single-shard txn.
+  ShardPart(ShardedTxnProcessor* processor, Txn* txn, int shard,
+            ShardVote* vote)
+      : processor_(processor), txn_(txn), shard_(shard), vote_(vote) {
+    two_phase_ = vote != NULL;
+  }
+
+  ShardPart* clone() const {
+    DIE("ShardParts cannot be cloned.");
+    return NULL;
+  }
+
+  // Runs the client txn on this part's reads (single-shard), or votes and
+  // waits for the decision (multi-shard), then writes this shard's share of
+  // the client txn's writes.
+  virtual void Run();
+
+ private:
+  friend class ShardedTxnProcessor;
+
+  // Copies the reads into the client txn, under their global keys.
+  void CopyReads();
+
+  // Applies the client txn's writes and increments of this shard.
+  void CopyWrites();
+
+  ShardedTxnProcessor* processor_;
+  Txn* txn_;
+  int shard_;
+  ShardVote* vote_;
+};
+
+#endif  // _SHARDED_TXN_PROCESSOR_H_
@@ -0,0 +1,167 @@
+#include "txn/sharded_txn_processor.h"
+
+#include "txn/txn_types.h"
+#include "utils/testing.h"
+
+// Moves 'amount' from record 'from' to record 'to', or aborts if 'from'
+// holds less than that.
+class Transfer : public Txn {
+ public:
+  Transfer(Key from, Key to, Value amount)
+      : from_(from), to_(to), amount_(amount) {
+    writeset_.insert(from);
+    writeset_.insert(to);
+  }
+
+  Transfer* clone() const {
+    Transfer* clone = new Transfer(from_, to_, amount_);
+    this->CopyTxnInternals(clone);
+    return clone;
+  }
+
+  virtual void Run() {
+    Value from = 0;
+    Value to = 0;
+    Read(from_, &from);
+    Read(to_, &to);
+    if (from < amount_)
+      ABORT;
+    Write(from_, from - amount_);
+    Write(to_, to + amount_);
+    COMMIT;
+  }
+
+ private:
+  Key from_;
+  Key to_;
+  Value amount_;
+};
+
+// Runs 'txn' to completion on 'p' and returns its status.
+static TxnStatus RunTxn(ShardedTxnProcessor* p, Txn* txn) {
+  p->NewTxnRequest(txn);
+  p->GetTxnResult();
+  return txn->Status();
+}
+
+TEST(ShardedTxnProcessor_KeyMapping) {
+  ShardedTxnProcessor hash(SERIAL, 3, HASH_SHARDING);
+  EXPECT_EQ(1, hash.ShardOf(7));
+  EXPECT_EQ(2, hash.LocalKey(7));
+  ShardedTxnProcessor range(SERIAL, 3, RANGE_SHARDING);
+  EXPECT_EQ(0, range.ShardOf(INIT_STORAGE_SIZE - 1));
+  EXPECT_EQ(1, range.ShardOf(INIT_STORAGE_SIZE));
+  EXPECT_EQ(2, range.ShardOf(5 * INIT_STORAGE_SIZE));
+  EXPECT_EQ(3 * INIT_STORAGE_SIZE, range.LocalKey(5 * INIT_STORAGE_SIZE));
+
+  Key keys[] = {0, 7, INIT_STORAGE_SIZE + 3, 3 * INIT_STORAGE_SIZE - 1};
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(keys[i], hash.GlobalKey(hash.ShardOf(keys[i]),
+                                      hash.LocalKey(keys[i])));
+    EXPECT_EQ(keys[i], range.GlobalKey(range.ShardOf(keys[i]),
+                                       range.LocalKey(keys[i])));
+  }
+
+  END;
+}
+
+TEST(ShardedTxnProcessor_SingleShard) {
+  const int kTxns = 200;
+  Txn* txns[kTxns];
+  for (int mode = SERIAL; mode <= ADAPTIVE; mode++) {
+    ShardedTxnProcessor p(static_cast<CCMode>(mode), 2);
+    Put reset0(map<Key, Value>{{0, 0}, {2, 0}});
+    EXPECT_EQ(COMMITTED, RunTxn(&p, &reset0));
+    Put reset1(map<Key, Value>{{1, 0}, {3, 0}});
+    EXPECT_EQ(COMMITTED, RunTxn(&p, &reset1));
+
+    for (int j = 0; j < kTxns; j++)
+      txns[j] = new RMW(j % 2 == 0 ? set<Key>{0, 2} : set<Key>{1, 3});
+    p.NewTxnRequests(txns, kTxns);
+    for (int done = 0; done < kTxns; )
+      done += p.GetTxnResults(txns + done, kTxns - done);
+    for (int j = 0; j < kTxns; j++) {
+      EXPECT_EQ(COMMITTED, txns[j]->Status());
+      delete txns[j];
+    }
+
+    Expect expect0(map<Key, Value>{{0, kTxns / 2}, {2, kTxns / 2}});
+    EXPECT_EQ(COMMITTED, RunTxn(&p, &expect0));
+    Expect expect1(map<Key, Value>{{1, kTxns / 2}, {3, kTxns / 2}});
+    EXPECT_EQ(COMMITTED, RunTxn(&p, &expect1));
+    ShardedStats stats;
+    p.GetStats(&stats);
+    EXPECT_EQ(0, stats.multi_shard_);
+  }
+
+  END;
+}
+
+TEST(ShardedTxnProcessor_MultiShard) {
+  const int kTxns = 300;
+  Txn* txns[kTxns];
+  CCMode modes[] = {SERIAL, LOCKING_EXCLUSIVE_ONLY, LOCKING,
+                    LOCKING_PARTITIONED, CALVIN, ADAPTIVE};
+  for (int m = 0; m < 6; m++) {
+    for (int scheme = HASH_SHARDING; scheme <= RANGE_SHARDING; scheme++) {
+      ShardedTxnProcessor p(modes[m], 2, static_cast<ShardingScheme>(scheme));
+
+      // Four accounts, two on each shard, such that every transfer below
+      // moves money between shards.
+      Key accounts[4];
+      for (int i = 0; i < 4; i++)
+        accounts[i] = p.GlobalKey(i % 2, i / 2);
+      map<Key, Value> balances;
+      for (int i = 0; i < 4; i++)
+        balances[accounts[i]] = 100;
+      Put reset(balances);
+      EXPECT_EQ(COMMITTED, RunTxn(&p, &reset));
+
+      // Every tenth transfer asks for more than any account holds and
+      // aborts; the others move 1 each.
+      for (int j = 0; j < kTxns; j++) {
+        Key from = accounts[j % 4];
+        Key to = accounts[(j + 1) % 4];
+        txns[j] = new Transfer(from, to, j % 10 == 0 ? 1000 : 1);
+        if (j % 10 != 0) {
+          balances[from]--;
+          balances[to]++;
+        }
+      }
+      p.NewTxnRequests(txns, kTxns);
+      for (int done = 0; done < kTxns; )
+        done += p.GetTxnResults(txns + done, kTxns - done);
+      int aborted = 0;
+      for (int j = 0; j < kTxns; j++) {
+        if (txns[j]->Status() == ABORTED)
+          aborted++;
+        else
+          EXPECT_EQ(COMMITTED, txns[j]->Status());
+        delete txns[j];
+      }
+      EXPECT_EQ(kTxns / 10, aborted);
+
+      Expect expect(balances);
+      EXPECT_EQ(COMMITTED, RunTxn(&p, &expect));
+      ShardedStats stats;
+      p.GetStats(&stats);
+      EXPECT_EQ(kTxns + 2, stats.multi_shard_);
+      EXPECT_EQ(0, stats.single_shard_);
+
+      // Multi-shard txns with a callback are handed to it.
+      TxnFuture future;
+      Transfer transfer(accounts[0], accounts[1], 1);
+      p.NewTxnRequest(&transfer, &future);
+      EXPECT_EQ(&transfer, future.Get());
+      EXPECT_EQ(COMMITTED, transfer.Status());
+    }
+  }
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  ShardedTxnProcessor_KeyMapping();
+  ShardedTxnProcessor_SingleShard();
+  ShardedTxnProcessor_MultiShard();
+}
@@ -1,32 +1,65 @@
-// Author: Alexander Thomson (thomson@cs.yale.edu)
-// Modified by: Kun Ren (kun.ren@yale.edu)
-
-#include "txn/storage.h"
-
-bool Storage::Read(Key key, Value* result, int txn_unique_id) {
-  if (data_.count(key)) {
-    *result = data_[key];
-    return true;
-  } else {
-    return false;
-  }
-}
-
-// Write value and timestamps
-void Storage::Write(Key key, Value value, int txn_unique_id) {
-  data_[key] = value;
-  timestamps_[key] = GetTime();
-}
-
-double Storage::Timestamp(Key key) {
-  if (timestamps_.count(key) == 0)
-    return 0;
-  return timestamps_[key];
-}
-
-// Init the storage
-void Storage::InitStorage() {
-  for (int i = 0; i < 1000000;i++) {
-    Write(i, 0, 0);
-  } 
-}
+// Author: Alexander Thomson (thomson@cs.yale.edu)
+// Modified by: Kun Ren (kun.ren@yale.edu)
+
+#include "txn/storage.h"
+
+bool Storage::Read(Key key, Value* result, uint64 txn_unique_id) {
+  unordered_map<Key, Value>::const_iterator it = data_.find(key);
+  if (it == data_.end())
+    return false;
+  *result = it->second;
+  return true;
+}
+
+// Write value and bump the version
+void Storage::Write(Key key, Value value, uint64 txn_unique_id) {
+  data_[key] = value;
+  if (versions_[key]++ == 0)
+    index_.Insert(key);
+}
+
+void Storage::Increment(Key key, Value delta, uint64 txn_unique_id) {
+  Value value = 0;
+  Read(key, &value, txn_unique_id);
+  Write(key, value + delta, txn_unique_id);
+}
+
+uint64 Storage::RecordVersion(Key key) {
+  unordered_map<Key, uint64>::const_iterator it = versions_.find(key);
+  return it == versions_.end() ? 0 : it->second;
+}
+
+bool Storage::ReadVersion(Key key, Value* result, uint64* version) {
+  *version = RecordVersion(key);
+  return Read(key, result);
+}
+
+// Init the storage. Every record starts at version 1, and the maps are sized
+// up front so that they are not rehashed along the way.
+void Storage::InitStorage() {
+  data_.rehash(INIT_STORAGE_SIZE);
+  versions_.rehash(INIT_STORAGE_SIZE);
+  for (int i = 0; i < INIT_STORAGE_SIZE;i++) {
+    data_[i] = 0;
+    versions_[i] = 1;
+    index_.Insert(i);
+  }
+}
+
+void Storage::BulkLoad(const KeyValue* records, uint64 count) {
+  data_.rehash(count);
+  versions_.rehash(count);
+  for (uint64 i = 0; i < count; i++) {
+    data_[records[i].key_] = records[i].value_;
+    versions_[records[i].key_] = 1;
+    index_.Insert(records[i].key_);
+  }
+}
+
+void Storage::Snapshot(vector<KeyValue>* records, uint64 txn_unique_id) {
+  for (unordered_map<Key, Value>::const_iterator it = data_.begin();
+       it != data_.end(); ++it) {
+    KeyValue record = {it->first, it->second};
+    records->push_back(record);
+  }
+}
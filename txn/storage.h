@@ -1,60 +1,124 @@
-// Author: Alexander Thomson (thomson@cs.yale.edu)
-// Modified by: Kun Ren (kun.ren@yale.edu)
-
-#ifndef _STORAGE_H_
-#define _STORAGE_H_
-
-#include <limits.h>
-#include <tr1/unordered_map>
-#include <deque>
-#include <map>
-
-#include "txn/common.h"
-#include "txn/txn.h"
-#include "utils/mutex.h"
-
-using std::tr1::unordered_map;
-using std::deque;
-using std::map;
-
-
-class Storage {
- public:
-  // If there exists a record for the specified key, sets '*result' equal to
-  // the value associated with the key and returns true, else returns false;
-  // Note that the third parameter is only used for MVCC, the default vaule is 0.
-  virtual bool Read(Key key, Value* result, int txn_unique_id = 0);
-
-  // Inserts the record <key, value>, replacing any previous record with the
-  // same key.
-  // Note that the third parameter is only used for MVCC, the default vaule is 0.
-  virtual void Write(Key key, Value value, int txn_unique_id = 0);
-
-  // Returns the timestamp at which the record with the specified key was last
-  // updated (returns 0 if the record has never been updated). This is used for OCC.
-  virtual double Timestamp(Key key);
-  
-  // Init storage
-  virtual void InitStorage();
-  
-  virtual ~Storage() {}
-  
-  // The following methods are only used for MVCC
-  virtual void Lock(Key key) {}
-  
-  virtual void Unlock(Key key) {}
-  
-  virtual bool CheckWrite (Key key, int txn_unique_id) {return true;}
-   
- private:
- 
-   friend class TxnProcessor;
-   
-   // Collection of <key, value> pairs. Use this for single-version storage
-   unordered_map<Key, Value> data_;
-  
-   // Timestamps at which each key was last updated.
-   unordered_map<Key, double> timestamps_;
-};
-
-#endif  // _STORAGE_H_
+// Author: Alexander Thomson (thomson@cs.yale.edu)
+// Modified by: Kun Ren (kun.ren@yale.edu)
+
+#ifndef _STORAGE_H_
+#define _STORAGE_H_
+
+#include <limits.h>
+#include <tr1/unordered_map>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "txn/common.h"
+#include "txn/ordered_index.h"
+#include "txn/timestamp_oracle.h"
+#include "txn/txn.h"
+#include "utils/mutex.h"
+
+using std::tr1::unordered_map;
+using std::deque;
+using std::map;
+using std::vector;
+
+// Number of records (keys 0 to INIT_STORAGE_SIZE - 1) created by InitStorage.
+#define INIT_STORAGE_SIZE 1000000
+
+// The TxnProcessor can store records in hash maps, which work for any keys,
+// or in flat arrays indexed by key, which are faster for dense integer keys
+// (see txn/array_storage.h).
+enum StorageType {
+  HASH_STORAGE = 0,   // Storage / MVCCStorage
+  ARRAY_STORAGE = 1,  // ArrayStorage / MVCCArrayStorage
+};
+
+class Storage {
+ public:
+  Storage() : dense_keys_(0) {}
+
+  // If there exists a record for the specified key, sets '*result' equal to
+  // the value associated with the key and returns true, else returns false;
+  // Note that the third parameter is only used for MVCC, the default vaule is 0.
+  virtual bool Read(Key key, Value* result, uint64 txn_unique_id = 0);
+
+  // Inserts the record <key, value>, replacing any previous record with the
+  // same key.
+  // Note that the third parameter is only used for MVCC, the default vaule is 0.
+  virtual void Write(Key key, Value value, uint64 txn_unique_id = 0);
+
+  // Adds 'delta' to the record with the specified key, creating it at
+  // 'delta' if there is none. Like Write(), it must not run concurrently
+  // with another write of the key; MVCC storage lifts that for increments.
+  // Note that the third parameter is only used for MVCC, the default vaule is 0.
+  virtual void Increment(Key key, Value delta, uint64 txn_unique_id = 0);
+
+  // Returns the version of the record with the specified key: 0 if it does
+  // not exist, and one more after every Write(). This is used for OCC.
+  virtual uint64 RecordVersion(Key key);
+
+  // Like Read(), also setting '*version' to the record's version (0 if it
+  // does not exist). The version is read before the value, so if a writer
+  // changed the value meanwhile, the version no longer matches afterwards.
+  virtual bool ReadVersion(Key key, Value* result, uint64* version);
+
+  // Starts loading the record with the specified key into the cache.
+  virtual void Prefetch(Key key) {}
+
+  // Positions '*cursor' to visit, in key order, every key in [lo, hi) that
+  // may have a record; Read() tells which do. Safe while other threads
+  // write, including writes that create records.
+  void SeekKeys(Key lo, Key hi, KeyCursor* cursor) const {
+    cursor->Seek(lo, hi, dense_keys_, index_);
+  }
+  
+  // Init storage
+  virtual void InitStorage();
+
+  // Creates the 'count' records at 'records' like InitStorage, e.g. from a
+  // checkpoint. Only called before any txn runs.
+  virtual void BulkLoad(const KeyValue* records, uint64 count);
+
+  // Appends every record visible to txn_unique_id to '*records'. Only MVCC
+  // storage reads a snapshot, which may be taken while txns are running; the
+  // single-version backends must not be written meanwhile.
+  virtual void Snapshot(vector<KeyValue>* records, uint64 txn_unique_id);
+  
+  virtual ~Storage() {}
+  
+  // The following methods are only used for MVCC
+  virtual void Lock(Key key) {}
+  
+  virtual void Unlock(Key key) {}
+
+  virtual void BeginInstall(Key key, uint64 txn_unique_id, bool pending) {}
+
+  virtual void EndInstall(Key key) {}
+
+  virtual void Publish(Key key, uint64 txn_unique_id) {}
+  
+  virtual bool CheckWrite (Key key, uint64 txn_unique_id) {return true;}
+
+  virtual int GarbageCollect(Key key, uint64 low_water_mark,
+                             const TimestampOracle& timestamps) {
+    return 0;
+  }
+
+ protected:
+  // Every key outside [0, dense_keys_) that has a record. Subclasses that
+  // keep keys [0, dense_keys_) in an array (see txn/array_storage.h) leave
+  // those out; SeekKeys() visits them all.
+  OrderedIndex index_;
+  uint64 dense_keys_;
+
+ private:
+ 
+   friend class TxnProcessor;
+   
+   // Collection of <key, value> pairs. Use this for single-version storage
+   unordered_map<Key, Value> data_;
+  
+   // Version of each key (see RecordVersion()).
+   unordered_map<Key, uint64> versions_;
+};
+
+#endif  // _STORAGE_H_
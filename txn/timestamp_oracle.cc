@@ -0,0 +1,85 @@
+#include "txn/timestamp_oracle.h"
+
+#include <algorithm>
+
+TimestampOracle::TimestampOracle(int shards)
+    : next_(1), shard_count_(shards), low_water_mark_(0), cached_calls_(0) {
+  if (shards < 1)
+    DIE("TimestampOracle needs at least one shard.");
+  shards_ = new Shard[shard_count_];
+}
+
+TimestampOracle::~TimestampOracle() {
+  delete[] shards_;
+}
+
+// Taking the timestamps while holding the shard lock is what makes
+// LowWaterMark() safe: a scan that visits the shard first read Peek()
+// before this lock was taken, so it is no larger than the new timestamps.
+uint64 TimestampOracle::Begin(uint64 count, int* shard) {
+  *shard = ThreadRandom()->Uniform(shard_count_);
+  Shard* s = &shards_[*shard];
+  s->mutex_.Lock();
+  if (s->active_.size() + count > s->active_.capacity()) {
+    // Squeeze out the ended timestamps before growing.
+    vector<uint64>::iterator end = s->active_.begin();
+    for (size_t i = s->begin_; i < s->active_.size(); i++) {
+      if (!(s->active_[i] & TIMESTAMP_ENDED))
+        *end++ = s->active_[i];
+    }
+    s->active_.erase(end, s->active_.end());
+    s->begin_ = 0;
+  }
+  uint64 timestamp = next_.fetch_add(count);
+  for (uint64 i = 0; i < count; i++)
+    s->active_.push_back(timestamp + i);
+  s->mutex_.Unlock();
+  return timestamp;
+}
+
+static bool EarlierTimestamp(uint64 entry, uint64 timestamp) {
+  return (entry & ~TIMESTAMP_ENDED) < timestamp;
+}
+
+void TimestampOracle::End(uint64 timestamp, int shard) {
+  DCHECK(shard >= 0 && shard < shard_count_);
+  Shard* s = &shards_[shard];
+  s->mutex_.Lock();
+  vector<uint64>::iterator it =
+      std::lower_bound(s->active_.begin() + s->begin_, s->active_.end(),
+                       timestamp, EarlierTimestamp);
+  DCHECK(it != s->active_.end() && *it == timestamp);
+  *it |= TIMESTAMP_ENDED;
+  while (s->begin_ < s->active_.size() &&
+         (s->active_[s->begin_] & TIMESTAMP_ENDED))
+    s->begin_++;
+  if (s->begin_ == s->active_.size()) {
+    s->active_.clear();
+    s->begin_ = 0;
+  }
+  s->mutex_.Unlock();
+}
+
+uint64 TimestampOracle::LowWaterMark() {
+  uint64 low_water_mark = next_.load();
+  for (int i = 0; i < shard_count_; i++) {
+    shards_[i].mutex_.Lock();
+    Shard* s = &shards_[i];
+    if (s->begin_ < s->active_.size() &&
+        s->active_[s->begin_] < low_water_mark)
+      low_water_mark = s->active_[s->begin_];
+    shards_[i].mutex_.Unlock();
+  }
+
+  // Concurrent scans may finish out of order; keep the largest.
+  uint64 cached = low_water_mark_.load();
+  while (cached < low_water_mark &&
+         !low_water_mark_.compare_exchange_weak(cached, low_water_mark)) {}
+  return low_water_mark;
+}
+
+uint64 TimestampOracle::CachedLowWaterMark() {
+  if (cached_calls_.fetch_add(1) % LOW_WATER_MARK_REFRESH == 0)
+    return LowWaterMark();
+  return low_water_mark_.load();
+}
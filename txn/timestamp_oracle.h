@@ -0,0 +1,83 @@
+// Txn timestamps and the set of timestamps still in use.
+
+#ifndef _TIMESTAMP_ORACLE_H_
+#define _TIMESTAMP_ORACLE_H_
+
+#include <atomic>
+#include <vector>
+
+#include "txn/common.h"
+#include "utils/mutex.h"
+
+using std::vector;
+
+// Number of CachedLowWaterMark() calls served by each LowWaterMark() scan.
+#define LOW_WATER_MARK_REFRESH 64
+
+// Flag of timestamps that have ended in a TimestampOracle shard.
+#define TIMESTAMP_ENDED (1ULL << 63)
+
+// Hands out timestamps from a single atomic counter, so taking one costs a
+// fetch-add. Timestamps that must stay visible (those of running MVCC txns
+// and snapshots) are registered as active in one of several independently
+// locked shards, picked at random, so threads beginning and ending txns
+// rarely share a lock. Only LowWaterMark() visits every shard.
+class TimestampOracle {
+ public:
+  // 'shards' is the number of active sets; at least 1.
+  explicit TimestampOracle(int shards);
+  ~TimestampOracle();
+
+  // Returns the first of 'count' consecutive new timestamps.
+  uint64 Next(uint64 count = 1) { return next_.fetch_add(count); }
+
+  // Returns the timestamp Next() would return, without taking it.
+  uint64 Peek() const { return next_.load(); }
+
+  // Makes 'next' the next timestamp handed out. Only for use while no other
+  // thread is using the oracle (e.g. during recovery).
+  void Reset(uint64 next) { next_ = next; }
+
+  // Like Next(), and registers the timestamps as active until each is passed
+  // to End(), along with the shard returned in '*shard'.
+  uint64 Begin(uint64 count, int* shard);
+  void End(uint64 timestamp, int shard);
+
+  // Returns a timestamp no larger than any active one or any one handed out
+  // later: the oldest active timestamp, or Peek() if there is none. Locks
+  // every shard in turn.
+  uint64 LowWaterMark();
+
+  // Returns what LowWaterMark() returned recently, rescanning every
+  // LOW_WATER_MARK_REFRESH calls. Low water marks only grow, so a stale one
+  // is still a safe bound, just a less tight one.
+  uint64 CachedLowWaterMark();
+
+ private:
+  // The timestamps a shard registered, in increasing order, since Begin()
+  // takes them under the shard's lock. End() marks its timestamp with
+  // TIMESTAMP_ENDED in place. Ended ones are skipped over ('begin_') as the
+  // front reaches them, and squeezed out when the vector is full, so once it
+  // has grown to the number of timestamps active at once nothing allocates.
+  struct Shard {
+    Shard() : begin_(0) {}
+    Mutex mutex_;
+    vector<uint64> active_;
+    size_t begin_;  // First entry that has not ended, or active_.size()
+  };
+
+  std::atomic<uint64> next_;
+  Shard* shards_;
+  int shard_count_;
+
+  // Latest LowWaterMark() result, and the call counter that schedules the
+  // next scan.
+  std::atomic<uint64> low_water_mark_;
+  std::atomic<uint64> cached_calls_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  TimestampOracle(const TimestampOracle&);
+  TimestampOracle& operator=(const TimestampOracle&);
+};
+
+#endif  // _TIMESTAMP_ORACLE_H_
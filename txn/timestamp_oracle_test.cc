@@ -0,0 +1,90 @@
+#include "txn/timestamp_oracle.h"
+
+#include <pthread.h>
+
+#include "utils/testing.h"
+
+TEST(TimestampOracle_LowWaterMark) {
+  TimestampOracle oracle(4);
+  EXPECT_EQ(1, oracle.Next());
+  EXPECT_EQ(2, oracle.Next(3));
+  EXPECT_EQ(5, oracle.Peek());
+  EXPECT_EQ(5, oracle.LowWaterMark());
+
+  int a, b;
+  EXPECT_EQ(5, oracle.Begin(2, &a));  // 5 and 6
+  EXPECT_EQ(7, oracle.Begin(1, &b));
+  EXPECT_EQ(5, oracle.LowWaterMark());
+  oracle.End(5, a);
+  EXPECT_EQ(6, oracle.LowWaterMark());
+  oracle.End(6, a);
+  EXPECT_EQ(7, oracle.LowWaterMark());
+  oracle.End(7, b);
+  EXPECT_EQ(8, oracle.LowWaterMark());
+
+  oracle.Reset(100);
+  EXPECT_EQ(100, oracle.Next());
+
+  END;
+}
+
+TEST(TimestampOracle_OutOfOrderEnds) {
+  TimestampOracle oracle(1);
+  int shard;
+  uint64 oldest = oracle.Begin(1, &shard);
+
+  // Every other timestamp ends while the oldest is held, many times over
+  // what the shard first had room for.
+  for (int round = 0; round < 100; round++) {
+    uint64 first = oracle.Begin(10, &shard);
+    for (uint64 i = 0; i < 10; i += 2)
+      oracle.End(first + i, shard);
+    EXPECT_EQ(oldest, oracle.LowWaterMark());
+  }
+  oracle.End(oldest, shard);
+  EXPECT_EQ(3, oracle.LowWaterMark());
+  for (uint64 timestamp = 3; timestamp < oracle.Peek(); timestamp += 2) {
+    oracle.End(timestamp, shard);
+    EXPECT_EQ(std::min(timestamp + 2, oracle.Peek()), oracle.LowWaterMark());
+  }
+
+  END;
+}
+
+static void* BeginAndEnd(void* arg) {
+  TimestampOracle* oracle = reinterpret_cast<TimestampOracle*>(arg);
+  for (int i = 0; i < 10000; i++) {
+    int shard;
+    uint64 timestamp = oracle->Begin(1, &shard);
+    if (oracle->CachedLowWaterMark() > timestamp)
+      DIE("Low water mark passed an active timestamp.");
+    oracle->End(timestamp, shard);
+  }
+  return NULL;
+}
+
+TEST(TimestampOracle_Concurrent) {
+  TimestampOracle oracle(4);
+  int shard;
+  uint64 held = oracle.Begin(1, &shard);
+
+  pthread_t threads[4];
+  for (int i = 0; i < 4; i++)
+    pthread_create(&threads[i], NULL, BeginAndEnd, &oracle);
+  for (int i = 0; i < 4; i++)
+    pthread_join(threads[i], NULL);
+
+  // 'held' stays the low water mark until it ends.
+  EXPECT_EQ(held, oracle.LowWaterMark());
+  EXPECT_EQ(40002, oracle.Peek());
+  oracle.End(held, shard);
+  EXPECT_EQ(40002, oracle.LowWaterMark());
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  TimestampOracle_LowWaterMark();
+  TimestampOracle_OutOfOrderEnds();
+  TimestampOracle_Concurrent();
+}
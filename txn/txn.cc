@@ -1,58 +1,129 @@
-// Author: Alexander Thomson (thomson@cs.yale.edu)
-
-#include "txn/txn.h"
-
-bool Txn::Read(const Key& key, Value* value) {
-  // Check that key is in readset/writeset.
-  if (readset_.count(key) == 0 && writeset_.count(key) == 0)
-    DIE("Invalid read (key not in readset or writeset).");
-
-  // Reads have no effect if we have already aborted or committed.
-  if (status_ != INCOMPLETE)
-    return false;
-
-  // 'reads_' has already been populated by TxnProcessor, so it should contain
-  // the target value iff the record appears in the database.
-  if (reads_.count(key)) {
-    *value = reads_[key];
-    return true;
-  } else {
-    return false;
-  }
-}
-
-void Txn::Write(const Key& key, const Value& value) {
-  // Check that key is in writeset.
-  if (writeset_.count(key) == 0)
-    DIE("Invalid write to key " << key << " (writeset).");
-
-  // Writes have no effect if we have already aborted or committed.
-  if (status_ != INCOMPLETE)
-    return;
-
-  // Set key-value pair in write buffer.
-  writes_[key] = value;
-
-  // Also set key-value pair in read results in case txn logic requires the
-  // record to be re-read.
-  reads_[key] = value;
-}
-
-void Txn::CheckReadWriteSets() {
-  for (set<Key>::iterator it = writeset_.begin();
-       it != writeset_.end(); ++it) {
-    if (readset_.count(*it) > 0) {
-      DIE("Overlapping read/write sets\n.");
-    }
-  }
-}
-
-void Txn::CopyTxnInternals(Txn* txn) const {
-  txn->readset_ = set<Key>(this->readset_);
-  txn->writeset_ = set<Key>(this->writeset_);
-  txn->reads_ = map<Key, Value>(this->reads_);
-  txn->writes_ = map<Key, Value>(this->writes_);
-  txn->status_ = this->status_;
-  txn->unique_id_ = this->unique_id_;
-  txn->occ_start_time_ = this->occ_start_time_;
-}
+// Author: Alexander Thomson (thomson@cs.yale.edu)
+
+#include "txn/txn.h"
+
+bool Txn::Read(const Key& key, Value* value) {
+  // Check that key is in readset/writeset.
+  if (readset_.count(key) == 0 && writeset_.count(key) == 0)
+    DIE("Invalid read (key not in readset or writeset).");
+
+  // Reads have no effect if we have already aborted or committed.
+  if (status_ != INCOMPLETE)
+    return false;
+
+  // 'reads_' has already been populated by TxnProcessor, so it should contain
+  // the target value iff the record appears in the database.
+  KeyValueMap::iterator it = reads_.find(key);
+  if (it != reads_.end()) {
+    *value = it->second;
+    return true;
+  } else {
+    return false;
+  }
+}
+
+void Txn::Write(const Key& key, const Value& value) {
+  // Check that key is in writeset.
+  if (writeset_.count(key) == 0)
+    DIE("Invalid write to key " << key << " (writeset).");
+
+  // Writes have no effect if we have already aborted or committed.
+  if (status_ != INCOMPLETE)
+    return;
+
+  // Set key-value pair in write buffer.
+  writes_[key] = value;
+
+  // Also set key-value pair in read results in case txn logic requires the
+  // record to be re-read.
+  reads_[key] = value;
+}
+
+void Txn::Increment(const Key& key, Value delta) {
+  // Check that key is in incrementset.
+  if (incrementset_.count(key) == 0)
+    DIE("Invalid increment of key " << key << " (incrementset).");
+
+  // Increments have no effect if we have already aborted or committed.
+  if (status_ != INCOMPLETE)
+    return;
+
+  // Value() is 0, so the first increment of a key starts from there.
+  increments_[key] += delta;
+}
+
+ScanCursor Txn::Scan(Key lo, Key hi) {
+  // Check that the range is in scanset.
+  bool declared = false;
+  for (const KeyRange* range = scanset_.begin(); range != scanset_.end();
+       ++range)
+    declared = declared || (range->lo_ <= lo && hi <= range->hi_);
+  if (!declared)
+    DIE("Invalid scan of [" << lo << ", " << hi << ") (scanset).");
+
+  ScanRead read = {lo, lo, 0};
+  scans_.push_back(read);
+
+  ScanCursor cursor;
+  cursor.source_ = scan_source_;
+  cursor.txn_ = this;
+  cursor.scan_ = scans_.size() - 1;
+  cursor.hi_ = hi;
+  cursor.key_ = 0;
+  cursor.value_ = 0;
+  scan_source_->ScanSeek(&cursor, lo, hi);
+  return cursor;
+}
+
+void Txn::CheckReadWriteSets() {
+  for (KeySet::const_iterator it = writeset_.begin();
+       it != writeset_.end(); ++it) {
+    if (readset_.count(*it) > 0) {
+      DIE("Overlapping read/write sets\n.");
+    }
+  }
+  for (KeySet::const_iterator it = incrementset_.begin();
+       it != incrementset_.end(); ++it) {
+    if (readset_.count(*it) > 0 || writeset_.count(*it) > 0) {
+      DIE("Overlapping increment and read/write sets\n.");
+    }
+  }
+}
+
+void Txn::CopyTxnInternals(Txn* txn) const {
+  txn->readset_ = this->readset_;
+  txn->writeset_ = this->writeset_;
+  txn->incrementset_ = this->incrementset_;
+  txn->scanset_ = this->scanset_;
+  txn->reads_ = this->reads_;
+  txn->writes_ = this->writes_;
+  txn->increments_ = this->increments_;
+  txn->status_ = this->status_;
+  txn->unique_id_ = this->unique_id_;
+  txn->occ_versions_ = this->occ_versions_;
+  txn->scans_ = this->scans_;
+}
+
+void Txn::Restart() {
+  reads_.clear();
+  writes_.clear();
+  increments_.clear();
+  occ_versions_.clear();
+  scans_.clear();
+  status_ = INCOMPLETE;
+}
+
+void Txn::Reset() {
+  readset_.clear();
+  writeset_.clear();
+  incrementset_.clear();
+  scanset_.clear();
+  Restart();
+  optimistic_ = false;
+  two_phase_ = false;
+  retries_ = 0;
+  callback_ = NULL;
+  lock_requests_ = NULL;
+  lock_waits_ = 0;
+  memset(&times_, 0, sizeof(times_));
+}
@@ -1,110 +1,321 @@
-// Author: Alexander Thomson (thomson@cs.yale.edu)
-// Modified by: Kun Ren (kun.ren@yale.edu)
-
-#ifndef _TXN_H_
-#define _TXN_H_
-
-#include <map>
-#include <set>
-#include <vector>
-
-#include "txn/common.h"
-
-using std::map;
-using std::set;
-using std::vector;
-
-// Txns can have five distinct status values:
-enum TxnStatus {
-  INCOMPLETE = 0,   // Not yet executed
-  COMPLETED_C = 1,  // Executed (with commit vote)
-  COMPLETED_A = 2,  // Executed (with abort vote)
-  COMMITTED = 3,    // Committed
-  ABORTED = 4,      // Aborted
-};
-
-class Txn {
- public:
-  // Commit vote defauls to false. Only by calling "commit"
-  Txn() : status_(INCOMPLETE) {}
-  virtual ~Txn() {}
-  virtual Txn * clone() const = 0;    // Virtual constructor (copying)
-
-  // Method containing all the transaction's method logic.
-  virtual void Run() = 0;
-
-  // Returns the Txn's current execution status.
-  TxnStatus Status() { return status_; }
-
-  // Checks for overlap in read and write sets. If any key appears in both,
-  // an error occurs.
-  void CheckReadWriteSets();
-
- protected:
-  // Copies the internals of this txn into a given transaction (i.e.
-  // the readset, writeset, and so forth).  Be sure to modify this method
-  // to copy any new data structures you create.
-  void CopyTxnInternals(Txn* txn) const;
-
-  friend class TxnProcessor;
-
-  // Method to be used inside 'Execute()' function when reading records from
-  // the database. If record corresponding with specified 'key' exists, sets
-  // '*value' equal to the record value and returns true, else returns false.
-  //
-  // Requires: key appears in readset or writeset
-  //
-  // Note: Can ONLY be called from inside the 'Execute()' function.
-  bool Read(const Key& key, Value* value);
-
-  // Method to be used inside 'Execute()' function when writing records to
-  // the database.
-  //
-  // Requires: key appears in writeset
-  //
-  // Note: Can ONLY be called from inside the 'Execute()' function.
-  void Write(const Key& key, const Value& value);
-
-  // Macro to be used inside 'Execute()' function when deciding to COMMIT.
-  //
-  // Note: Can ONLY be called from inside the 'Execute()' function.
-  #define COMMIT \
-    do { \
-      status_ = COMPLETED_C; \
-      return; \
-    } while (0)
-
-  // Macro to be used inside 'Execute()' function when deciding to ABORT.
-  //
-  // Note: Can ONLY be called from inside the 'Execute()' function.
-  #define ABORT \
-    do { \
-      status_ = COMPLETED_A; \
-      return; \
-    } while (0)
-
-  // Set of all keys that may need to be read in order to execute the
-  // transaction.
-  set<Key> readset_;
-
-  // Set of all keys that may be updated when executing the transaction.
-  set<Key> writeset_;
-
-  // Results of reads performed by the transaction.
-  map<Key, Value> reads_;
-
-  // Key, Value pairs WRITTEN by the transaction.
-  map<Key, Value> writes_;
-
-  // Transaction's current execution status.
-  TxnStatus status_;
-
-  // Unique, monotonically increasing transaction ID, assigned by TxnProcessor.
-  uint64 unique_id_;
-
-  // Start time (used for OCC).
-  double occ_start_time_;
-};
-
-#endif  // _TXN_H_
-
+// Author: Alexander Thomson (thomson@cs.yale.edu)
+// Modified by: Kun Ren (kun.ren@yale.edu)
+
+#ifndef _TXN_H_
+#define _TXN_H_
+
+#include <string.h>
+#include <atomic>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "txn/common.h"
+#include "txn/ordered_index.h"
+#include "utils/small_vector.h"
+#include "utils/task.h"
+
+using std::map;
+using std::set;
+using std::vector;
+
+struct LockRequest;
+class Txn;
+
+// Read/write sets, reads and writes of up to TXN_INLINE_KEYS keys are stored
+// inside the Txn, as sorted arrays, without any heap allocation.
+#define TXN_INLINE_KEYS 32
+typedef SmallSet<Key, TXN_INLINE_KEYS> KeySet;
+typedef SmallMap<Key, Value, TXN_INLINE_KEYS> KeyValueMap;
+
+// Half-open key range [lo_, hi_).
+struct KeyRange {
+  Key lo_;
+  Key hi_;
+};
+
+// What one Txn::Scan() call has read so far: keys [lo_, end_) of its
+// range, and (under OCC) the sum of the versions of every key visited,
+// which validation compares against a fresh walk of the same keys. Records
+// are never deleted and versions only grow, so the sums match only if no
+// record of the range was written or created meanwhile.
+struct ScanRead {
+  Key lo_;
+  Key end_;
+  uint64 versions_;
+};
+
+class ScanCursor;
+
+// Reads scanned records for a txn as its CC mode requires. Implemented by
+// the TxnProcessor.
+class ScanSource {
+ public:
+  virtual ~ScanSource() {}
+
+  // Positions 'cursor' before the first record of [lo, hi).
+  virtual void ScanSeek(ScanCursor* cursor, Key lo, Key hi) = 0;
+
+  // Moves 'cursor' to the next record of its range and returns true, or
+  // returns false past the end of the range.
+  virtual bool ScanNext(ScanCursor* cursor) = 0;
+};
+
+// Streams the records of a key range, in key order, to a running txn (see
+// Txn::Scan). Each record is read when the cursor reaches it, so the range
+// is never copied into the txn's reads_.
+class ScanCursor {
+ public:
+  // Moves to the next record and returns true, or returns false once past
+  // the last one.
+  bool Next() { return source_->ScanNext(this); }
+
+  Key key() const { return key_; }
+  Value value() const { return value_; }
+
+ private:
+  friend class Txn;
+  friend class TxnProcessor;
+
+  ScanSource* source_;
+  Txn* txn_;
+  int scan_;       // Index of the scan's ScanRead in txn_->scans_
+  Key hi_;         // End of the scanned range
+  KeyCursor keys_;
+  Key key_;
+  Value value_;
+};
+
+// Receives the outcome of a txn submitted with a callback, in place of
+// TxnProcessor::GetTxnResult().
+class TxnCallback {
+ public:
+  virtual ~TxnCallback() {}
+
+  // Called exactly once, with the COMMITTED or ABORTED txn, on the thread
+  // that finished it: a worker in P_OCC, MVCC and LOCKING_PARTITIONED mode,
+  // the scheduler thread otherwise (the log thread for durable commits).
+  // Takes ownership of the txn. Runs on the TxnProcessor's critical path, so
+  // it should hand off rather than block.
+  virtual void Done(Txn* txn) = 0;
+};
+
+// Txns can have five distinct status values:
+enum TxnStatus {
+  INCOMPLETE = 0,   // Not yet executed
+  COMPLETED_C = 1,  // Executed (with commit vote)
+  COMPLETED_A = 2,  // Executed (with abort vote)
+  COMMITTED = 3,    // Committed
+  ABORTED = 4,      // Aborted
+};
+
+// CycleClock() readings taken as a txn crosses each phase boundary
+// inside the TxnProcessor, for TxnProcessor::GetTxnStats(). Except for
+// 'submitted_', they are from the txn's latest attempt; 0 means not
+// reached.
+struct TxnTimes {
+  uint64 submitted_;  // First handed to the TxnProcessor
+  uint64 queued_;     // Entered the request queue
+  uint64 scheduled_;  // Taken from the request queue by the scheduler
+  uint64 locked_;     // Holds all its locks (LOCKING modes only)
+  uint64 executed_;   // Started reading and running
+  uint64 finished_;   // Done running
+};
+
+// Runs 'function_(context_, txn_)'. Every txn embeds one, which is how the
+// TxnProcessor hands the txn to a worker (see TxnProcessor::Dispatch())
+// without allocating a task each time.
+class TxnTask : public Task {
+ public:
+  TxnTask() : function_(NULL), context_(NULL), txn_(NULL) { embedded_ = true; }
+  virtual void Run() { function_(context_, txn_); }
+
+  void (*function_)(void*, Txn*);
+  void* context_;
+  Txn* txn_;
+};
+
+class Txn {
+ public:
+  // Commit vote defauls to false. Only by calling "commit"
+  Txn()
+      : status_(INCOMPLETE), timestamp_shard_(0), scan_source_(NULL),
+        optimistic_(false), two_phase_(false), retries_(0),
+        callback_(NULL), lock_requests_(NULL), lock_waits_(0) {
+    memset(&times_, 0, sizeof(times_));
+  }
+  virtual ~Txn() {}
+  virtual Txn * clone() const = 0;    // Virtual constructor (copying)
+
+  // Method containing all the transaction's method logic.
+  virtual void Run() = 0;
+
+  // Returns the Txn's current execution status.
+  TxnStatus Status() { return status_; }
+
+  // Checks for overlap in read, write and increment sets. If any key appears
+  // in two of them, an error occurs.
+  void CheckReadWriteSets();
+
+  // Returns the txn to the state of a newly constructed one, with empty read
+  // and write sets, so that it can be reused for another request (see
+  // TxnPool). Storage already allocated by the txn is kept. Txn types with
+  // state of their own should extend this.
+  //
+  // Requires: the txn is not in any TxnProcessor.
+  virtual void Reset();
+
+ protected:
+  // Copies the internals of this txn into a given transaction (i.e.
+  // the readset, writeset, and so forth).  Be sure to modify this method
+  // to copy any new data structures you create.
+  void CopyTxnInternals(Txn* txn) const;
+
+  // Discards the reads, writes and outcome of an execution attempt so that
+  // the txn can be run again, keeping their storage for the next attempt.
+  void Restart();
+
+  friend class TxnProcessor;
+  friend class LockManager;
+  friend class LockTable;
+  friend class RedoLog;
+  friend class ShardedTxnProcessor;
+  friend class ShardPart;
+
+  // Method to be used inside 'Execute()' function when reading records from
+  // the database. If record corresponding with specified 'key' exists, sets
+  // '*value' equal to the record value and returns true, else returns false.
+  //
+  // Requires: key appears in readset or writeset
+  //
+  // Note: Can ONLY be called from inside the 'Execute()' function.
+  bool Read(const Key& key, Value* value);
+
+  // Method to be used inside 'Execute()' function when writing records to
+  // the database.
+  //
+  // Requires: key appears in writeset
+  //
+  // Note: Can ONLY be called from inside the 'Execute()' function.
+  void Write(const Key& key, const Value& value);
+
+  // Method to be used inside 'Execute()' function to add 'delta' to the
+  // record of key (which starts at 0 if it has none) when the txn commits.
+  // The txn never sees the record, so increments of one key by different
+  // txns commute: lock managers grant them together, OCC does not validate
+  // them, and MVCC installs them as deltas over older versions.
+  //
+  // Requires: key appears in incrementset
+  //
+  // Note: Can ONLY be called from inside the 'Execute()' function.
+  void Increment(const Key& key, Value delta);
+
+  // Method to be used inside 'Execute()' function to read every record with
+  // a key in [lo, hi), in key order:
+  //
+  //   for (ScanCursor it = Scan(lo, hi); it.Next(); )
+  //     sum += it.value();
+  //
+  // The cursor reads records as it moves, from storage, so it sees neither
+  // the txn's own writes nor its reads_. Only the part of the range the
+  // cursor actually passed takes part in validation.
+  //
+  // Requires: [lo, hi) lies within a range of scanset_
+  //
+  // Note: Can ONLY be called from inside the 'Execute()' function.
+  ScanCursor Scan(Key lo, Key hi);
+
+  // Macro to be used inside 'Execute()' function when deciding to COMMIT.
+  //
+  // Note: Can ONLY be called from inside the 'Execute()' function.
+  #define COMMIT \
+    do { \
+      status_ = COMPLETED_C; \
+      return; \
+    } while (0)
+
+  // Macro to be used inside 'Execute()' function when deciding to ABORT.
+  //
+  // Note: Can ONLY be called from inside the 'Execute()' function.
+  #define ABORT \
+    do { \
+      status_ = COMPLETED_A; \
+      return; \
+    } while (0)
+
+  // Set of all keys that may need to be read in order to execute the
+  // transaction.
+  KeySet readset_;
+
+  // Set of all keys that may be updated when executing the transaction.
+  KeySet writeset_;
+
+  // Set of all keys that may be passed to Increment(). Disjoint from
+  // readset_ and writeset_.
+  KeySet incrementset_;
+
+  // Ranges the transaction may scan. Locking modes lock each range as a
+  // whole, including keys without records.
+  SmallVector<KeyRange, 1> scanset_;
+
+  // Results of reads performed by the transaction.
+  KeyValueMap reads_;
+
+  // Key, Value pairs WRITTEN by the transaction.
+  KeyValueMap writes_;
+
+  // Sum of the deltas passed to Increment(), per key. Single-version modes
+  // turn them into writes_ as they commit (see
+  // TxnProcessor::ResolveIncrements).
+  KeyValueMap increments_;
+
+  // Transaction's current execution status.
+  TxnStatus status_;
+
+  // Unique, monotonically increasing transaction ID, assigned by TxnProcessor.
+  uint64 unique_id_;
+
+  // TimestampOracle shard where unique_id_ is registered (used for MVCC).
+  int timestamp_shard_;
+
+  // Record versions seen by the reads, in readset_ then writeset_ order
+  // (used for OCC).
+  SmallVector<uint64, 2 * TXN_INLINE_KEYS> occ_versions_;
+
+  // What each Scan() of the current attempt has read, and where scans get
+  // their records from (set by the TxnProcessor).
+  SmallVector<ScanRead, 1> scans_;
+  ScanSource* scan_source_;
+
+  // Set by the ADAPTIVE scheduler if the current attempt runs under OCC
+  // rather than under locks.
+  bool optimistic_;
+
+  // Set on the parts of a txn that spans several shards of a
+  // ShardedTxnProcessor. Such a part must hold its locks while it runs, so
+  // it never runs as a lock-free read-only txn or under OCC.
+  bool two_phase_;
+
+  // Times the txn has been restarted since it was submitted (see
+  // TxnProcessor::RetryTxn).
+  int retries_;
+
+  // Receives the txn once it is COMMITTED or ABORTED, instead of the
+  // TxnProcessor's result queue. NULL unless the txn was submitted with a
+  // callback.
+  TxnCallback* callback_;
+
+  // Lock manager bookkeeping (used for LOCKING): every lock request the txn
+  // has made, and how many of them have not been granted yet.
+  LockRequest* lock_requests_;
+  std::atomic<int> lock_waits_;
+
+  // Phase timestamps (see TxnTimes).
+  TxnTimes times_;
+
+  // Task that runs the txn on a worker (see TxnProcessor::Dispatch()).
+  TxnTask task_;
+};
+
+#endif  // _TXN_H_
+
@@ -0,0 +1,385 @@
+/// @file
+///
+/// Configurable TxnProcessor benchmark. Runs RMW txns against each requested
+/// CC mode and prints one CSV or JSON record per mode, for sweeps and
+/// regression tracking. All options are --name=value:
+///
+///   --modes=0,2,5       CC modes to run (CCMode numbers; default all)
+///   --duration=1        Measured seconds per mode
+///   --warmup=0.2        Seconds run before measuring starts
+///   --active=100        Txns kept in flight, split between the clients
+///   --clients=1         Client threads generating load
+///   --workers=4         TxnProcessor worker threads
+///   --db_size=1000000   Keys to draw from
+///   --dist=uniform      Key distribution: uniform, zipfian or hotspot
+///   --theta=0.99        Zipfian skew, in (0, 1)
+///   --hot_fraction=0.01 Hotspot: fraction of keys that are hot...
+///   --hot_probability=0.9  ...and fraction of picks that go to them
+///   --reads=5           Keys read per txn
+///   --writes=0          Keys read and written per txn
+///   --increments=0      Keys incremented per txn, without being read
+///   --read_only=0       Fraction of txns that only read (--reads keys)
+///   --txn_time=0.0001   Seconds each txn spends running
+///   --storage=array     Record layout: array or hash
+///   --format=csv        Output format: csv or json
+///
+/// Latencies are measured by the clients, from submission to result. Each
+/// client draws keys from its own per-thread generator and gets results
+/// through a callback of its own, so clients do not contend with each other.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "txn/key_generator.h"
+#include "txn/txn_processor.h"
+#include "txn/txn_types.h"
+#include "utils/cycle_clock.h"
+#include "utils/histogram.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+static const char* kModeNames[] = {
+  "serial", "locking_a", "locking_b", "occ", "p_occ", "mvcc",
+  "locking_p", "calvin", "adaptive",
+};
+
+// Command line options, as name -> value.
+class Options {
+ public:
+  Options(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+      const char* eq = strchr(argv[i], '=');
+      if (strncmp(argv[i], "--", 2) != 0 || eq == NULL)
+        DIE("Bad option " << argv[i] << " (expected --name=value).");
+      values_[string(argv[i] + 2, eq - argv[i] - 2)] = eq + 1;
+    }
+  }
+
+  string String(const string& name, const string& fallback) {
+    used_[name] = true;
+    map<string, string>::iterator it = values_.find(name);
+    return it == values_.end() ? fallback : it->second;
+  }
+  double Double(const string& name, double fallback) {
+    string value = String(name, "");
+    return value.empty() ? fallback : atof(value.c_str());
+  }
+  int Int(const string& name, int fallback) {
+    string value = String(name, "");
+    return value.empty() ? fallback : atoi(value.c_str());
+  }
+
+  // Dies if an option was given that was never asked for.
+  void CheckAllUsed() {
+    for (map<string, string>::iterator it = values_.begin();
+         it != values_.end(); ++it) {
+      if (!used_.count(it->first))
+        DIE("Unknown option --" << it->first << ".");
+    }
+  }
+
+ private:
+  map<string, string> values_;
+  map<string, bool> used_;
+};
+
+struct Result {
+  CCMode mode_;
+  uint64 committed_;
+  uint64 aborted_;
+  uint64 restarts_;
+  uint64 read_only_committed_;  // Taking the read-only path
+  double seconds_;
+  Histogram latency_;  // Nanoseconds
+};
+
+// Workload settings shared by every mode.
+struct Workload {
+  KeyGenerator* keys_;
+  int active_;
+  int reads_;
+  int writes_;
+  int increments_;
+  double read_only_;
+  double txn_time_;
+  double warmup_;
+  double duration_;
+};
+
+// Reads the TxnProcessor's restart and read-only commit counters.
+static void GetCounters(TxnProcessor* p, uint64* restarts,
+                        uint64* read_only_committed) {
+  TxnStats* stats = new TxnStats();
+  p->GetTxnStats(stats);
+  *restarts = stats->restarts_;
+  *read_only_committed = stats->read_only_committed_;
+  delete stats;
+}
+
+static void SleepUntil(double time) {
+  double now = GetTime();
+  if (time > now)
+    Sleep(time - now);
+}
+
+// Collects the finished txns of one client. Done() runs on TxnProcessor
+// threads, so it only appends and wakes the client.
+class ClientInbox : public TxnCallback {
+ public:
+  ClientInbox() {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&cv_, NULL);
+  }
+  virtual ~ClientInbox() {
+    pthread_cond_destroy(&cv_);
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  virtual void Done(Txn* txn) {
+    pthread_mutex_lock(&mutex_);
+    txns_.push_back(txn);
+    if (txns_.size() == 1)
+      pthread_cond_signal(&cv_);
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  // Blocks until at least one txn has finished, then moves every finished
+  // txn into the empty vector '*txns'.
+  void Take(vector<Txn*>* txns) {
+    pthread_mutex_lock(&mutex_);
+    while (txns_.empty())
+      pthread_cond_wait(&cv_, &mutex_);
+    txns->swap(txns_);
+    pthread_mutex_unlock(&mutex_);
+  }
+
+ private:
+  vector<Txn*> txns_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cv_;
+};
+
+// One load-generating thread, keeping 'active_' txns in flight.
+struct Client {
+  TxnProcessor* processor_;
+  const Workload* workload_;
+  int active_;
+  double measure_start_;
+  double end_;
+  ClientInbox inbox_;
+  Result result_;
+  pthread_t thread_;
+};
+
+static void Submit(Client* c, RMW* txn, uint64* submitted) {
+  const Workload& w = *c->workload_;
+  txn->Reset();
+  if (w.read_only_ > 0 && ThreadRandom()->NextDouble() < w.read_only_)
+    txn->Init(w.keys_, w.reads_, 0, w.txn_time_);
+  else
+    txn->Init(w.keys_, w.reads_, w.writes_, w.txn_time_, w.increments_);
+  *submitted = CycleClock();
+  c->processor_->NewTxnRequest(txn, &c->inbox_);
+}
+
+// Resubmits each txn as soon as it finishes until 'end_', counting the
+// results that arrive from 'measure_start_' on.
+static void* RunClient(void* arg) {
+  Client* c = reinterpret_cast<Client*>(arg);
+
+  // Each in-flight txn is identified by its slot in 'txns'.
+  RMW* txns = new RMW[c->active_];
+  uint64* submitted = new uint64[c->active_];
+  for (int i = 0; i < c->active_; i++)
+    Submit(c, &txns[i], &submitted[i]);
+
+  vector<Txn*> done;
+  for (int pending = c->active_; pending > 0; ) {
+    c->inbox_.Take(&done);
+    double now = GetTime();
+    uint64 now_cycles = CycleClock();
+    bool measuring = now >= c->measure_start_ && now < c->end_;
+    for (size_t i = 0; i < done.size(); i++) {
+      RMW* txn = static_cast<RMW*>(done[i]);
+      if (measuring) {
+        if (txn->Status() == COMMITTED)
+          c->result_.committed_++;
+        else
+          c->result_.aborted_++;
+        c->result_.latency_.Record(
+            (now_cycles - submitted[txn - txns]) * NanosPerCycle());
+      }
+      if (now < c->end_)
+        Submit(c, txn, &submitted[txn - txns]);
+      else
+        pending--;
+    }
+    done.clear();
+  }
+
+  delete[] submitted;
+  delete[] txns;
+  return NULL;
+}
+
+// Runs 'clients' client threads against one TxnProcessor for the warmup and
+// the measured period, splitting 'w.active_' in-flight txns between them,
+// and merges their results.
+static void Run(CCMode mode, const TxnProcessorConfig& config,
+                const Workload& w, int clients, Result* result) {
+  TxnProcessor* p = new TxnProcessor(mode, config);
+
+  double measure_start = GetTime() + w.warmup_;
+  double end = measure_start + w.duration_;
+  Client* c = new Client[clients];
+  for (int i = 0; i < clients; i++) {
+    c[i].processor_ = p;
+    c[i].workload_ = &w;
+    c[i].active_ = w.active_ / clients + (i < w.active_ % clients ? 1 : 0);
+    c[i].measure_start_ = measure_start;
+    c[i].end_ = end;
+    c[i].result_.committed_ = 0;
+    c[i].result_.aborted_ = 0;
+    pthread_create(&c[i].thread_, NULL, RunClient, &c[i]);
+  }
+
+  SleepUntil(measure_start);
+  uint64 restarts_before, read_only_before;
+  GetCounters(p, &restarts_before, &read_only_before);
+  SleepUntil(end);
+  uint64 restarts_after, read_only_after;
+  GetCounters(p, &restarts_after, &read_only_after);
+
+  result->mode_ = mode;
+  result->committed_ = 0;
+  result->aborted_ = 0;
+  result->latency_.Clear();
+  for (int i = 0; i < clients; i++) {
+    pthread_join(c[i].thread_, NULL);
+    result->committed_ += c[i].result_.committed_;
+    result->aborted_ += c[i].result_.aborted_;
+    result->latency_.Merge(c[i].result_.latency_);
+  }
+  result->seconds_ = w.duration_;
+  result->restarts_ = restarts_after - restarts_before;
+  result->read_only_committed_ = read_only_after - read_only_before;
+
+  delete[] c;
+  delete p;
+}
+
+int main(int argc, char** argv) {
+  Options options(argc, argv);
+
+  vector<CCMode> modes;
+  string mode_list = options.String("modes", "0,1,2,3,4,5,6,7,8");
+  for (const char* m = mode_list.c_str(); *m != '\0'; ) {
+    int mode = atoi(m);
+    if (mode < SERIAL || mode > ADAPTIVE)
+      DIE("Unknown mode " << mode << ".");
+    modes.push_back(static_cast<CCMode>(mode));
+    const char* comma = strchr(m, ',');
+    m = comma == NULL ? m + strlen(m) : comma + 1;
+  }
+
+  TxnProcessorConfig config;
+  config.worker_count_ = options.Int("workers", config.worker_count_);
+  string storage = options.String("storage", "array");
+  if (storage == "hash")
+    config.storage_type_ = HASH_STORAGE;
+  else if (storage != "array")
+    DIE("Unknown storage " << storage << ".");
+
+  Workload w;
+  uint64 db_size = options.Int("db_size", 1000000);
+  string dist = options.String("dist", "uniform");
+  double theta = options.Double("theta", 0.99);
+  double hot_fraction = options.Double("hot_fraction", 0.01);
+  double hot_probability = options.Double("hot_probability", 0.9);
+  if (dist == "uniform")
+    w.keys_ = new UniformKeys(db_size);
+  else if (dist == "zipfian")
+    w.keys_ = new ZipfianKeys(db_size, theta);
+  else if (dist == "hotspot")
+    w.keys_ = new HotspotKeys(db_size, hot_fraction, hot_probability);
+  else
+    DIE("Unknown key distribution " << dist << ".");
+  w.active_ = options.Int("active", 100);
+  int clients = options.Int("clients", 1);
+  if (clients < 1 || clients > w.active_)
+    DIE("--clients must be between 1 and --active.");
+  w.reads_ = options.Int("reads", 5);
+  w.writes_ = options.Int("writes", 0);
+  w.increments_ = options.Int("increments", 0);
+  w.read_only_ = options.Double("read_only", 0);
+  w.txn_time_ = options.Double("txn_time", 0.0001);
+  w.warmup_ = options.Double("warmup", 0.2);
+  w.duration_ = options.Double("duration", 1);
+  string format = options.String("format", "csv");
+  if (format != "csv" && format != "json")
+    DIE("Unknown format " << format << ".");
+  options.CheckAllUsed();
+
+  if (format == "csv") {
+    printf("mode,dist,theta,db_size,reads,writes,increments,read_only,"
+           "txn_time,active,clients,workers,txns_per_sec,committed,aborted,"
+           "restarts,read_only_committed,p50_us,p99_us,p999_us,max_us\n");
+  } else {
+    printf("[\n");
+  }
+  for (size_t i = 0; i < modes.size(); i++) {
+    Result* r = new Result();
+    Run(modes[i], config, w, clients, r);
+    double throughput = (r->committed_ + r->aborted_) / r->seconds_;
+    if (format == "csv") {
+      printf("%s,%s,%g,%llu,%d,%d,%d,%g,%g,%d,%d,%d,%.0f,%llu,%llu,%llu,%llu,"
+             "%.1f,%.1f,%.1f,%.1f\n",
+             kModeNames[r->mode_], dist.c_str(), theta,
+             static_cast<unsigned long long>(db_size), w.reads_, w.writes_,
+             w.increments_, w.read_only_, w.txn_time_, w.active_, clients,
+             config.worker_count_, throughput,
+             static_cast<unsigned long long>(r->committed_),
+             static_cast<unsigned long long>(r->aborted_),
+             static_cast<unsigned long long>(r->restarts_),
+             static_cast<unsigned long long>(r->read_only_committed_),
+             r->latency_.Percentile(0.5) / 1e3,
+             r->latency_.Percentile(0.99) / 1e3,
+             r->latency_.Percentile(0.999) / 1e3, r->latency_.Max() / 1e3);
+    } else {
+      printf("  {\"mode\": \"%s\", \"dist\": \"%s\", \"theta\": %g, "
+             "\"db_size\": %llu, \"reads\": %d, \"writes\": %d, "
+             "\"increments\": %d, \"read_only\": %g, \"txn_time\": %g, "
+             "\"active\": %d, \"clients\": %d, \"workers\": %d, "
+             "\"txns_per_sec\": %.0f, \"committed\": %llu, \"aborted\": %llu, "
+             "\"restarts\": %llu, \"read_only_committed\": %llu, "
+             "\"p50_us\": %.1f, \"p99_us\": %.1f, \"p999_us\": %.1f, "
+             "\"max_us\": %.1f}%s\n",
+             kModeNames[r->mode_], dist.c_str(), theta,
+             static_cast<unsigned long long>(db_size), w.reads_, w.writes_,
+             w.increments_, w.read_only_, w.txn_time_, w.active_, clients,
+             config.worker_count_, throughput,
+             static_cast<unsigned long long>(r->committed_),
+             static_cast<unsigned long long>(r->aborted_),
+             static_cast<unsigned long long>(r->restarts_),
+             static_cast<unsigned long long>(r->read_only_committed_),
+             r->latency_.Percentile(0.5) / 1e3,
+             r->latency_.Percentile(0.99) / 1e3,
+             r->latency_.Percentile(0.999) / 1e3, r->latency_.Max() / 1e3,
+             i + 1 < modes.size() ? "," : "");
+    }
+    fflush(stdout);
+    delete r;
+  }
+  if (format == "json")
+    printf("]\n");
+
+  delete w.keys_;
+  return 0;
+}
@@ -0,0 +1,59 @@
+// Pool of reusable txn objects for clients that issue many txns of the same
+// type.
+
+#ifndef _TXN_POOL_H_
+#define _TXN_POOL_H_
+
+#include <vector>
+
+#include "txn/txn.h"
+
+using std::vector;
+
+// Hands out txns of type T, which must be default constructible. Txns given
+// back with Release() are Reset() and handed out again by later calls to
+// Acquire(), together with the storage their read/write sets and results had
+// grown, so that once the pool is warm a client issues txns without touching
+// the heap.
+//
+// Not thread-safe: each client thread should keep its own pool.
+template<typename T>
+class TxnPool {
+ public:
+  TxnPool() {}
+
+  ~TxnPool() {
+    for (size_t i = 0; i < free_.size(); i++)
+      delete free_[i];
+  }
+
+  // Returns a txn in its freshly constructed state. The caller fills in its
+  // read and write sets, and either submits it to a TxnProcessor or gives it
+  // back with Release().
+  T* Acquire() {
+    if (free_.empty())
+      return new T();
+    T* txn = free_.back();
+    free_.pop_back();
+    return txn;
+  }
+
+  // Takes back a txn that came from Acquire() on this pool, e.g. once it has
+  // been returned by TxnProcessor::GetTxnResult().
+  void Release(Txn* txn) {
+    txn->Reset();
+    free_.push_back(static_cast<T*>(txn));
+  }
+
+  // Number of txns ready to be handed out without allocating.
+  int Available() const { return free_.size(); }
+
+ private:
+  vector<T*> free_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  TxnPool(const TxnPool&);
+  TxnPool& operator=(const TxnPool&);
+};
+
+#endif  // _TXN_POOL_H_
@@ -1,476 +1,1750 @@
-// Author: Alexander Thomson (thomson@cs.yale.edu)
-// Modified by: Christina Wallin (christina.wallin@yale.edu)
-// Modified by: Kun Ren (kun.ren@yale.edu)
-
-
-#include "txn/txn_processor.h"
-#include <stdio.h>
-#include <set>
-
-#include "txn/lock_manager.h"
-
-// Thread & queue counts for StaticThreadPool initialization.
-#define THREAD_COUNT 4
-
-TxnProcessor::TxnProcessor(CCMode mode)
-    : mode_(mode), tp_(THREAD_COUNT), next_unique_id_(1) {
-  if (mode_ == LOCKING_EXCLUSIVE_ONLY)
-    lm_ = new LockManagerA(&ready_txns_);
-  else if (mode_ == LOCKING)
-    lm_ = new LockManagerB(&ready_txns_);
-
-  // Create the storage
-  if (mode_ == MVCC) {
-    storage_ = new MVCCStorage();
-  } else {
-    storage_ = new Storage();
-  }
-
-  storage_->InitStorage();
-
-  // Start 'RunScheduler()' running.
-  cpu_set_t cpuset;
-  pthread_attr_t attr;
-  pthread_attr_init(&attr);
-  CPU_ZERO(&cpuset);
-  CPU_SET(0, &cpuset);
-  CPU_SET(1, &cpuset);
-  CPU_SET(2, &cpuset);
-  CPU_SET(3, &cpuset);
-  CPU_SET(4, &cpuset);
-  CPU_SET(5, &cpuset);
-  CPU_SET(6, &cpuset);
-  pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
-  pthread_t scheduler_;
-  pthread_create(&scheduler_, &attr, StartScheduler, reinterpret_cast<void*>(this));
-
-}
-
-void* TxnProcessor::StartScheduler(void * arg) {
-  reinterpret_cast<TxnProcessor *>(arg)->RunScheduler();
-  return NULL;
-}
-
-TxnProcessor::~TxnProcessor() {
-  if (mode_ == LOCKING_EXCLUSIVE_ONLY || mode_ == LOCKING)
-    delete lm_;
-
-  delete storage_;
-}
-
-void TxnProcessor::NewTxnRequest(Txn* txn) {
-  // Atomically assign the txn a new number and add it to the incoming txn
-  // requests queue.
-  mutex_.Lock();
-  txn->unique_id_ = next_unique_id_;
-  next_unique_id_++;
-  txn_requests_.Push(txn);
-  mutex_.Unlock();
-}
-
-Txn* TxnProcessor::GetTxnResult() {
-  Txn* txn;
-  while (!txn_results_.Pop(&txn)) {
-    // No result yet. Wait a bit before trying again (to reduce contention on
-    // atomic queues).
-    sleep(0.000001);
-  }
-  return txn;
-}
-
-void TxnProcessor::RunScheduler() {
-  switch (mode_) {
-    case SERIAL:                 RunSerialScheduler(); break;
-    case LOCKING:                RunLockingScheduler(); break;
-    case LOCKING_EXCLUSIVE_ONLY: RunLockingScheduler(); break;
-    case OCC:                    RunOCCScheduler(); break;
-    case P_OCC:                  RunOCCParallelScheduler(); break;
-    case MVCC:                   RunMVCCScheduler();
-  }
-}
-
-void TxnProcessor::RunSerialScheduler() {
-  Txn* txn;
-  while (tp_.Active()) {
-    // Get next txn request.
-    if (txn_requests_.Pop(&txn)) {
-      // Execute txn.
-      ExecuteTxn(txn);
-
-      // Commit/abort txn according to program logic's commit/abort decision.
-      if (txn->Status() == COMPLETED_C) {
-        ApplyWrites(txn);
-        txn->status_ = COMMITTED;
-      } else if (txn->Status() == COMPLETED_A) {
-        txn->status_ = ABORTED;
-      } else {
-        // Invalid TxnStatus!
-        DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
-      }
-
-      // Return result to client.
-      txn_results_.Push(txn);
-    }
-  }
-}
-
-void TxnProcessor::RunLockingScheduler() {
-  // Sets the transation variable
-  Txn* txn;
-  // As long as the transaction variable is active...
-  while (tp_.Active()) {
-    // Start processing the next incoming transaction request.
-    if (txn_requests_.Pop(&txn)) {
-      bool blocked = false;
-      int total = txn->readset_.size() + txn->writeset_.size();
-
-      // Request read locks (EXCLUSIVE LOCK if part A)
-      for (set<Key>::iterator itr = txn->readset_.begin(); itr != txn->readset_.end(); itr++) {
-        // block if the read lock could not be set (needs to wait or destroyed if total > 1)
-        if (!lm_ ->ReadLock(txn, *itr)) {
-          blocked = true;
-          if (total > 1) {
-            // Release all locks that already acquired
-            for (set<Key>::iterator itr_reads = txn->readset_.begin(); true; ++itr_reads) {
-              lm_->Release(txn, *itr_reads);
-              if (itr_reads == itr) {
-                break;
-              }
-            }
-            break;
-          }
-        }
-      }
-
-      if (!blocked) {
-        // Request write locks (EXCLUSIVE LOCK)
-        for (set<Key>::iterator itr = txn->writeset_.begin(); itr != txn->writeset_.end(); itr++) {
-          // block if the read lock could not be set (needs to wait or destroyed if total > 1)
-          if (!lm_ ->WriteLock(txn, *itr)) {
-            blocked = true;
-            if (total > 1) {
-              // Release all read locks that already acquired
-              for (set<Key>::iterator itr_reads = txn->readset_.begin(); itr_reads != txn->readset_.end(); ++itr_reads) {
-                lm_->Release(txn, *itr_reads);
-              }
-              for (set<Key>::iterator itr_writes = txn->writeset_.begin(); true; ++itr_writes) {
-                lm_->Release(txn, *itr_writes);
-                if (itr_writes == itr) {
-                  break;
-                }
-              }
-              break;
-            }
-          }
-        }
-      }
-
-      // If all read and write locks were immediately acquired, this txn is
-      if (!blocked) {
-        ready_txns_.push_back(txn);
-      }
-      // If the transaction is blocked, check the validity
-      // Rule no.2: transaction waits only if it only involves one read or write
-      // If not-> delete all acquired locks -> restart transation
-      else if (blocked && (total > 1)) {
-        NewTxnRequest(txn);
-      }
-    }
-
-    // Process and commit all transactions that have finished running.
-    while (completed_txns_.Pop(&txn)) {
-      // Commit/abort txn according to program logic's commit/abort decision.
-      // If transaction is aborted => abort
-      if (txn->Status() == COMPLETED_A) {
-        txn->status_ = ABORTED;
-      }
-      // If the transaction is commited => write the result to storage
-      else if (txn->Status() == COMPLETED_C) {
-        for (map<Key, Value>::iterator itr = txn->writes_.begin(); itr != txn->writes_.end(); ++itr) {
-          storage_->Write(itr->first, itr->second, txn->unique_id_);
-        }
-        txn->status_ = COMMITTED;
-      }
-      // Else the status is invalid
-      else {
-        // Invalid TxnStatus!
-        DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
-      }
-
-      // Release read locks
-      for (set<Key>::iterator itr = txn->readset_.begin(); itr != txn->readset_.end(); ++itr) {
-        lm_->Release(txn, *itr);
-      }
-      // Release all write locks
-      for (set<Key>::iterator itr = txn->writeset_.begin(); itr != txn->writeset_.end(); ++itr) {
-        lm_->Release(txn, *itr);
-      }
-
-      // Return result to client.
-      txn_results_.Push(txn);
-    }
-
-
-    // Executing ready transactions
-    while (ready_txns_.size() > 0) {
-      // Get next ready txn from the queue
-      txn = ready_txns_.front();
-      ready_txns_.pop_front();
-
-      // Start txn running in its own thread
-      tp_.RunTask(new Method<TxnProcessor, void, Txn*>(
-            this,
-            &TxnProcessor::ExecuteTxn,
-            txn));
-    }
-  }
-}
-
-void TxnProcessor::ExecuteTxn(Txn* txn) {
-
-  // Get the start time
-  txn->occ_start_time_ = GetTime();
-
-  // Read everything in from readset.
-  for (set<Key>::iterator it = txn->readset_.begin();
-       it != txn->readset_.end(); ++it) {
-    // Save each read result iff record exists in storage.
-    Value result;
-    if (storage_->Read(*it, &result))
-      txn->reads_[*it] = result;
-  }
-
-  // Also read everything in from writeset.
-  for (set<Key>::iterator it = txn->writeset_.begin();
-       it != txn->writeset_.end(); ++it) {
-    // Save each read result iff record exists in storage.
-    Value result;
-    if (storage_->Read(*it, &result))
-      txn->reads_[*it] = result;
-  }
-
-  // Execute txn's program logic.
-  txn->Run();
-
-  // Hand the txn back to the RunScheduler thread.
-  completed_txns_.Push(txn);
-}
-
-void TxnProcessor::ApplyWrites(Txn* txn) {
-  // Write buffered writes out to storage.
-  for (map<Key, Value>::iterator it = txn->writes_.begin();
-       it != txn->writes_.end(); ++it) {
-    storage_->Write(it->first, it->second, txn->unique_id_);
-  }
-}
-
-/**
- * Precondition: No storage writes are occuring during execution.
- */
-bool TxnProcessor::OCCValidateTransaction(const Txn &txn) const {
-  for (auto&& key : txn.readset_) {
-    if (txn.occ_start_time_ < storage_->Timestamp(key))
-      return false;
-  }
-
-  for (auto&& key : txn.writeset_) {
-    if (txn.occ_start_time_ < storage_->Timestamp(key))
-      return false;
-  }
-
-  return true;
-}
-
-void TxnProcessor::RunOCCScheduler() {
-  // Fetch transaction requests, and immediately begin executing them.
-  Txn *txn;
-
-  // While the transaction is active
-  while (tp_.Active()) {
-    // If there is request, pop it -> assign it to txn variable
-    if (txn_requests_.Pop(&txn)) {
-      // Start txn running in its own thread, then run the transaction
-      tp_.RunTask(new Method<TxnProcessor, void, Txn*>(this, &TxnProcessor::ExecuteTxn,txn));
-    }
-
-    // Check every finished transaction done by the request
-    // All transaction done by ExecuteTxn is put into the completed_txns_ queue
-    Txn *finishedTask;
-    while (completed_txns_.Pop(&finishedTask)) {
-      bool valid = true;
-
-      // Validating transaction
-      // All the timestamp of the resources read and write must be bigger than the transactions start time
-
-      // Check read time...
-      for (set<Key>::iterator itr = finishedTask->readset_.begin(); itr != finishedTask->readset_.end(); itr++) {
-        if (storage_->Timestamp(*itr) > finishedTask->occ_start_time_) {
-          valid = false;
-          break;
-        }
-      }
-
-      // Check write time...
-      for (set<Key>::iterator itr = finishedTask->writeset_.begin(); itr != finishedTask->writeset_.end(); itr++) {
-        if (storage_->Timestamp(*itr) > finishedTask->occ_start_time_) {
-          valid = false;
-          break;
-        }
-      }
-
-      // If the transaction is aborted...
-      // No need to run it again. Just put it out...
-      // Set the status to commited
-      if (finishedTask->Status() == COMPLETED_A) {
-        finishedTask->status_ = ABORTED;
-      }
-      // If transaction is valid and not aborted => Write the write commands
-      // Set the status to COMMITTED
-      else if (valid && finishedTask->Status() == COMPLETED_C) {
-        // Write key and value for every finishedTask reads and writes before
-        for (map<Key, Value>::iterator itr = finishedTask->writes_.begin(); itr != finishedTask->writes_.end(); ++itr) {
-          storage_->Write(itr->first, itr->second, finishedTask->unique_id_);
-        }
-        finishedTask->status_ = COMMITTED;
-      }
-      // Else if the task is COMMITED but not valid
-      // Redo the task again
-      else if (!valid && finishedTask->Status() == COMPLETED_C) {
-        // Set empty reads and writes
-        finishedTask->reads_.empty();
-        finishedTask->writes_.empty();
-        finishedTask->status_ = INCOMPLETE;
-
-        // Try transaction again
-        NewTxnRequest(finishedTask);
-        continue;
-      }
-
-      // Else...
-      // That means the task status is invalid.
-      // KILL
-      else {
-        // Invalid TxnStatus!
-        DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
-      }
-      txn_results_.Push(finishedTask);
-    }
-  }
-}
-
-void TxnProcessor::RunOCCParallelScheduler() {
-  // CPSC 438/538:
-  //
-  // Implement this method! Note that implementing OCC with parallel
-  // validation may need to create another method, like
-  // TxnProcessor::ExecuteTxnParallel.
-  // Note that you can use active_set_ and active_set_mutex_ we provided
-  // for you in the txn_processor.h
-  //
-  // [For now, run serial scheduler in order to make it through the test
-  // suite]
-  RunSerialScheduler();
-}
-
-void TxnProcessor::RunMVCCScheduler() {
-  // CPSC 638:
-  //
-  // Implement this method!
-
-  // Hint:Pop a txn from txn_requests_, and pass it to a thread to execute.
-  // Note that you may need to create another execute method, like TxnProcessor::MVCCExecuteTxn.
-  //
-  // [For now, run serial scheduler in order to make it through the test
-  // suite]
-  Txn* txn;
-  while (tp_.Active()) {
-    // If there is transaction request, pop it -> assign it to txn variable
-    if (txn_requests_.Pop(&txn)) {
-      tp_.RunTask(new Method<TxnProcessor, void, Txn*>(
-            this,
-            &TxnProcessor::MVCCExecuteTxn,
-            txn));
-    }
-  }
-}
-
-void TxnProcessor::MVCCExecuteTxn(Txn* txn) {
-  //1. Read all necessary data for this transaction from storage (Note that you should lock the key before each read)
-  
-  for (set<Key>::iterator itr = txn->readset_.begin(); itr != txn->readset_.end(); itr++) {
-    Value result;
-    //lock before read
-    storage_->Lock(*itr);
-    if (storage_->Read(*itr, &result, txn->unique_id_)) {
-      txn->reads_[*itr] = result;
-    }
-    // unlock:
-    storage_->Unlock(*itr);
-  }
-
-  //read from writeset
-  for (set<Key>::iterator itr = txn->writeset_.begin(); itr != txn->writeset_.end(); itr++) {
-    Value result;
-    //lock before read
-    storage_->Lock(*itr);
-    if (storage_->Read(*itr, &result, txn->unique_id_)) {
-      txn->reads_[*itr] = result;
-    }
-    // unlock:
-    storage_->Unlock(*itr);
-  }
-
-  //2. Execute the transaction logic (i.e. call Run() on the transaction)
-  txn->Run();
-  completed_txns_.Push(txn);
-
-  //3. Acquire all locks for ALL keys in the write_set_
-  for (set<Key>::iterator itr = txn->writeset_.begin(); itr != txn->writeset_.end(); itr++) {
-    storage_->Lock(*itr);
-  }
-
-  //4. Call MVCCStorage::CheckWrite method to check all keys in the write_set_
-  bool verified = true;
-  for (set<Key>::iterator itr = txn->writeset_.begin(); itr != txn->writeset_.end(); itr++) {
-    if (storage_->CheckWrite(*itr, txn->unique_id_)) {
-      //still true
-      continue;
-    }
-    else {
-      //if ONLY one failure
-      verified =  false;
-      break;
-    }
-  }
-  
-  //5. If (each key passed the check)
-  if (verified) {
-    //6. Apply the writes
-    ApplyWrites(txn);
-
-    //7.Release all locks for keys in the write_set_
-    for (set<Key>::iterator itr = txn->writeset_.begin(); itr != txn->writeset_.end(); ++itr) {
-      storage_->Unlock(*itr);
-    }
-
-    // Hand the txn back to the RunScheduler thread.
-    txn->status_ = COMMITTED;
-    txn_results_.Push(txn);
-  }
-  // 8. else if (at least one key failed the check)
-  else {
-    //9. Release all locks for keys in the write_set_
-    for (set<Key>::iterator itr = txn->writeset_.begin(); itr != txn->writeset_.end(); itr++) {
-      storage_->Unlock(*itr);
-    }
-
-    //10. Cleanup txn
-    txn->reads_.clear();
-    txn->writes_.clear();
-    txn->status_ = INCOMPLETE;
-
-    //11. Completely restart the transaction
-    NewTxnRequest(txn);
-  }
-
+// Author: Alexander Thomson (thomson@cs.yale.edu)
+// Modified by: Christina Wallin (christina.wallin@yale.edu)
+// Modified by: Kun Ren (kun.ren@yale.edu)
+
+
+#include "txn/txn_processor.h"
+#include <sched.h>
+#include <stdio.h>
+#include <algorithm>
+#include <set>
+
+#include "txn/lock_manager.h"
+#include "utils/random.h"
+
+TxnProcessor::TxnProcessor(CCMode mode, const TxnProcessorConfig& config)
+    : mode_(mode), timestamps_(config.worker_count_ + 4),
+      max_in_flight_(config.max_in_flight_), max_queued_(config.max_queued_),
+      in_flight_(0), queued_(0), admission_waiters_(0), rejected_(0),
+      retry_due_(UINT64_MAX),
+      retry_backoff_cycles_(config.retry_backoff_micros_ * 1000 /
+                            NanosPerCycle()),
+      retry_backoff_max_cycles_(config.retry_backoff_max_micros_ * 1000 /
+                                NanosPerCycle()),
+      result_waiters_(0), applying_(0), applied_(0), blocking_readers_(0),
+      log_(NULL),
+      log_callback_(this), scan_reader_(this), checkpoint_path_(config.checkpoint_path_),
+      lock_policy_(config.lock_policy_), batch_size_(config.batch_size_),
+      batch_cycles_(config.batch_micros_ * 1000 / NanosPerCycle()),
+      hotness_(ADAPTIVE_HOTNESS_SLOTS, ADAPTIVE_HOT_KEY_CONFLICTS),
+      window_optimistic_(0), window_restarted_(0), window_locked_(0),
+      window_waited_(0), optimistic_(0), locked_(0), hot_key_locked_(0),
+      switches_(0), pessimistic_(false), restart_rate_(0), wait_rate_(0),
+      restarts_(0), restarts_avoided_(0),
+      stats_shard_count_(config.worker_count_ + 4),
+      nanos_per_cycle_(NanosPerCycle()), stopped_(false) {
+  if (config.worker_count_ < 1)
+    DIE("TxnProcessor needs at least one worker thread.");
+  if (config.batch_size_ < 1)
+    DIE("CALVIN batches need room for at least one txn.");
+
+  // One stats shard per worker, plus some for the scheduler, the log thread
+  // and clients.
+  stats_shards_ = new TxnStatsShard[stats_shard_count_];
+
+  // Work out where each thread may run.
+  cpu_set_t node_cpus;
+  bool on_node = config.numa_node_ != -1;
+  if (on_node && !NodeCpus(config.numa_node_, &node_cpus))
+    DIE("Unknown NUMA node " << config.numa_node_ << ".");
+
+  vector<cpu_set_t> worker_affinity;
+  for (int i = 0; i < config.worker_count_; i++) {
+    if (i < static_cast<int>(config.worker_cpus_.size()))
+      worker_affinity.push_back(SingleCpu(config.worker_cpus_[i]));
+    else if (on_node)
+      worker_affinity.push_back(node_cpus);
+    else
+      break;
+  }
+
+  if (mode_ == LOCKING_EXCLUSIVE_ONLY)
+    lm_ = new LockManagerA(&ready_txns_);
+  else if (mode_ == LOCKING || mode_ == CALVIN || mode_ == ADAPTIVE)
+    lm_ = new LockManagerB(&ready_txns_);
+  else if (mode_ == LOCKING_PARTITIONED)
+    lm_ = new LockManagerC(&lock_ready_txns_);
+
+  // Create the storage
+  if (mode_ == MVCC && config.storage_type_ == ARRAY_STORAGE) {
+    storage_ = new MVCCArrayStorage(INIT_STORAGE_SIZE, worker_affinity);
+  } else if (mode_ == MVCC) {
+    storage_ = new MVCCStorage();
+  } else if (config.storage_type_ == ARRAY_STORAGE) {
+    storage_ = new ArrayStorage(INIT_STORAGE_SIZE, worker_affinity);
+  } else {
+    storage_ = new Storage();
+  }
+
+  Recover(config);
+
+  if (config.pool_type_ == WORK_STEALING_THREAD_POOL)
+    tp_ = new WorkStealingThreadPool(config.worker_count_, worker_affinity);
+  else
+    tp_ = new StaticThreadPool(config.worker_count_, worker_affinity);
+
+  if (!config.log_path_.empty()) {
+    log_ = new RedoLog(config.log_path_, &log_callback_, config.log_window_,
+                       config.log_group_bytes_);
+  }
+
+  // Start 'RunScheduler()' running.
+  cpu_set_t scheduler_cpus;
+  const cpu_set_t* scheduler_affinity = NULL;
+  if (config.scheduler_cpu_ != -1) {
+    scheduler_cpus = SingleCpu(config.scheduler_cpu_);
+    scheduler_affinity = &scheduler_cpus;
+  } else if (on_node) {
+    scheduler_affinity = &node_cpus;
+  }
+  CreatePinnedThread(&scheduler_thread_, scheduler_affinity, StartScheduler,
+                     reinterpret_cast<void*>(this));
+}
+
+void* TxnProcessor::StartScheduler(void * arg) {
+  reinterpret_cast<TxnProcessor *>(arg)->RunScheduler();
+  return NULL;
+}
+
+TxnProcessor::~TxnProcessor() {
+  // Stop the scheduler first so that it hands no more tasks to the thread
+  // pool, then let the pool finish the tasks it already has. Only then is it
+  // safe to free what they use.
+  stopped_ = true;
+  pthread_join(scheduler_thread_, NULL);
+  tp_->Stop();
+  delete tp_;
+
+  // Returns the results still waiting for the log.
+  delete log_;
+
+  if (mode_ == LOCKING_EXCLUSIVE_ONLY || mode_ == LOCKING ||
+      mode_ == LOCKING_PARTITIONED || mode_ == CALVIN || mode_ == ADAPTIVE)
+    delete lm_;
+
+  delete storage_;
+  delete[] stats_shards_;
+}
+
+// Applies the redo records of the txns that a checkpoint does not reflect.
+class StorageReplayer : public LogReader {
+ public:
+  StorageReplayer(Storage* storage, uint64 snapshot_id)
+      : max_id_(snapshot_id), storage_(storage), snapshot_id_(snapshot_id) {}
+
+  virtual void Record(uint64 unique_id, const KeyValue* writes, uint32 count,
+                      const KeyValue* increments, uint32 increment_count) {
+    max_id_ = std::max(max_id_, unique_id);
+    if (unique_id < snapshot_id_)
+      return;
+    // MVCC storage orders the versions by id, as it did when they were
+    // first installed. Only MVCC logs increments; other modes log what they
+    // resolved to.
+    for (uint32 i = 0; i < count; i++)
+      storage_->Write(writes[i].key_, writes[i].value_, unique_id);
+    for (uint32 i = 0; i < increment_count; i++)
+      storage_->Increment(increments[i].key_, increments[i].value_, unique_id);
+  }
+
+  // Largest id seen so far.
+  uint64 max_id_;
+
+ private:
+  Storage* storage_;
+  uint64 snapshot_id_;
+};
+
+void TxnProcessor::Recover(const TxnProcessorConfig& config) {
+  MappedCheckpoint checkpoint;
+  LSN start = 0;
+  uint64 snapshot_id = 0;
+  if (!checkpoint_path_.empty() && checkpoint.Open(checkpoint_path_)) {
+    storage_->BulkLoad(checkpoint.Records(), checkpoint.Header().record_count_);
+    start = checkpoint.Header().log_lsn_;
+    snapshot_id = checkpoint.Header().snapshot_id_;
+  } else {
+    storage_->InitStorage();
+  }
+
+  // Keep ids increasing across restarts, which the snapshot ids of later
+  // checkpoints depend on.
+  StorageReplayer replayer(storage_, snapshot_id);
+  if (!config.log_path_.empty())
+    RedoLog::Replay(config.log_path_, start, &replayer);
+  timestamps_.Reset(replayer.max_id_ + 1);
+}
+
+void TxnProcessor::Checkpoint() {
+  if (checkpoint_path_.empty())
+    DIE("Checkpoint() needs a checkpoint_path_.");
+
+  // Every record appended before 'lsn' is of a txn that had already
+  // validated and holds its write locks (MVCC) or is done (other modes), so
+  // the snapshot reflects it. Later ones are reflected exactly if their txn
+  // got a smaller id than the snapshot, since such a txn cannot install a
+  // write after the snapshot read the key.
+  LSN lsn = log_ == NULL ? 0 : log_->Tail();
+  // In MVCC mode the snapshot id stays active, holding back GC of what it
+  // reads.
+  int shard = 0;
+  uint64 snapshot_id = mode_ == MVCC ? timestamps_.Begin(1, &shard)
+                                     : timestamps_.Next();
+
+  vector<KeyValue> records;
+  storage_->Snapshot(&records, snapshot_id);
+
+  if (mode_ == MVCC)
+    timestamps_.End(snapshot_id, shard);
+
+  WriteCheckpoint(checkpoint_path_, lsn, snapshot_id, &records);
+}
+
+void TxnProcessor::NewTxnRequest(Txn* txn) {
+  NewTxnRequests(&txn, 1);
+}
+
+void TxnProcessor::NewTxnRequest(Txn* txn, TxnCallback* callback) {
+  txn->callback_ = callback;
+  NewTxnRequests(&txn, 1);
+}
+
+bool TxnProcessor::TryNewTxnRequest(Txn* txn) {
+  return TryNewTxnRequest(txn, NULL);
+}
+
+bool TxnProcessor::TryNewTxnRequest(Txn* txn, TxnCallback* callback) {
+  if (!Admit(1, false)) {
+    rejected_++;
+    return false;
+  }
+  txn->callback_ = callback;
+  SubmitTxns(&txn, 1);
+  return true;
+}
+
+void TxnProcessor::NewTxnRequests(Txn** txns, size_t count) {
+  Admit(count, true);
+  SubmitTxns(txns, count);
+}
+
+void TxnProcessor::ResubmitTxnRequests(Txn** txns, size_t count) {
+  in_flight_.fetch_add(count);
+  queued_.fetch_add(count);
+  SubmitTxns(txns, count);
+}
+
+// Room for a request that fits nowhere else is made by waiting for the
+// processor to drain: 'used' == 0.
+static bool Fits(uint64 used, size_t count, size_t limit) {
+  return limit == 0 || used == 0 || used + count <= limit;
+}
+
+bool TxnProcessor::Admit(size_t count, bool wait) {
+  while (true) {
+    // Reserve first and check after, so that concurrent clients cannot all
+    // see the same free room.
+    uint64 in_flight = in_flight_.fetch_add(count);
+    uint64 queued = queued_.fetch_add(count);
+    if (Fits(in_flight, count, max_in_flight_) &&
+        Fits(queued, count, max_queued_))
+      return true;
+    in_flight_.fetch_sub(count);
+    queued_.fetch_sub(count);
+    WakeAdmissions();
+    if (!wait)
+      return false;
+
+    // Announce the wait before checking again, as in GetTxnResults().
+    admission_waiters_.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    admission_.WaitUntil([&]() {
+      return Fits(in_flight_.load(), count, max_in_flight_) &&
+             Fits(queued_.load(), count, max_queued_);
+    }, -1);
+    admission_waiters_.fetch_sub(1);
+  }
+}
+
+void TxnProcessor::WakeAdmissions() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (admission_waiters_.load(std::memory_order_relaxed) > 0)
+    admission_.Broadcast();
+}
+
+void TxnProcessor::SubmitTxns(Txn** txns, size_t count) {
+  AssignIds(txns, count);
+  uint64 now = CycleClock();
+  for (size_t i = 0; i < count; i++) {
+    TxnTimes* times = &txns[i]->times_;
+    if (times->submitted_ == 0)
+      times->submitted_ = now;
+    times->queued_ = now;
+    times->scheduled_ = times->locked_ = 0;
+    times->executed_ = times->finished_ = 0;
+  }
+
+  // Add them to the incoming txn requests queue.
+  for (size_t i = 0; i < count; i++)
+    txn_requests_.Push(txns[i]);
+}
+
+void TxnProcessor::AssignIds(Txn** txns, size_t count) {
+  // Atomically assign the txns consecutive numbers. In MVCC mode they are
+  // registered as active in the same step, or the GC low-water mark could
+  // pass an id before it is registered.
+  int shard = 0;
+  uint64 id = mode_ == MVCC ? timestamps_.Begin(count, &shard)
+                            : timestamps_.Next(count);
+  for (size_t i = 0; i < count; i++) {
+    txns[i]->unique_id_ = id + i;
+    txns[i]->timestamp_shard_ = shard;
+    txns[i]->scan_source_ = &scan_reader_;
+  }
+}
+
+void TxnProcessor::RetryTxn(Txn* txn) {
+  // Exponential backoff from the second retry on, with jitter; none once
+  // the txn has aged.
+  txn->retries_++;
+  uint64 now = CycleClock();
+  uint64 delay = 0;
+  if (txn->retries_ > 1 && txn->retries_ < RETRY_AGED_RETRIES) {
+    delay = std::min(retry_backoff_max_cycles_,
+                     retry_backoff_cycles_ << (txn->retries_ - 2));
+    delay -= ThreadRandom()->Uniform(delay / 2 + 1);
+  }
+  CountRestart(delay > 0);
+
+  // Aged txns are due before anything else.
+  TxnTimes* times = &txn->times_;
+  times->queued_ = now;
+  times->scheduled_ = times->locked_ = 0;
+  times->executed_ = times->finished_ = 0;
+  Retry retry = {txn->retries_ >= RETRY_AGED_RETRIES ? 0 : now + delay,
+                 times->submitted_, txn};
+  retry_mutex_.Lock();
+  retry_queue_.push(retry);
+  retry_due_ = retry_queue_.top().due_;
+  retry_mutex_.Unlock();
+}
+
+Txn* TxnProcessor::GetTxnResult() {
+  Txn* txn;
+  while (GetTxnResults(&txn, 1) == 0) {}
+  return txn;
+}
+
+size_t TxnProcessor::GetTxnResults(Txn** results, size_t max, double timeout) {
+  // Results usually follow each other closely, so poll for a little while
+  // before paying for a sleep and a wakeup.
+  size_t count = 0;
+  for (int round = 0; ; round++) {
+    while (count < max && txn_results_.Pop(&results[count]))
+      count++;
+    if (count > 0 || timeout == 0)
+      return count;
+    if (round == RESULT_POLLS_BEFORE_SLEEPING)
+      break;
+    sched_yield();
+  }
+
+  // Announce the wait before checking the queue again, so that a producer
+  // either sees the announcement or pushed before the check.
+  result_waiters_.fetch_add(1);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  results_ready_.WaitUntil([&]() {
+    while (count < max && txn_results_.Pop(&results[count]))
+      count++;
+    return count > 0;
+  }, timeout);
+  result_waiters_.fetch_sub(1);
+  return count;
+}
+
+LSN TxnProcessor::LogWrites(Txn* txn) {
+  if (log_ == NULL)
+    return 0;
+  // A read-only txn waits for the records of the writes it may have read.
+  return txn->writes_.empty() && txn->increments_.empty() ? log_->Tail()
+                                                          : log_->Append(txn);
+}
+
+void TxnProcessor::FinishTxn(Txn* txn, LSN lsn) {
+  if (log_ != NULL && txn->status_ == COMMITTED)
+    log_->NotifyWhenDurable(txn, lsn);
+  else
+    PushResult(txn);
+}
+
+void TxnProcessor::FinishTxns(Txn** txns, const LSN* lsns, int count) {
+  if (log_ == NULL) {
+    PushResults(txns, count);
+    return;
+  }
+  for (int i = 0; i < count; i++)
+    FinishTxn(txns[i], lsns[i]);
+}
+
+// Returns a small number identifying the calling thread.
+static int ThreadIndex() {
+  static std::atomic<int> next_index(0);
+  static thread_local int index = next_index++;
+  return index;
+}
+
+TxnProcessor::TxnStatsShard* TxnProcessor::ThreadStatsShard() {
+  return &stats_shards_[ThreadIndex() % stats_shard_count_];
+}
+
+// Records the time from 'start' to 'end' in nanoseconds, if both boundaries
+// were reached.
+static inline void RecordPhase(Histogram* histogram, uint64 start, uint64 end,
+                               double nanos_per_cycle) {
+  if (start != 0 && end >= start)
+    histogram->Record((end - start) * nanos_per_cycle);
+}
+
+bool TxnProcessor::PopRequest(Txn** txn) {
+  return PopRequests(txn, 1) == 1;
+}
+
+int TxnProcessor::PopRequests(Txn** txns, int max) {
+  // Retries that are due go ahead of new requests.
+  uint64 now = CycleClock();
+  int count = 0;
+  if (now >= retry_due_.load(std::memory_order_relaxed))
+    count = PopRetries(txns, max, now);
+
+  int fresh = 0;
+  while (count < max && txn_requests_.Pop(&txns[count])) {
+    count++;
+    fresh++;
+  }
+  if (fresh > 0) {
+    queued_.fetch_sub(fresh);
+    if (max_queued_ != 0)
+      WakeAdmissions();
+  }
+
+  for (int i = 0; i < count; i++)
+    txns[i]->times_.scheduled_ = now;
+  return count;
+}
+
+int TxnProcessor::PopRetries(Txn** txns, int max, uint64 now) {
+  int count = 0;
+  retry_mutex_.Lock();
+  while (count < max && !retry_queue_.empty() &&
+         retry_queue_.top().due_ <= now) {
+    txns[count++] = retry_queue_.top().txn_;
+    retry_queue_.pop();
+  }
+  retry_due_ = retry_queue_.empty() ? UINT64_MAX : retry_queue_.top().due_;
+  retry_mutex_.Unlock();
+
+  // Retries get new ids (and in MVCC, new snapshots) as they are taken.
+  if (count > 0)
+    AssignIds(txns, count);
+  return count;
+}
+
+void TxnProcessor::CountRestart(bool backed_off) {
+  TxnStatsShard* shard = ThreadStatsShard();
+  shard->mutex_.Lock();
+  shard->restarts_++;
+  if (backed_off)
+    shard->backoffs_++;
+  shard->mutex_.Unlock();
+}
+
+void TxnProcessor::GetTxnStats(TxnStats* stats) {
+  stats->committed_ = 0;
+  stats->aborted_ = 0;
+  stats->restarts_ = 0;
+  stats->backoffs_ = 0;
+  stats->rejected_ = rejected_.load();
+  stats->read_only_committed_ = 0;
+  for (int phase = 0; phase < TXN_PHASES; phase++)
+    stats->latency_[phase].Clear();
+
+  for (int i = 0; i < stats_shard_count_; i++) {
+    TxnStatsShard* shard = &stats_shards_[i];
+    shard->mutex_.Lock();
+    stats->committed_ += shard->committed_;
+    stats->aborted_ += shard->aborted_;
+    stats->restarts_ += shard->restarts_;
+    stats->backoffs_ += shard->backoffs_;
+    stats->read_only_committed_ += shard->read_only_committed_;
+    for (int phase = 0; phase < TXN_PHASES; phase++)
+      stats->latency_[phase].Merge(shard->latency_[phase]);
+    shard->mutex_.Unlock();
+  }
+}
+
+void TxnProcessor::RecordResult(TxnStatsShard* shard, const Txn& txn,
+                                uint64 now) {
+  const TxnTimes& times = txn.times_;
+  if (txn.status_ == COMMITTED) {
+    shard->committed_++;
+    if (txn.writeset_.empty() && txn.incrementset_.empty())
+      shard->read_only_committed_++;
+  } else {
+    shard->aborted_++;
+  }
+  RecordPhase(&shard->latency_[PHASE_QUEUE], times.queued_, times.scheduled_,
+              nanos_per_cycle_);
+  if (times.locked_ != 0) {
+    RecordPhase(&shard->latency_[PHASE_LOCK_WAIT], times.scheduled_,
+                times.locked_, nanos_per_cycle_);
+  }
+  RecordPhase(&shard->latency_[PHASE_EXECUTE], times.executed_,
+              times.finished_, nanos_per_cycle_);
+  RecordPhase(&shard->latency_[PHASE_COMMIT], times.finished_, now,
+              nanos_per_cycle_);
+  RecordPhase(&shard->latency_[PHASE_TOTAL], times.submitted_, now,
+              nanos_per_cycle_);
+}
+
+bool TxnProcessor::DeliverResult(Txn* txn) {
+  // Restarts resubmit the txn with its callback in place, so it is only
+  // detached here, once the txn is done for good.
+  if (txn->callback_ != NULL) {
+    TxnCallback* callback = txn->callback_;
+    txn->callback_ = NULL;
+    callback->Done(txn);
+    return false;
+  }
+  txn_results_.Push(txn);
+  return true;
+}
+
+void TxnProcessor::PushResult(Txn* txn) {
+  PushResults(&txn, 1);
+}
+
+void TxnProcessor::PushResults(Txn** txns, int count) {
+  uint64 now = CycleClock();
+  TxnStatsShard* shard = ThreadStatsShard();
+  shard->mutex_.Lock();
+  for (int i = 0; i < count; i++)
+    RecordResult(shard, *txns[i], now);
+  shard->mutex_.Unlock();
+
+  // The txns leave the processor here, making room for new ones.
+  in_flight_.fetch_sub(count);
+  if (max_in_flight_ != 0)
+    WakeAdmissions();
+
+  bool queued = false;
+  for (int i = 0; i < count; i++)
+    queued = DeliverResult(txns[i]) || queued;
+  if (!queued)
+    return;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (result_waiters_.load(std::memory_order_relaxed) > 0)
+    results_ready_.Signal();
+}
+
+void TxnProcessor::GetGCStats(GCStats* stats) {
+  if (mode_ == MVCC) {
+    static_cast<MVCCStorage*>(storage_)->GetGCStats(stats);
+  } else {
+    stats->versions_reclaimed_ = 0;
+    stats->chain_length_p50_ = 0;
+    stats->chain_length_p99_ = 0;
+    stats->chain_length_max_ = 0;
+  }
+}
+
+void TxnProcessor::GetLockStats(LockStats* stats) {
+  stats->restarts_ = restarts_;
+  stats->restarts_avoided_ = restarts_avoided_;
+}
+
+void TxnProcessor::GetAdaptiveStats(AdaptiveStats* stats) {
+  stats->optimistic_ = optimistic_;
+  stats->locked_ = locked_;
+  stats->hot_key_locked_ = hot_key_locked_;
+  stats->switches_ = switches_;
+  stats->pessimistic_ = pessimistic_;
+  stats->restart_rate_ = restart_rate_;
+  stats->wait_rate_ = wait_rate_;
+}
+
+void TxnProcessor::GetLogStats(LogStats* stats) {
+  if (log_ != NULL) {
+    log_->GetStats(stats);
+  } else {
+    stats->groups_ = 0;
+    stats->records_ = 0;
+    stats->bytes_ = 0;
+  }
+}
+
+void TxnProcessor::RunScheduler() {
+  switch (mode_) {
+    case SERIAL:                 RunSerialScheduler(); break;
+    case LOCKING:                RunLockingScheduler(); break;
+    case LOCKING_EXCLUSIVE_ONLY: RunLockingScheduler(); break;
+    case OCC:                    RunOCCScheduler(); break;
+    case P_OCC:                  RunOCCParallelScheduler(); break;
+    case MVCC:                   RunMVCCScheduler(); break;
+    case LOCKING_PARTITIONED:    RunPartitionedLockingScheduler(); break;
+    case CALVIN:                 RunCalvinScheduler(); break;
+    case ADAPTIVE:               RunAdaptiveScheduler();
+  }
+}
+
+void TxnProcessor::RunSerialScheduler() {
+  Txn* txn;
+  while (!stopped_) {
+    // Get next txn request.
+    if (PopRequest(&txn)) {
+      // Execute txn.
+      ExecuteTxn(txn);
+
+      // Commit/abort txn according to program logic's commit/abort decision.
+      LSN lsn = 0;
+      if (txn->Status() == COMPLETED_C) {
+        ResolveIncrements(txn);
+        lsn = LogWrites(txn);
+        ApplyWrites(txn);
+        txn->status_ = COMMITTED;
+      } else if (txn->Status() == COMPLETED_A) {
+        txn->status_ = ABORTED;
+      } else {
+        // Invalid TxnStatus!
+        DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+      }
+
+      // Return result to client.
+      FinishTxn(txn, lsn);
+    }
+
+    sched_yield();
+  }
+}
+
+void TxnProcessor::RunLockingScheduler() {
+  // Requests are taken a batch at a time, as are the finished txns that
+  // FinishLockedTxns() commits.
+  Txn* requests[PIPELINE_BATCH];
+  while (!stopped_) {
+    int count = PopRequests(requests, PIPELINE_BATCH);
+    for (int i = 0; i < count; i++) {
+      Txn* txn = requests[i];
+      if (RunReadOnly(txn))
+        continue;
+
+      bool blocked = false;
+      int total = txn->readset_.size() + txn->writeset_.size() +
+                  txn->incrementset_.size() + txn->scanset_.size();
+
+      if (lock_policy_ == WAIT_ON_CONFLICT) {
+        // Every request of the txn is queued here, in one go, on the only
+        // thread that ever touches the lock manager. Each lock queue is
+        // therefore ordered by arrival at the scheduler, a txn can only wait
+        // for txns that arrived before it, and there are no deadlocks. The
+        // lock manager moves the txn to ready_txns_ once it holds them all.
+        for (KeySet::const_iterator itr = txn->readset_.begin(); itr != txn->readset_.end(); itr++) {
+          if (!lm_->ReadLock(txn, *itr))
+            blocked = true;
+        }
+        for (KeySet::const_iterator itr = txn->writeset_.begin(); itr != txn->writeset_.end(); itr++) {
+          if (!lm_->WriteLock(txn, *itr))
+            blocked = true;
+        }
+        for (KeySet::const_iterator itr = txn->incrementset_.begin(); itr != txn->incrementset_.end(); itr++) {
+          if (!lm_->IncrementLock(txn, *itr))
+            blocked = true;
+        }
+        // Ranges go last, as the lock manager requires.
+        for (const KeyRange* range = txn->scanset_.begin();
+             range != txn->scanset_.end(); ++range) {
+          if (!lm_->RangeReadLock(txn, range->lo_, range->hi_))
+            blocked = true;
+        }
+
+        if (!blocked)
+          ready_txns_.push_back(txn);
+        else if (total > 1)
+          restarts_avoided_++;
+      } else {
+        // Request read locks (EXCLUSIVE LOCK if part A)
+        for (KeySet::const_iterator itr = txn->readset_.begin(); itr != txn->readset_.end(); itr++) {
+          // block if the read lock could not be set (needs to wait or destroyed if total > 1)
+          if (!lm_ ->ReadLock(txn, *itr)) {
+            blocked = true;
+            if (total > 1) {
+              // Release all locks that already acquired
+              lm_->ReleaseAll(txn);
+              break;
+            }
+          }
+        }
+
+        if (!blocked) {
+          // Request write locks (EXCLUSIVE LOCK)
+          for (KeySet::const_iterator itr = txn->writeset_.begin(); itr != txn->writeset_.end(); itr++) {
+            // block if the read lock could not be set (needs to wait or destroyed if total > 1)
+            if (!lm_ ->WriteLock(txn, *itr)) {
+              blocked = true;
+              if (total > 1) {
+                // Release all locks that already acquired
+                lm_->ReleaseAll(txn);
+                break;
+              }
+            }
+          }
+        }
+
+        if (!blocked) {
+          // Request increment locks (shared among incrementers)
+          for (KeySet::const_iterator itr = txn->incrementset_.begin(); itr != txn->incrementset_.end(); itr++) {
+            if (!lm_->IncrementLock(txn, *itr)) {
+              blocked = true;
+              if (total > 1) {
+                lm_->ReleaseAll(txn);
+                break;
+              }
+            }
+          }
+        }
+
+        if (!blocked) {
+          // Request range locks, last, as the lock manager requires.
+          for (const KeyRange* range = txn->scanset_.begin();
+               range != txn->scanset_.end(); ++range) {
+            if (!lm_->RangeReadLock(txn, range->lo_, range->hi_)) {
+              blocked = true;
+              if (total > 1) {
+                lm_->ReleaseAll(txn);
+                break;
+              }
+            }
+          }
+        }
+
+        // If all read and write locks were immediately acquired, this txn is
+        if (!blocked) {
+          ready_txns_.push_back(txn);
+        }
+        // If the transaction is blocked, check the validity
+        // Rule no.2: transaction waits only if it only involves one read or write
+        // If not-> delete all acquired locks -> restart transation
+        else if (blocked && (total > 1)) {
+          restarts_++;
+          RetryTxn(txn);
+        }
+      }
+    }
+
+    FinishLockedTxns();
+    RunReadyTxns();
+
+    sched_yield();
+  }
+}
+
+void TxnProcessor::FinishLockedTxns() {
+  // Process and commit all transactions that have finished running, a batch
+  // at a time.
+  Txn* txns[PIPELINE_BATCH];
+  LSN lsns[PIPELINE_BATCH];
+  int count;
+  do {
+    count = 0;
+    while (count < PIPELINE_BATCH && completed_txns_.Pop(&txns[count]))
+      count++;
+    if (count > 0)
+      CommitLockedTxns(txns, lsns, count);
+  } while (count == PIPELINE_BATCH);
+}
+
+void TxnProcessor::CommitLockedTxns(Txn** txns, LSN* lsns, int count) {
+  bool applying = false;
+  for (int i = 0; i < count; i++) {
+    Txn* txn = txns[i];
+    lsns[i] = 0;
+    if (txn->Status() == COMPLETED_A) {
+      txn->status_ = ABORTED;
+    } else if (txn->Status() == COMPLETED_C) {
+      if (!applying) {
+        BeginApply();
+        applying = true;
+      }
+      // Increment locks are shared, so an earlier txn of the batch may have
+      // a write pending on the key.
+      if (!txn->increments_.empty())
+        ApplyPendingWrites();
+      ResolveIncrements(txn);
+      lsns[i] = LogWrites(txn);
+      for (KeyValueMap::iterator itr = txn->writes_.begin();
+           itr != txn->writes_.end(); ++itr) {
+        PendingWrite write = {itr->first, itr->second, txn->unique_id_};
+        pending_writes_.push_back(write);
+      }
+      txn->status_ = COMMITTED;
+    } else {
+      // Invalid TxnStatus!
+      DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+    }
+  }
+  if (applying) {
+    ApplyPendingWrites();
+    EndApply();
+  }
+
+  // Release all read and write locks, then return the results to clients.
+  for (int i = 0; i < count; i++)
+    lm_->ReleaseAll(txns[i]);
+  FinishTxns(txns, lsns, count);
+}
+
+// The pending keys are distinct: a txn holds an exclusive lock on each key
+// it writes, and CommitLockedTxns() applies what is pending before it
+// resolves increments. Sorting by key sends the writes to storage partition
+// by partition, and in address order within each.
+void TxnProcessor::ApplyPendingWrites() {
+  sort(pending_writes_.begin(), pending_writes_.end());
+  for (size_t i = 0; i < pending_writes_.size(); i++) {
+    const PendingWrite& write = pending_writes_[i];
+    storage_->Write(write.key_, write.value_, write.txn_unique_id_);
+  }
+  pending_writes_.clear();
+}
+
+void TxnProcessor::FinishLockedTxn(Txn* txn) {
+  // Commit/abort txn according to program logic's commit/abort decision.
+  // If transaction is aborted => abort
+  LSN lsn = 0;
+  if (txn->Status() == COMPLETED_A) {
+    txn->status_ = ABORTED;
+  }
+  // If the transaction is commited => write the result to storage
+  else if (txn->Status() == COMPLETED_C) {
+    ResolveIncrements(txn);
+    lsn = LogWrites(txn);
+    BeginApply();
+    for (KeyValueMap::iterator itr = txn->writes_.begin(); itr != txn->writes_.end(); ++itr) {
+      storage_->Write(itr->first, itr->second, txn->unique_id_);
+    }
+    EndApply();
+    txn->status_ = COMMITTED;
+  }
+  // Else the status is invalid
+  else {
+    // Invalid TxnStatus!
+    DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+  }
+
+  // Release all read and write locks
+  lm_->ReleaseAll(txn);
+
+  // Return result to client.
+  FinishTxn(txn, lsn);
+}
+
+void TxnProcessor::RunReadyTxns() {
+  // Executing ready transactions
+  while (ready_txns_.size() > 0) {
+    // Get next ready txn from the queue
+    Txn* txn = ready_txns_.front();
+    ready_txns_.pop_front();
+    txn->times_.locked_ = CycleClock();
+
+    // Start txn running in its own thread
+    Dispatch<&TxnProcessor::ExecuteTxn>(txn);
+  }
+}
+
+void TxnProcessor::RunCalvinScheduler() {
+  vector<Txn*> batch;
+  batch.reserve(batch_size_);
+  uint64 batch_start = 0;
+  Txn* txn;
+  while (!stopped_) {
+    // Fill the open epoch. Read-only txns take no locks, so they need no
+    // place in it.
+    while (batch.size() < batch_size_ && PopRequest(&txn)) {
+      if (RunReadOnly(txn))
+        continue;
+      if (batch.empty())
+        batch_start = CycleClock();
+      batch.push_back(txn);
+    }
+
+    // Close it once it is full or old enough, and queue its locks in order.
+    if (!batch.empty() && (batch.size() >= batch_size_ ||
+                           CycleClock() - batch_start >= batch_cycles_)) {
+      for (size_t i = 0; i < batch.size(); i++)
+        QueueLocks(batch[i], NULL);
+      batch.clear();
+    }
+
+    FinishLockedTxns();
+    RunReadyTxns();
+
+    sched_yield();
+  }
+}
+
+bool TxnProcessor::QueueLocks(Txn* txn, KeyHotness* conflicts) {
+  // Merge the two sorted sets so that the requests go out in key order.
+  bool blocked = false;
+  KeySet::const_iterator r = txn->readset_.begin();
+  KeySet::const_iterator w = txn->writeset_.begin();
+  while (r != txn->readset_.end() || w != txn->writeset_.end()) {
+    Key key;
+    bool granted;
+    if (w == txn->writeset_.end() ||
+        (r != txn->readset_.end() && *r < *w)) {
+      key = *r++;
+      granted = lm_->ReadLock(txn, key);
+    } else {
+      // A key in both sets only needs the write lock.
+      if (r != txn->readset_.end() && *r == *w)
+        r++;
+      key = *w++;
+      granted = lm_->WriteLock(txn, key);
+    }
+    if (!granted) {
+      blocked = true;
+      if (conflicts != NULL)
+        conflicts->Touch(key);
+    }
+  }
+
+  // Increment keys are in neither set.
+  for (auto&& key : txn->incrementset_) {
+    if (!lm_->IncrementLock(txn, key)) {
+      blocked = true;
+      if (conflicts != NULL)
+        conflicts->Touch(key);
+    }
+  }
+
+  // Ranges go last, as the lock manager requires.
+  for (const KeyRange* range = txn->scanset_.begin();
+       range != txn->scanset_.end(); ++range) {
+    if (!lm_->RangeReadLock(txn, range->lo_, range->hi_))
+      blocked = true;
+  }
+
+  if (!blocked)
+    ready_txns_.push_back(txn);
+  else if (txn->readset_.size() + txn->writeset_.size() +
+           txn->incrementset_.size() + txn->scanset_.size() > 1)
+    restarts_avoided_++;
+  return !blocked;
+}
+
+void TxnProcessor::RunAdaptiveScheduler() {
+  Txn* txn;
+  while (!stopped_) {
+    if (PopRequest(&txn) && !RunReadOnly(txn)) {
+      txn->optimistic_ = !AdaptiveShouldLock(*txn);
+      if (txn->optimistic_) {
+        Dispatch<&TxnProcessor::ExecuteTxn>(txn);
+      } else if (!QueueLocks(txn, &hotness_)) {
+        window_waited_++;
+      }
+      AdaptiveSample();
+    }
+
+    // Both kinds of txns finish here, one at a time, so an OCC txn's
+    // validation sees every lock held by a txn that has not finished.
+    while (completed_txns_.Pop(&txn)) {
+      if (!txn->optimistic_) {
+        FinishLockedTxn(txn);
+        continue;
+      }
+
+      LSN lsn = 0;
+      if (txn->Status() == COMPLETED_A) {
+        txn->status_ = ABORTED;
+      } else if (txn->Status() == COMPLETED_C && AdaptiveValidate(*txn)) {
+        ResolveIncrements(txn);
+        lsn = LogWrites(txn);
+        BeginApply();
+        ApplyWrites(txn);
+        EndApply();
+        txn->status_ = COMMITTED;
+      } else if (txn->Status() == COMPLETED_C) {
+        window_restarted_++;
+        txn->Restart();
+        RetryTxn(txn);
+        continue;
+      } else {
+        DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+      }
+      FinishTxn(txn, lsn);
+    }
+
+    RunReadyTxns();
+
+    sched_yield();
+  }
+}
+
+bool TxnProcessor::AdaptiveShouldLock(const Txn& txn) {
+  bool lock = pessimistic_ || txn.two_phase_;
+  if (!lock) {
+    for (auto&& key : txn.readset_)
+      lock = lock || hotness_.Hot(key);
+    for (auto&& key : txn.writeset_)
+      lock = lock || hotness_.Hot(key);
+    for (auto&& key : txn.incrementset_)
+      lock = lock || hotness_.Hot(key);
+    if (lock)
+      hot_key_locked_++;
+  }
+
+  if (lock) {
+    locked_++;
+    window_locked_++;
+  } else {
+    optimistic_++;
+    window_optimistic_++;
+  }
+  return lock;
+}
+
+bool TxnProcessor::AdaptiveValidate(const Txn& txn) {
+  bool valid = true;
+  const uint64* version = txn.occ_versions_.begin();
+  for (auto&& key : txn.readset_) {
+    if (storage_->RecordVersion(key) != *version++ ||
+        lm_->Status(key, NULL) == EXCLUSIVE) {
+      hotness_.Touch(key);
+      valid = false;
+    }
+  }
+  for (auto&& key : txn.writeset_) {
+    if (storage_->RecordVersion(key) != *version++ ||
+        lm_->Status(key, NULL) != UNLOCKED) {
+      hotness_.Touch(key);
+      valid = false;
+    }
+  }
+  // Increments commute with those of locked txns, but not with their reads
+  // and writes.
+  for (auto&& key : txn.incrementset_) {
+    LockMode mode = lm_->Status(key, NULL);
+    if (mode == SHARED || mode == EXCLUSIVE) {
+      hotness_.Touch(key);
+      valid = false;
+    }
+  }
+  for (const ScanRead* scan = txn.scans_.begin(); scan != txn.scans_.end();
+       ++scan) {
+    LockMode mode = lm_->RangeStatus(scan->lo_, scan->end_);
+    if (mode == EXCLUSIVE || mode == INCREMENT)
+      valid = false;
+  }
+  return valid && ScansValid(txn);
+}
+
+void TxnProcessor::AdaptiveSample() {
+  if (window_optimistic_ + window_locked_ < ADAPTIVE_WINDOW)
+    return;
+
+  // A rate is only updated by a window that ran txns of its kind. Going
+  // back to OCC takes a window of locking with few waits, so the two
+  // thresholds keep the mode from flapping.
+  if (window_optimistic_ > 0)
+    restart_rate_ = static_cast<double>(window_restarted_) / window_optimistic_;
+  if (window_locked_ > 0)
+    wait_rate_ = static_cast<double>(window_waited_) / window_locked_;
+  if (!pessimistic_ && window_optimistic_ > 0 &&
+      restart_rate_ > ADAPTIVE_MAX_RESTART_RATE) {
+    pessimistic_ = true;
+    switches_++;
+  } else if (pessimistic_ && wait_rate_ < ADAPTIVE_MIN_WAIT_RATE) {
+    pessimistic_ = false;
+    switches_++;
+  }
+
+  hotness_.Decay();
+  window_optimistic_ = window_restarted_ = 0;
+  window_locked_ = window_waited_ = 0;
+}
+
+void TxnProcessor::RunPartitionedLockingScheduler() {
+  Txn* txn;
+  while (!stopped_) {
+    if (PopRequest(&txn) && !RunReadOnly(txn)) {
+      Dispatch<&TxnProcessor::PartitionedLockTxn>(txn);
+    }
+
+    while (lock_ready_txns_.Pop(&txn)) {
+      Dispatch<&TxnProcessor::PartitionedExecuteTxn>(txn);
+    }
+
+    sched_yield();
+  }
+}
+
+void TxnProcessor::PartitionedLockTxn(Txn* txn) {
+  if (!txn->scanset_.empty())
+    DIE("LOCKING_PARTITIONED does not support scans.");
+  LockManagerC* lm = static_cast<LockManagerC*>(lm_);
+  // Increments are resolved into writes by the worker, so they are locked
+  // exclusively here.
+  const KeySet* writeset = &txn->writeset_;
+  KeySet writes;
+  if (!txn->incrementset_.empty()) {
+    writes = txn->writeset_;
+    for (auto&& key : txn->incrementset_)
+      writes.insert(key);
+    writeset = &writes;
+  }
+  if (lm->LockAll(txn, txn->readset_, *writeset)) {
+    PartitionedExecuteTxn(txn);
+  } else if (txn->readset_.size() + writeset->size() > 1) {
+    restarts_avoided_++;
+  }
+}
+
+void TxnProcessor::PartitionedExecuteTxn(Txn* txn) {
+  txn->times_.locked_ = txn->times_.executed_ = CycleClock();
+
+  // Read everything in from readset and writeset.
+  for (KeySet::const_iterator it = txn->readset_.begin();
+       it != txn->readset_.end(); ++it) {
+    Value result;
+    if (storage_->Read(*it, &result))
+      txn->reads_[*it] = result;
+  }
+  for (KeySet::const_iterator it = txn->writeset_.begin();
+       it != txn->writeset_.end(); ++it) {
+    Value result;
+    if (storage_->Read(*it, &result))
+      txn->reads_[*it] = result;
+  }
+
+  txn->Run();
+  txn->times_.finished_ = CycleClock();
+
+  // Commit/abort txn according to program logic's commit/abort decision.
+  LSN lsn = 0;
+  if (txn->Status() == COMPLETED_C) {
+    ResolveIncrements(txn);
+    lsn = LogWrites(txn);
+    BeginApply();
+    ApplyWrites(txn);
+    EndApply();
+    txn->status_ = COMMITTED;
+  } else if (txn->Status() == COMPLETED_A) {
+    txn->status_ = ABORTED;
+  } else {
+    // Invalid TxnStatus!
+    DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+  }
+
+  lm_->ReleaseAll(txn);
+
+  // Return result to client.
+  FinishTxn(txn, lsn);
+}
+
+void TxnProcessor::ExecuteTxn(Txn* txn) {
+  txn->times_.executed_ = CycleClock();
+
+  if (mode_ == OCC || txn->optimistic_) {
+    OCCRead(txn);
+  } else {
+    // Read everything in from readset.
+    for (KeySet::const_iterator it = txn->readset_.begin();
+         it != txn->readset_.end(); ++it) {
+      // Save each read result iff record exists in storage.
+      Value result;
+      if (storage_->Read(*it, &result))
+        txn->reads_[*it] = result;
+    }
+
+    // Also read everything in from writeset.
+    for (KeySet::const_iterator it = txn->writeset_.begin();
+         it != txn->writeset_.end(); ++it) {
+      // Save each read result iff record exists in storage.
+      Value result;
+      if (storage_->Read(*it, &result))
+        txn->reads_[*it] = result;
+    }
+  }
+
+  // Execute txn's program logic.
+  txn->Run();
+  txn->times_.finished_ = CycleClock();
+
+  // Hand the txn back to the RunScheduler thread.
+  completed_txns_.Push(txn);
+}
+
+void TxnProcessor::ApplyWrites(Txn* txn) {
+  // Write buffered writes out to storage.
+  for (KeyValueMap::iterator it = txn->writes_.begin();
+       it != txn->writes_.end(); ++it) {
+    storage_->Write(it->first, it->second, txn->unique_id_);
+  }
+  // Only MVCC txns still hold increments here.
+  for (KeyValueMap::iterator it = txn->increments_.begin();
+       it != txn->increments_.end(); ++it) {
+    storage_->Increment(it->first, it->second, txn->unique_id_);
+  }
+}
+
+void TxnProcessor::ResolveIncrements(Txn* txn) {
+  if (mode_ == MVCC)
+    return;
+  for (KeyValueMap::iterator it = txn->increments_.begin();
+       it != txn->increments_.end(); ++it) {
+    Value value = 0;
+    storage_->Read(it->first, &value);
+    txn->writes_[it->first] = value + it->second;
+  }
+  txn->increments_.clear();
+}
+
+bool TxnProcessor::RunReadOnly(Txn* txn) {
+  if (txn->two_phase_ || !txn->writeset_.empty() ||
+      !txn->incrementset_.empty() || (mode_ != MVCC && !txn->scanset_.empty()))
+    return false;
+  Dispatch<&TxnProcessor::ReadOnlyExecuteTxn>(txn);
+  return true;
+}
+
+void TxnProcessor::ReadOnlyExecuteTxn(Txn* txn) {
+  txn->times_.executed_ = CycleClock();
+  if (mode_ == MVCC) {
+    for (KeySet::const_iterator it = txn->readset_.begin();
+         it != txn->readset_.end(); ++it) {
+      Value result;
+      if (storage_->Read(*it, &result, txn->unique_id_))
+        txn->reads_[*it] = result;
+    }
+  } else {
+    SnapshotRead(txn);
+  }
+
+  txn->Run();
+  txn->times_.finished_ = CycleClock();
+
+  // Nothing was locked and there is nothing to validate or install.
+  if (mode_ == MVCC)
+    timestamps_.End(txn->unique_id_, txn->timestamp_shard_);
+  if (txn->Status() == COMPLETED_C) {
+    txn->status_ = COMMITTED;
+    FinishTxn(txn, LogWrites(txn));
+  } else if (txn->Status() == COMPLETED_A) {
+    txn->status_ = ABORTED;
+    PushResult(txn);
+  } else {
+    DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+  }
+}
+
+// Every txn whose writes are visible once 'applying_' has drained precedes,
+// in the serial order, every txn whose writes are not: the LOCKING modes
+// only release locks after applying, and OCC modes serialize txns as they
+// validate. So a read that no BeginApply() overlapped sees a prefix of the
+// serial order.
+void TxnProcessor::SnapshotRead(Txn* txn) {
+  for (int attempt = 0; attempt < SNAPSHOT_READ_ATTEMPTS; attempt++) {
+    uint64 applied = applied_.load();
+    if (applying_.load() != 0) {
+      sched_yield();
+      continue;
+    }
+    txn->reads_.clear();
+    for (KeySet::const_iterator it = txn->readset_.begin();
+         it != txn->readset_.end(); ++it) {
+      Value result;
+      if (storage_->Read(*it, &result))
+        txn->reads_[*it] = result;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (applying_.load() == 0 && applied_.load() == applied)
+      return;
+  }
+
+  // Writers keep getting in; keep new ones out and wait for the rest.
+  blocking_readers_++;
+  while (applying_.load() != 0)
+    sched_yield();
+  txn->reads_.clear();
+  for (KeySet::const_iterator it = txn->readset_.begin();
+       it != txn->readset_.end(); ++it) {
+    Value result;
+    if (storage_->Read(*it, &result))
+      txn->reads_[*it] = result;
+  }
+  blocking_readers_--;
+}
+
+void TxnProcessor::BeginApply() {
+  while (true) {
+    applying_++;
+    if (blocking_readers_.load() == 0)
+      return;
+    applying_--;
+    while (blocking_readers_.load() != 0)
+      sched_yield();
+  }
+}
+
+void TxnProcessor::EndApply() {
+  applied_++;
+  applying_--;
+}
+
+void TxnProcessor::OCCRead(Txn* txn) {
+  txn->occ_versions_.clear();
+  for (KeySet::const_iterator it = txn->readset_.begin();
+       it != txn->readset_.end(); ++it) {
+    Value result;
+    uint64 version;
+    if (storage_->ReadVersion(*it, &result, &version))
+      txn->reads_[*it] = result;
+    txn->occ_versions_.push_back(version);
+  }
+  for (KeySet::const_iterator it = txn->writeset_.begin();
+       it != txn->writeset_.end(); ++it) {
+    Value result;
+    uint64 version;
+    if (storage_->ReadVersion(*it, &result, &version))
+      txn->reads_[*it] = result;
+    txn->occ_versions_.push_back(version);
+  }
+}
+
+void TxnProcessor::OCCPrefetch(const Txn& txn) const {
+  for (auto&& key : txn.readset_)
+    storage_->Prefetch(key);
+  for (auto&& key : txn.writeset_)
+    storage_->Prefetch(key);
+  for (auto&& key : txn.incrementset_)
+    storage_->Prefetch(key);
+}
+
+/**
+ * Precondition: No storage writes to the txn's keys are occuring during
+ * validation.
+ */
+bool TxnProcessor::OCCValidateTransaction(const Txn &txn) const {
+  const uint64* version = txn.occ_versions_.begin();
+  for (auto&& key : txn.readset_) {
+    if (storage_->RecordVersion(key) != *version++)
+      return false;
+  }
+
+  for (auto&& key : txn.writeset_) {
+    if (storage_->RecordVersion(key) != *version++)
+      return false;
+  }
+
+  return ScansValid(txn);
+}
+
+bool TxnProcessor::ScansValid(const Txn& txn) const {
+  for (const ScanRead* scan = txn.scans_.begin(); scan != txn.scans_.end();
+       ++scan) {
+    KeyCursor keys;
+    storage_->SeekKeys(scan->lo_, scan->end_, &keys);
+    uint64 versions = 0;
+    Key key;
+    while (keys.Next(&key))
+      versions += storage_->RecordVersion(key);
+    if (versions != scan->versions_)
+      return false;
+  }
+  return true;
+}
+
+void TxnProcessor::ScanSeek(ScanCursor* cursor, Key lo, Key hi) {
+  storage_->SeekKeys(lo, hi, &cursor->keys_);
+}
+
+bool TxnProcessor::ScanNext(ScanCursor* cursor) {
+  Txn* txn = cursor->txn_;
+  ScanRead* scan = &txn->scans_[cursor->scan_];
+  bool optimistic = mode_ == OCC || mode_ == P_OCC || txn->optimistic_;
+  Key key;
+  while (cursor->keys_.Next(&key)) {
+    // The scan has covered every key up to this one, record or not.
+    scan->end_ = key + 1;
+    bool found;
+    if (mode_ == MVCC) {
+      found = storage_->Read(key, &cursor->value_, txn->unique_id_);
+    } else if (optimistic) {
+      uint64 version;
+      found = storage_->ReadVersion(key, &cursor->value_, &version);
+      scan->versions_ += version;
+    } else {
+      found = storage_->Read(key, &cursor->value_);
+    }
+    if (found) {
+      cursor->key_ = key;
+      return true;
+    }
+  }
+  scan->end_ = cursor->hi_;
+  return false;
+}
+
+void TxnProcessor::RunOCCScheduler() {
+  // Fetch transaction requests, a batch at a time, and immediately begin
+  // executing them. Txns that all ran at once against the same records
+  // would mostly fail validation, so the batch shrinks by half whenever
+  // more than a fifth of a validation batch restarted, and grows back by
+  // one otherwise.
+  Txn* requests[PIPELINE_BATCH];
+  int intake = PIPELINE_BATCH;
+
+  // While the transaction is active
+  while (!stopped_) {
+    int requested = PopRequests(requests, intake);
+    for (int i = 0; i < requested; i++) {
+      if (RunReadOnly(requests[i]))
+        continue;
+      // Start txn running in its own thread, then run the transaction
+      Dispatch<&TxnProcessor::ExecuteTxn>(requests[i]);
+    }
+
+    // Check every finished transaction done by the request
+    // All transaction done by ExecuteTxn is put into the completed_txns_ queue
+    // They are taken a batch at a time, and all their records prefetched
+    // before the first is validated, so the version checks rarely miss.
+    // The results of each batch are handed back together.
+    Txn* finished[OCC_VALIDATION_BATCH];
+    Txn* done[OCC_VALIDATION_BATCH];
+    LSN lsns[OCC_VALIDATION_BATCH];
+    int count;
+    do {
+      int done_count = 0;
+      int restarted = 0;
+      count = 0;
+      while (count < OCC_VALIDATION_BATCH &&
+             completed_txns_.Pop(&finished[count]))
+        count++;
+      for (int i = 0; i < count; i++)
+        OCCPrefetch(*finished[i]);
+
+      for (int i = 0; i < count; i++) {
+        Txn* finishedTask = finished[i];
+
+        // Validating transaction
+        // Every record read or written must still be at the version read.
+        // Earlier txns of the batch have already applied their writes.
+        bool valid = OCCValidateTransaction(*finishedTask);
+
+        // If the transaction is aborted...
+        // No need to run it again. Just put it out...
+        // Set the status to commited
+        LSN lsn = 0;
+        if (finishedTask->Status() == COMPLETED_A && valid) {
+          finishedTask->status_ = ABORTED;
+        }
+        // If transaction is valid and not aborted => Write the write commands
+        // Set the status to COMMITTED
+        else if (valid && finishedTask->Status() == COMPLETED_C) {
+          // Write key and value for every finishedTask reads and writes before
+          ResolveIncrements(finishedTask);
+          lsn = LogWrites(finishedTask);
+          BeginApply();
+          for (KeyValueMap::iterator itr = finishedTask->writes_.begin(); itr != finishedTask->writes_.end(); ++itr) {
+            storage_->Write(itr->first, itr->second, finishedTask->unique_id_);
+          }
+          EndApply();
+          finishedTask->status_ = COMMITTED;
+        }
+        // Else if the task is not valid
+        // Redo the task again. A txn that aborted itself may have decided
+        // on records that changed while it read them.
+        else if (!valid && (finishedTask->Status() == COMPLETED_C ||
+                            finishedTask->Status() == COMPLETED_A)) {
+          // Set empty reads and writes
+          finishedTask->Restart();
+          restarted++;
+
+          // Try transaction again
+          RetryTxn(finishedTask);
+          continue;
+        }
+
+        // Else...
+        // That means the task status is invalid.
+        // KILL
+        else {
+          // Invalid TxnStatus!
+          DIE("Completed Txn has invalid TxnStatus: " << finishedTask->Status());
+        }
+        done[done_count] = finishedTask;
+        lsns[done_count++] = lsn;
+      }
+      FinishTxns(done, lsns, done_count);
+      if (restarted * 5 > done_count)
+        intake = intake > 1 ? intake / 2 : 1;
+      else if (count > 0 && intake < PIPELINE_BATCH)
+        intake++;
+    } while (count == OCC_VALIDATION_BATCH);
+
+    sched_yield();
+  }
+}
+
+void TxnProcessor::ExecuteTxnParallel(Txn* txn) {
+  // Read and run the txn logic exactly as in ExecuteTxn, without handing the
+  // txn back to the scheduler.
+  txn->times_.executed_ = CycleClock();
+  OCCRead(txn);
+  txn->Run();
+  txn->times_.finished_ = CycleClock();
+
+  // Txns that aborted themselves have nothing to validate.
+  if (txn->Status() == COMPLETED_A) {
+    txn->status_ = ABORTED;
+    PushResult(txn);
+    return;
+  } else if (txn->Status() != COMPLETED_C) {
+    DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+  }
+
+  // Snapshot the write sets of every txn currently validating and join
+  // them. Whichever of two overlapping validators gets here second sees the
+  // other's writes. Members only leave the set under the same mutex, so
+  // their write sets can be copied safely.
+  SmallVector<Key, 2 * TXN_INLINE_KEYS> active_writes;
+  BeginApply();
+  active_set_mutex_.Lock();
+  for (size_t i = 0; i < active_set_.size(); i++) {
+    const Txn* other = active_set_[i];
+    for (KeySet::const_iterator it = other->writeset_.begin();
+         it != other->writeset_.end(); ++it) {
+      active_writes.push_back(*it);
+    }
+    for (KeySet::const_iterator it = other->incrementset_.begin();
+         it != other->incrementset_.end(); ++it) {
+      active_writes.push_back(*it);
+    }
+  }
+  active_set_.push_back(txn);
+  active_set_mutex_.Unlock();
+
+  // Backward validation against committed writes, then against the writes
+  // of the txns that were validating when this one started to.
+  OCCPrefetch(*txn);
+  bool valid = OCCValidateTransaction(*txn);
+  if (valid && !active_writes.empty()) {
+    const Key* first = active_writes.begin();
+    const Key* last = active_writes.end();
+    std::sort(active_writes.begin(), active_writes.end());
+    for (KeySet::const_iterator it = txn->readset_.begin();
+         valid && it != txn->readset_.end(); ++it) {
+      valid = !std::binary_search(first, last, *it);
+    }
+    for (KeySet::const_iterator it = txn->writeset_.begin();
+         valid && it != txn->writeset_.end(); ++it) {
+      valid = !std::binary_search(first, last, *it);
+    }
+    // An increment resolves against whatever is applied first, so it need
+    // not match a version; it only has to wait out concurrent appliers.
+    for (KeySet::const_iterator it = txn->incrementset_.begin();
+         valid && it != txn->incrementset_.end(); ++it) {
+      valid = !std::binary_search(first, last, *it);
+    }
+    for (const ScanRead* scan = txn->scans_.begin();
+         valid && scan != txn->scans_.end(); ++scan) {
+      const Key* it = std::lower_bound(first, last, scan->lo_);
+      valid = it == last || *it >= scan->end_;
+    }
+  }
+
+  LSN lsn = 0;
+  if (valid) {
+    ResolveIncrements(txn);
+    lsn = LogWrites(txn);
+    ApplyWrites(txn);
+  }
+
+  active_set_mutex_.Lock();
+  *std::find(active_set_.begin(), active_set_.end(), txn) = active_set_.back();
+  active_set_.pop_back();
+  active_set_mutex_.Unlock();
+  EndApply();
+
+  if (valid) {
+    txn->status_ = COMMITTED;
+    FinishTxn(txn, lsn);
+  } else {
+    // Clean up and restart the txn.
+    txn->Restart();
+    RetryTxn(txn);
+  }
+}
+
+void TxnProcessor::RunOCCParallelScheduler() {
+  // Validation and writes happen on the worker threads, so all the
+  // scheduler does is hand out new requests.
+  Txn* txn;
+  while (!stopped_) {
+    if (PopRequest(&txn) && !RunReadOnly(txn)) {
+      Dispatch<&TxnProcessor::ExecuteTxnParallel>(txn);
+    }
+
+    sched_yield();
+  }
+}
+
+void TxnProcessor::RunMVCCScheduler() {
+  // CPSC 638:
+  //
+  // Implement this method!
+
+  // Hint:Pop a txn from txn_requests_, and pass it to a thread to execute.
+  // Note that you may need to create another execute method, like TxnProcessor::MVCCExecuteTxn.
+  //
+  // [For now, run serial scheduler in order to make it through the test
+  // suite]
+  Txn* txn;
+  while (!stopped_) {
+    // If there is transaction request, pop it -> assign it to txn variable
+    if (PopRequest(&txn) && !RunReadOnly(txn)) {
+      Dispatch<&TxnProcessor::MVCCExecuteTxn>(txn);
+    }
+
+    sched_yield();
+  }
+}
+
+void TxnProcessor::MVCCExecuteTxn(Txn* txn) {
+  //1. Read all necessary data for this transaction from storage (MVCCStorage
+  // reads are latch-free, so there is no need to lock the key)
+  txn->times_.executed_ = CycleClock();
+
+  for (KeySet::const_iterator itr = txn->readset_.begin(); itr != txn->readset_.end(); itr++) {
+    Value result;
+    if (storage_->Read(*itr, &result, txn->unique_id_)) {
+      txn->reads_[*itr] = result;
+    }
+  }
+
+  //read from writeset
+  for (KeySet::const_iterator itr = txn->writeset_.begin(); itr != txn->writeset_.end(); itr++) {
+    Value result;
+    if (storage_->Read(*itr, &result, txn->unique_id_)) {
+      txn->reads_[*itr] = result;
+    }
+  }
+
+  //2. Execute the transaction logic (i.e. call Run() on the transaction)
+  txn->Run();
+  txn->times_.finished_ = CycleClock();
+
+  // Txns that voted to abort have nothing to install.
+  if (txn->Status() == COMPLETED_A) {
+    timestamps_.End(txn->unique_id_, txn->timestamp_shard_);
+    txn->status_ = ABORTED;
+    PushResult(txn);
+    return;
+  } else if (txn->Status() != COMPLETED_C) {
+    DIE("Completed Txn has invalid TxnStatus: " << txn->Status());
+  }
+
+  // Increments install delta versions under the same checks as writes. The
+  // key locks are taken in key order across both sets.
+  const KeySet* keys = &txn->writeset_;
+  KeySet merged;
+  if (!txn->incrementset_.empty()) {
+    merged = txn->writeset_;
+    for (auto&& key : txn->incrementset_)
+      merged.insert(key);
+    keys = &merged;
+  }
+
+  //3. Acquire all locks for ALL keys in the write_set_, and open the install
+  // window in which readers that would see the new versions wait. In
+  // durable mode the versions stay pending until the txn's record is in the
+  // log, which is appended after the window closes.
+  for (KeySet::const_iterator itr = keys->begin(); itr != keys->end(); itr++) {
+    storage_->Lock(*itr);
+  }
+  for (KeySet::const_iterator itr = keys->begin(); itr != keys->end(); itr++) {
+    storage_->BeginInstall(*itr, txn->unique_id_, log_ != NULL);
+  }
+
+  //4. Call MVCCStorage::CheckWrite method to check all keys in the write_set_
+  bool verified = true;
+  for (KeySet::const_iterator itr = keys->begin(); itr != keys->end(); itr++) {
+    if (storage_->CheckWrite(*itr, txn->unique_id_)) {
+      //still true
+      continue;
+    }
+    else {
+      //if ONLY one failure
+      verified =  false;
+      break;
+    }
+  }
+  
+  //5. If (each key passed the check)
+  if (verified) {
+    //6. Apply the writes and close the install window. Log them and
+    // publish the versions, then drop the versions nobody can see anymore
+    ApplyWrites(txn);
+    for (KeySet::const_iterator itr = keys->begin(); itr != keys->end(); ++itr) {
+      storage_->EndInstall(*itr);
+    }
+    LSN lsn = LogWrites(txn);
+    if (log_ != NULL) {
+      for (KeySet::const_iterator itr = keys->begin(); itr != keys->end(); ++itr) {
+        storage_->Publish(*itr, txn->unique_id_);
+      }
+    }
+    GarbageCollection(txn);
+
+    //7.Release all locks for keys in the write_set_
+    for (KeySet::const_iterator itr = keys->begin(); itr != keys->end(); ++itr) {
+      storage_->Unlock(*itr);
+    }
+
+    timestamps_.End(txn->unique_id_, txn->timestamp_shard_);
+
+    // Return result to client.
+    txn->status_ = COMMITTED;
+    FinishTxn(txn, lsn);
+  }
+  // 8. else if (at least one key failed the check)
+  else {
+    //9. Release all locks for keys in the write_set_
+    for (KeySet::const_iterator itr = keys->begin(); itr != keys->end(); itr++) {
+      storage_->EndInstall(*itr);
+      storage_->Unlock(*itr);
+    }
+
+    //10. Cleanup txn
+    txn->Restart();
+
+    //11. Completely restart the transaction (with a new timestamp)
+    timestamps_.End(txn->unique_id_, txn->timestamp_shard_);
+    RetryTxn(txn);
+  }
+
+}
+
+void TxnProcessor::GarbageCollection(Txn* txn) {
+  if (txn->writeset_.empty() && txn->incrementset_.empty())
+    return;
+
+  // The oldest unfinished txn bounds what can still be read.
+  uint64 low_water_mark = timestamps_.CachedLowWaterMark();
+
+  for (KeySet::const_iterator itr = txn->writeset_.begin();
+       itr != txn->writeset_.end(); ++itr) {
+    storage_->GarbageCollect(*itr, low_water_mark, timestamps_);
+  }
+  for (KeySet::const_iterator itr = txn->incrementset_.begin();
+       itr != txn->incrementset_.end(); ++itr) {
+    storage_->GarbageCollect(*itr, low_water_mark, timestamps_);
+  }
 }
\ No newline at end of file
@@ -1,154 +1,812 @@
-// Author: Alexander Thomson (thomson@cs.yale.edu)
-// Modified by: Christina Wallin (christina.wallin@yale.edu)
-// Modified by: Kun Ren (kun.ren@yale.edu)
-
-#ifndef _TXN_PROCESSOR_H_
-#define _TXN_PROCESSOR_H_
-
-#include <deque>
-#include <map>
-#include <string>
-
-#include "txn/common.h"
-#include "txn/lock_manager.h"
-#include "txn/storage.h"
-#include "txn/mvcc_storage.h"
-#include "txn/txn.h"
-#include "utils/atomic.h"
-#include "utils/static_thread_pool.h"
-#include "utils/mutex.h"
-#include "utils/condition.h"
-
-
-using std::deque;
-using std::map;
-using std::string;
-
-// The TxnProcessor supports five different execution modes, corresponding to
-// the four parts of assignment 2, plus a simple serial (non-concurrent) mode.
-enum CCMode {
-  SERIAL = 0,                  // Serial transaction execution (no concurrency)
-  LOCKING_EXCLUSIVE_ONLY = 1,  // Part 1A
-  LOCKING = 2,                 // Part 1B
-  OCC = 3,                     // Part 2
-  P_OCC = 4,                   // Part 3
-  MVCC = 5,
-};
-
-// Returns a human-readable string naming of the providing mode.
-string ModeToString(CCMode mode);
-
-class TxnProcessor {
- public:
-  // The TxnProcessor's constructor starts the TxnProcessor running in the
-  // background.
-  explicit TxnProcessor(CCMode mode);
-
-  // The TxnProcessor's destructor stops all background threads and deallocates
-  // all objects currently owned by the TxnProcessor, except for Txn objects.
-  ~TxnProcessor();
-
-  // Registers a new txn request to be executed by the TxnProcessor.
-  // Ownership of '*txn' is transfered to the TxnProcessor.
-  void NewTxnRequest(Txn* txn);
-
-  // Returns a pointer to the next COMMITTED or ABORTED Txn. The caller takes
-  // ownership of the returned Txn.
-  Txn* GetTxnResult();
-
-  // Main loop implementing all concurrency control/thread scheduling.
-  void RunScheduler();
-
-  static void* StartScheduler(void * arg);
-
- private:
-
-  // Serial validation
-  bool SerialValidate(Txn *txn);
-
-  // Parallel executtion/validation for OCC
-  void ExecuteTxnParallel(Txn *txn);
-
-  // Serial version of scheduler.
-  void RunSerialScheduler();
-
-  // Locking version of scheduler.
-  void RunLockingScheduler();
-
-  // Determine whether a txn is valid in the occ scheduler.
-  bool OCCValidateTransaction(const Txn &txn) const;
-
-  // OCC version of scheduler.
-  void RunOCCScheduler();
-
-  // OCC version of scheduler with parallel validation.
-  void RunOCCParallelScheduler();
-
-  // MVCC version of scheduler.
-  void RunMVCCScheduler();
-
-  // Performs all reads required to execute the transaction, then executes the
-  // transaction logic.
-  void ExecuteTxn(Txn* txn);
-
-  // Applies all writes performed by '*txn' to 'storage_'.
-  //
-  // Requires: txn->Status() is COMPLETED_C.
-  void ApplyWrites(Txn* txn);
-
-  // The following functions are for MVCC
-  void MVCCExecuteTxn(Txn* txn);
-
-  void MVCCCheckWrites(Txn* txn);
-
-  void MVCCLockWriteKeys(Txn* txn);
-
-  void MVCCAbortTransaction(Txn* txn);
-
-  void MVCCUnlockWriteKeys(Txn* txn);
-
-  void GarbageCollection();
-
-  // Concurrency control mechanism the TxnProcessor is currently using.
-  CCMode mode_;
-
-  // Thread pool managing all threads used by TxnProcessor.
-  StaticThreadPool tp_;
-
-  // Data storage used for all modes.
-  Storage* storage_;
-
-  // Next valid unique_id, and a mutex to guard incoming txn requests.
-  int next_unique_id_;
-  Mutex mutex_;
-
-  // Queue of incoming transaction requests.
-  AtomicQueue<Txn*> txn_requests_;
-
-  // Queue of txns that have acquired all locks and are ready to be executed.
-  //
-  // Does not need to be atomic because RunScheduler is the only thread that
-  // will ever access this queue.
-  deque<Txn*> ready_txns_;
-
-  // Queue of completed (but not yet committed/aborted) transactions.
-  AtomicQueue<Txn*> completed_txns_;
-
-  // Queue of transaction results (already committed or aborted) to be returned
-  // to client.
-  AtomicQueue<Txn*> txn_results_;
-
-  // Set of transactions that are currently in the process of parallel
-  // validation.
-  AtomicSet<Txn*> active_set_;
-
-  // Used it for critical section in parallel occ.
-  Mutex active_set_mutex_;
-
-  // Lock Manager used for LOCKING concurrency implementations.
-  LockManager* lm_;
-
-};
-
-#endif  // _TXN_PROCESSOR_H_
-
+// Author: Alexander Thomson (thomson@cs.yale.edu)
+// Modified by: Christina Wallin (christina.wallin@yale.edu)
+// Modified by: Kun Ren (kun.ren@yale.edu)
+
+#ifndef _TXN_PROCESSOR_H_
+#define _TXN_PROCESSOR_H_
+
+#include <pthread.h>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <queue>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "txn/common.h"
+#include "txn/array_storage.h"
+#include "txn/checkpoint.h"
+#include "txn/key_hotness.h"
+#include "txn/lock_manager.h"
+#include "txn/log.h"
+#include "txn/storage.h"
+#include "txn/timestamp_oracle.h"
+#include "txn/mvcc_storage.h"
+#include "txn/txn.h"
+#include "utils/atomic.h"
+#include "utils/cycle_clock.h"
+#include "utils/histogram.h"
+#include "utils/mpmc_queue.h"
+#include "utils/static_thread_pool.h"
+#include "utils/work_stealing_thread_pool.h"
+#include "utils/mutex.h"
+#include "utils/condition.h"
+
+
+using std::deque;
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+// The TxnProcessor supports five different execution modes, corresponding to
+// the four parts of assignment 2, plus a simple serial (non-concurrent) mode.
+enum CCMode {
+  SERIAL = 0,                  // Serial transaction execution (no concurrency)
+  LOCKING_EXCLUSIVE_ONLY = 1,  // Part 1A
+  LOCKING = 2,                 // Part 1B
+  OCC = 3,                     // Part 2
+  P_OCC = 4,                   // Part 3
+  MVCC = 5,
+  LOCKING_PARTITIONED = 6,     // LOCKING, with locks taken by the workers
+  CALVIN = 7,                  // LOCKING, with locks granted batch by batch
+  ADAPTIVE = 8,                // LOCKING or OCC per txn, by contention
+};
+
+// Returns a human-readable string naming of the providing mode.
+string ModeToString(CCMode mode);
+
+// Thread pool implementation used to run txns.
+enum ThreadPoolType {
+  STATIC_THREAD_POOL = 0,         // One FIFO queue per worker, random placement
+  WORK_STEALING_THREAD_POOL = 1,  // Per-worker deques with stealing
+};
+
+// What the LOCKING schedulers do with a txn that touches more than one key
+// and can't get all of its locks right away.
+enum LockConflictPolicy {
+  RESTART_ON_CONFLICT = 0,  // Release its locks and resubmit it
+  WAIT_ON_CONFLICT = 1,     // Leave it queued in the lock manager
+};
+
+// Counters of the LOCKING schedulers. See TxnProcessor::GetLockStats.
+struct LockStats {
+  uint64 restarts_;          // Txns released and resubmitted
+  uint64 restarts_avoided_;  // Txns that waited where they would have restarted
+};
+
+// Routing decisions of the ADAPTIVE scheduler. See
+// TxnProcessor::GetAdaptiveStats.
+struct AdaptiveStats {
+  uint64 optimistic_;      // Attempts of writers run under OCC
+  uint64 locked_;          // Attempts of writers run under locks...
+  uint64 hot_key_locked_;  // ...of which only because they touched a hot key
+  uint64 switches_;        // Changes of 'pessimistic_'
+  bool pessimistic_;       // Whether every writer currently takes locks
+  double restart_rate_;    // Last window: fraction of OCC attempts restarted
+  double wait_rate_;       // Last window: fraction of locked attempts waiting
+};
+
+// Stretches of a txn's time in the TxnProcessor, each timed from one
+// TxnTimes boundary to the next and recorded when the txn finishes.
+enum TxnPhase {
+  PHASE_QUEUE = 0,      // Waiting in the request queue
+  PHASE_LOCK_WAIT = 1,  // Waiting for its locks (LOCKING modes only)
+  PHASE_EXECUTE = 2,    // Reading and running
+  PHASE_COMMIT = 3,     // Validation, writes and, if durable, the log
+  PHASE_TOTAL = 4,      // First submission to result, restarts included
+  TXN_PHASES = 5,
+};
+
+// Outcome counters and per-phase latency histograms (in nanoseconds) of the
+// txns a TxnProcessor has finished. All phases but PHASE_TOTAL are those of
+// each txn's last attempt. See TxnProcessor::GetTxnStats.
+struct TxnStats {
+  uint64 committed_;
+  uint64 aborted_;
+  uint64 restarts_;  // Attempts that were thrown away and resubmitted
+  uint64 backoffs_;  // Of 'restarts_', those held back before retrying
+  uint64 rejected_;  // TryNewTxnRequest() calls refused for overload
+  uint64 read_only_committed_;  // Of 'committed_', those with no write set
+  Histogram latency_[TXN_PHASES];
+};
+
+// Callback that holds on to its txn until the client asks for it. Owned by
+// the client, and must outlive the txn's execution:
+//
+//   TxnFuture future;
+//   p->NewTxnRequest(txn, &future);
+//   ...
+//   Txn* result = future.Get();
+class TxnFuture : public TxnCallback {
+ public:
+  TxnFuture() : txn_(NULL) {
+    pthread_mutex_init(&mutex_, NULL);
+    pthread_cond_init(&cv_, NULL);
+  }
+
+  virtual ~TxnFuture() {
+    pthread_cond_destroy(&cv_);
+    pthread_mutex_destroy(&mutex_);
+  }
+
+  virtual void Done(Txn* txn) {
+    pthread_mutex_lock(&mutex_);
+    txn_ = txn;
+    pthread_cond_broadcast(&cv_);
+    pthread_mutex_unlock(&mutex_);
+  }
+
+  // Returns true once the txn is COMMITTED or ABORTED.
+  bool Ready() {
+    pthread_mutex_lock(&mutex_);
+    bool ready = txn_ != NULL;
+    pthread_mutex_unlock(&mutex_);
+    return ready;
+  }
+
+  // Blocks until the txn is COMMITTED or ABORTED and returns it. The caller
+  // takes ownership of the txn.
+  Txn* Get() {
+    pthread_mutex_lock(&mutex_);
+    while (txn_ == NULL)
+      pthread_cond_wait(&cv_, &mutex_);
+    Txn* txn = txn_;
+    pthread_mutex_unlock(&mutex_);
+    return txn;
+  }
+
+ private:
+  Txn* txn_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t cv_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  TxnFuture(const TxnFuture&);
+  TxnFuture& operator=(const TxnFuture&);
+};
+
+// Default epoch limits of CALVIN mode. See TxnProcessorConfig::batch_size_.
+#define CALVIN_BATCH_SIZE 64
+#define CALVIN_BATCH_MICROS 100
+
+// ADAPTIVE mode tuning. Every ADAPTIVE_WINDOW writer attempts, the
+// scheduler compares the window's restart and lock wait rates against these
+// thresholds to decide whether writers run under OCC or under locks, and
+// halves the per-key conflict counts. A key counts as hot, sending every
+// writer that touches it to locking, after ADAPTIVE_HOT_KEY_CONFLICTS
+// conflicts.
+#define ADAPTIVE_WINDOW 256
+#define ADAPTIVE_MAX_RESTART_RATE 0.1
+#define ADAPTIVE_MIN_WAIT_RATE 0.05
+#define ADAPTIVE_HOT_KEY_CONFLICTS 4
+#define ADAPTIVE_HOTNESS_SLOTS 4096
+
+// Default backoff of restarted txns. A txn's first retry is immediate. The
+// next waits RETRY_BACKOFF_MICROS, and each later one twice as long as the
+// one before, up to RETRY_BACKOFF_MAX_MICROS, each delay shortened by a
+// random part of up to half so that colliding txns drift apart. A txn that
+// has been restarted RETRY_AGED_RETRIES times no longer waits and goes
+// ahead of every other retry and new request, oldest first, so that it is
+// not starved by younger ones.
+#define RETRY_BACKOFF_MICROS 2
+#define RETRY_BACKOFF_MAX_MICROS 1000
+#define RETRY_AGED_RETRIES 10
+
+// Construction-time settings of a TxnProcessor. The defaults run 4 unpinned
+// workers over ARRAY_STORAGE.
+struct TxnProcessorConfig {
+  TxnProcessorConfig()
+      : storage_type_(ARRAY_STORAGE), pool_type_(WORK_STEALING_THREAD_POOL),
+        worker_count_(4), scheduler_cpu_(-1), numa_node_(-1),
+        lock_policy_(RESTART_ON_CONFLICT), batch_size_(CALVIN_BATCH_SIZE),
+        batch_micros_(CALVIN_BATCH_MICROS), log_window_(LOG_GROUP_WINDOW),
+        log_group_bytes_(LOG_GROUP_BYTES), max_in_flight_(0), max_queued_(0),
+        retry_backoff_micros_(RETRY_BACKOFF_MICROS),
+        retry_backoff_max_micros_(RETRY_BACKOFF_MAX_MICROS) {}
+
+  // Record layout. Keys outside the ARRAY_STORAGE array fall back to hash
+  // maps.
+  StorageType storage_type_;
+
+  // Thread pool that executes txns, and its number of threads.
+  ThreadPoolType pool_type_;
+  int worker_count_;
+
+  // CPU the scheduler thread is pinned to, or -1.
+  int scheduler_cpu_;
+
+  // Worker i is pinned to CPU worker_cpus_[i]. Workers past the end of the
+  // list are not pinned to a single CPU.
+  vector<int> worker_cpus_;
+
+  // If not -1, threads that are not pinned to a single CPU run on any CPU of
+  // this NUMA node instead of anywhere.
+  int numa_node_;
+
+  // Conflict handling of LOCKING_EXCLUSIVE_ONLY and LOCKING.
+  // LOCKING_PARTITIONED always waits.
+  LockConflictPolicy lock_policy_;
+
+  // CALVIN epochs: a batch is closed once it holds 'batch_size_' txns or
+  // 'batch_micros_' microseconds after its first txn arrived, whichever
+  // comes first.
+  int batch_size_;
+  double batch_micros_;
+
+  // Durable commit mode: if 'log_path_' is set, every committed txn's writes
+  // are appended to a redo log there, and its result is returned only once
+  // the log is on disk up to its record. Group commit settings as for
+  // RedoLog.
+  string log_path_;
+  double log_window_;
+  size_t log_group_bytes_;
+
+  // Where Checkpoint() writes checkpoints. If there is one at construction,
+  // the storage is loaded from it instead of being built by InitStorage. In
+  // durable mode, the log records that the checkpoint (or, without one, the
+  // initial storage) does not reflect are then replayed, so a TxnProcessor
+  // reopened on the same paths recovers every durable commit.
+  string checkpoint_path_;
+
+  // Admission control; 0 means no limit. NewTxnRequest() blocks, and
+  // TryNewTxnRequest() refuses, while 'max_in_flight_' submitted txns have
+  // not been returned yet, or 'max_queued_' of them are still waiting for
+  // the scheduler to take them. A batch larger than a limit is admitted
+  // once nothing else is. Callbacks run on the TxnProcessor's threads, so
+  // they must use TryNewTxnRequest() when there are limits.
+  size_t max_in_flight_;
+  size_t max_queued_;
+
+  // Backoff of restarted txns (see RETRY_AGED_RETRIES); 0 retries at once.
+  double retry_backoff_micros_;
+  double retry_backoff_max_micros_;
+};
+
+// Number of times GetTxnResults() polls for results, yielding in between,
+// before it goes to sleep.
+#define RESULT_POLLS_BEFORE_SLEEPING 64
+
+// Number of optimistic tries SnapshotRead() makes before it holds writers
+// back.
+#define SNAPSHOT_READ_ATTEMPTS 4
+
+// Largest number of finished txns the OCC scheduler validates per batch.
+#define OCC_VALIDATION_BATCH 16
+
+// Largest number of requests the LOCKING and OCC schedulers take per pass of
+// their loops, and of finished txns the schedulers that own 'lm_' commit
+// together.
+#define PIPELINE_BATCH 64
+
+class TxnProcessor {
+ public:
+  // The TxnProcessor's constructor starts the TxnProcessor running in the
+  // background. When workers are pinned, the ARRAY_STORAGE array is split
+  // into one partition per pinned worker, allocated on that worker's NUMA
+  // node.
+  explicit TxnProcessor(CCMode mode,
+                        const TxnProcessorConfig& config = TxnProcessorConfig());
+
+  // The TxnProcessor's destructor stops all background threads and deallocates
+  // all objects currently owned by the TxnProcessor, except for Txn objects.
+  ~TxnProcessor();
+
+  // Registers a new txn request to be executed by the TxnProcessor.
+  // Ownership of '*txn' is transfered to the TxnProcessor.
+  void NewTxnRequest(Txn* txn);
+
+  // Registers the 'count' txn requests in 'txns' at once. Their unique_ids
+  // are assigned with a single atomic increment (in MVCC mode, under a single
+  // acquisition of one TimestampOracle shard lock). Ownership of the txns is
+  // transfered to the TxnProcessor.
+  void NewTxnRequests(Txn** txns, size_t count);
+
+  // Registers a new txn request whose outcome goes to 'callback' (see
+  // TxnCallback) rather than to GetTxnResult(). A TxnFuture can serve as the
+  // callback. Ownership of '*txn' is transfered to the TxnProcessor until it
+  // is passed to 'callback'.
+  void NewTxnRequest(Txn* txn, TxnCallback* callback);
+
+  // Like NewTxnRequest(), but never waits for admission (see
+  // TxnProcessorConfig::max_in_flight_): returns false, keeping ownership
+  // of '*txn' with the caller, if the TxnProcessor is overloaded.
+  bool TryNewTxnRequest(Txn* txn);
+  bool TryNewTxnRequest(Txn* txn, TxnCallback* callback);
+
+  // Returns a pointer to the next COMMITTED or ABORTED Txn, blocking until
+  // there is one. The caller takes ownership of the returned Txn.
+  Txn* GetTxnResult();
+
+  // Moves up to 'max' COMMITTED or ABORTED txns into 'results' and returns
+  // how many it moved. If no result is available, sleeps until one is or
+  // until 'timeout' seconds have passed (forever if 'timeout' is negative;
+  // not at all if it is zero). The caller takes ownership of the returned
+  // txns.
+  size_t GetTxnResults(Txn** results, size_t max, double timeout = -1);
+
+  // Fills '*stats' with MVCC garbage collection counters and version chain
+  // length percentiles. All fields are zero in non-MVCC modes.
+  void GetGCStats(GCStats* stats);
+
+  // Fills '*stats' with the restart counters of the LOCKING modes, CALVIN
+  // and ADAPTIVE (which never restart). All fields are zero in other modes.
+  void GetLockStats(LockStats* stats);
+
+  // Fills '*stats' with the routing counters of ADAPTIVE mode. All fields
+  // are zero in other modes.
+  void GetAdaptiveStats(AdaptiveStats* stats);
+
+  // Fills '*stats' with the redo log's counters. All fields are zero unless
+  // the TxnProcessor is in durable mode.
+  void GetLogStats(LogStats* stats);
+
+  // Fills '*stats' with the outcome counts and phase latencies of every txn
+  // finished so far. Each thread records into a histogram shard of its own;
+  // they are merged here.
+  void GetTxnStats(TxnStats* stats);
+
+  // Writes a checkpoint of the storage to config.checkpoint_path_. In MVCC
+  // mode it is read from a snapshot, as a read-only txn would, so txns keep
+  // running; in other modes it must only be taken while no txns are.
+  void Checkpoint();
+
+  // Main loop implementing all concurrency control/thread scheduling.
+  //
+  // Every scheduler loop yields once per round. The scheduler never blocks,
+  // so where it shares a CPU with the workers it hands txns to, or with a
+  // client sleeping in GetTxnResults(), they would otherwise only run once
+  // it is preempted.
+  void RunScheduler();
+
+  static void* StartScheduler(void * arg);
+
+ private:
+
+  // Fills the new storage from the checkpoint and log in 'config' (see
+  // TxnProcessorConfig::checkpoint_path_), and moves 'timestamps_' past
+  // every id they contain.
+  void Recover(const TxnProcessorConfig& config);
+
+  friend class ShardedTxnProcessor;
+
+  // Reserves room for 'count' new requests in 'in_flight_' and 'queued_'.
+  // If there is none, waits for it when 'wait' is set, else returns false.
+  bool Admit(size_t count, bool wait);
+
+  // Wakes clients waiting in Admit(), if there are any.
+  void WakeAdmissions();
+
+  // Queues 'count' admitted requests in 'txn_requests_'.
+  void SubmitTxns(Txn** txns, size_t count);
+
+  // NewTxnRequests() without waiting for admission, for resubmissions made
+  // by a ShardedTxnProcessor on this processor's own threads.
+  void ResubmitTxnRequests(Txn** txns, size_t count);
+
+  // Gives 'count' txns consecutive unique_ids (in MVCC mode, registered as
+  // active) and points their scans at 'scan_reader_'.
+  void AssignIds(Txn** txns, size_t count);
+
+  // Pops the next request and stamps it as scheduled: a retry that is due
+  // if there is one, else a new request from 'txn_requests_'.
+  bool PopRequest(Txn** txn);
+
+  // Pops up to 'max' requests into 'txns' like PopRequest(), and returns how
+  // many there were.
+  int PopRequests(Txn** txns, int max);
+
+  // Moves up to 'max' retries due by 'now' into 'txns', in 'retry_queue_'
+  // order, and returns how many.
+  int PopRetries(Txn** txns, int max, uint64 now);
+
+  // Resubmits a restarted txn, whose Restart() has been called, scheduling
+  // it with backoff (see RETRY_BACKOFF_MICROS), and counts the restart.
+  void RetryTxn(Txn* txn);
+
+  // Counts a restarted attempt in the calling thread's stats shard, and
+  // whether it backed off.
+  void CountRestart(bool backed_off);
+
+  // Hands 'txn' to a worker thread, which calls M on it. Uses the task
+  // embedded in the txn, so nothing is allocated; the txn must not be
+  // dispatched again until M has been entered.
+  template<void (TxnProcessor::*M)(Txn*)>
+  void Dispatch(Txn* txn) {
+    txn->task_.function_ = &RunDispatched<M>;
+    txn->task_.context_ = this;
+    txn->task_.txn_ = txn;
+    tp_->RunTask(&txn->task_);
+  }
+  template<void (TxnProcessor::*M)(Txn*)>
+  static void RunDispatched(void* processor, Txn* txn) {
+    (reinterpret_cast<TxnProcessor*>(processor)->*M)(txn);
+  }
+
+  // If 'txn' has an empty write set, hands it to a worker running
+  // ReadOnlyExecuteTxn() and returns true. Outside MVCC mode, txns that scan
+  // are left to the scheduler, as SnapshotRead() covers no ranges. Used by
+  // every scheduler but the serial one.
+  bool RunReadOnly(Txn* txn);
+
+  // Runs a txn with an empty write set against a consistent snapshot, with
+  // no locks and no validation, so it never restarts. In MVCC mode the
+  // snapshot is the txn's timestamp; otherwise see SnapshotRead().
+  void ReadOnlyExecuteTxn(Txn* txn);
+
+  // Fills txn->reads_ from single-version storage at a moment when no
+  // writer is between BeginApply() and EndApply(). Tries optimistically
+  // (re-reading if a writer got in) SNAPSHOT_READ_ATTEMPTS times, then holds
+  // new writers back while it reads.
+  void SnapshotRead(Txn* txn);
+
+  // Bracket the step in which a txn's writes become visible (in P_OCC, its
+  // validation as well, since validated txns are serialized already) in
+  // every mode whose workers read single-version storage.
+  void BeginApply();
+  void EndApply();
+
+  // Serial validation
+  bool SerialValidate(Txn *txn);
+
+  // Executes, validates and (if valid) applies the writes of 'txn' on a
+  // worker thread, for P_OCC. Restarts the txn if validation fails.
+  void ExecuteTxnParallel(Txn *txn);
+
+  // Serial version of scheduler.
+  void RunSerialScheduler();
+
+  // Locking version of scheduler.
+  void RunLockingScheduler();
+
+  // Commits or aborts every txn in 'completed_txns_' and releases its locks.
+  // Used by the schedulers that own 'lm_'.
+  void FinishLockedTxns();
+
+  // Commits or aborts the 'count' txns in 'txns', which hold all their
+  // locks, as FinishLockedTxn() would each, but applies their writes under
+  // a single BeginApply(), in key order, and hands their results back
+  // together. 'lsns' has room for 'count' LSNs.
+  void CommitLockedTxns(Txn** txns, LSN* lsns, int count);
+
+  // Applies and clears 'pending_writes_'.
+  void ApplyPendingWrites();
+
+  // Commits or aborts 'txn', which holds all its locks, and releases them.
+  void FinishLockedTxn(Txn* txn);
+
+  // Hands every txn in 'ready_txns_' to a worker running ExecuteTxn().
+  void RunReadyTxns();
+
+  // Queues every lock of 'txn' in key order, waiting rather than restarting
+  // on conflicts. If they were all granted right away, moves it to
+  // 'ready_txns_' and returns true. If 'conflicts' is not NULL, each key it
+  // has to wait for is counted there.
+  bool QueueLocks(Txn* txn, KeyHotness* conflicts);
+
+  // Scheduler for CALVIN. Collects requests into epochs (see
+  // TxnProcessorConfig::batch_size_) and queues the locks of each epoch's
+  // txns in epoch order, each txn's in one pass over its sorted read and
+  // write sets (see QueueLocks). Lock queues are thus ordered as the epochs
+  // are, every txn waits rather than restarts, and no txn waits for a later
+  // one.
+  void RunCalvinScheduler();
+
+  // Scheduler for ADAPTIVE. Runs each writer either under OCC or under
+  // locks (see AdaptiveStats), both over the same storage and both
+  // finishing on the scheduler thread. Writers that take locks wait, as in
+  // QueueLocks(), rather than restart.
+  void RunAdaptiveScheduler();
+
+  // Whether the ADAPTIVE scheduler should run 'txn' under locks; counts the
+  // decision.
+  bool AdaptiveShouldLock(const Txn& txn);
+
+  // Validates a txn that ADAPTIVE ran under OCC: every record it read must
+  // still be at the version it read, with no lock held on it by a txn
+  // running under locks that could still write it (EXCLUSIVE) or that has
+  // read it (any lock, if the txn writes it). Counts each key that fails in
+  // 'hotness_'.
+  bool AdaptiveValidate(const Txn& txn);
+
+  // Closes the current ADAPTIVE sample window if it is complete.
+  void AdaptiveSample();
+
+  // Scheduler for LOCKING_PARTITIONED. Only hands out new requests and txns
+  // that have been granted all their locks; the workers acquire and release
+  // locks themselves.
+  void RunPartitionedLockingScheduler();
+
+  // Requests all locks of 'txn' from the LockManagerC and, if they were
+  // granted right away, runs it. Otherwise the txn will show up in
+  // 'lock_ready_txns_' later.
+  void PartitionedLockTxn(Txn* txn);
+
+  // Executes and commits a txn holding all its locks, then releases them.
+  void PartitionedExecuteTxn(Txn* txn);
+
+  // Reads the read and write sets of 'txn' for OCC, recording the version
+  // of every record in txn->occ_versions_.
+  void OCCRead(Txn* txn);
+
+  // Starts loading every record of txn's read and write sets into the cache,
+  // ahead of OCCValidateTransaction().
+  void OCCPrefetch(const Txn& txn) const;
+
+  // Determine whether a txn is valid in the occ scheduler: whether every
+  // record it read is still at the version it read, and every part of a
+  // range it scanned still holds the records it did (see ScansValid()).
+  bool OCCValidateTransaction(const Txn &txn) const;
+
+  // Whether the record versions of each range scanned by txn, as far as its
+  // cursor got, still add up to what they did during the scan. Versions only
+  // grow and a new record has a version of at least 1, so any write to the
+  // range, including one that creates a record in it, changes the sum.
+  bool ScansValid(const Txn& txn) const;
+
+  // ScanSource implementation for the mode's reads: MVCC scans read the
+  // txn's snapshot, optimistic ones record versions for ScansValid(), and
+  // locking ones read under the range locks taken for txn->scanset_.
+  void ScanSeek(ScanCursor* cursor, Key lo, Key hi);
+  bool ScanNext(ScanCursor* cursor);
+
+  // OCC version of scheduler.
+  void RunOCCScheduler();
+
+  // OCC version of scheduler with parallel validation.
+  void RunOCCParallelScheduler();
+
+  // MVCC version of scheduler.
+  void RunMVCCScheduler();
+
+  // Performs all reads required to execute the transaction, then executes the
+  // transaction logic.
+  void ExecuteTxn(Txn* txn);
+
+  // Hands a finished txn to the client: to its callback if it has one, else
+  // to the result queue, waking a client blocked in GetTxnResults().
+  void PushResult(Txn* txn);
+
+  // PushResult() for 'count' txns, recording their stats under one shard
+  // lock and waking clients once.
+  void PushResults(Txn** txns, int count);
+
+  // Hands 'txn' to its callback or queues it in 'txn_results_'. Returns
+  // whether it was queued.
+  bool DeliverResult(Txn* txn);
+
+  // In durable mode, appends a redo record of txn's writes (if it has any)
+  // and returns the LSN its result has to wait for. Called before the writes
+  // are applied.
+  LSN LogWrites(Txn* txn);
+
+  // Hands a finished txn to the client like PushResult(), but in durable mode
+  // holds back COMMITTED txns until the log is durable up to 'lsn'.
+  void FinishTxn(Txn* txn, LSN lsn);
+
+  // FinishTxn() for 'count' txns, txns[i] waiting for lsns[i], by way of
+  // PushResults() outside durable mode.
+  void FinishTxns(Txn** txns, const LSN* lsns, int count);
+
+  // Applies all writes performed by '*txn' to 'storage_'.
+  //
+  // Requires: txn->Status() is COMPLETED_C.
+  void ApplyWrites(Txn* txn);
+
+  // Turns the increments of '*txn' into writes of the values they produce,
+  // read from 'storage_' now. Called as a txn commits, with nothing else
+  // writing its increment keys, in every mode except MVCC, which stores the
+  // deltas themselves.
+  void ResolveIncrements(Txn* txn);
+
+  // The following functions are for MVCC
+  void MVCCExecuteTxn(Txn* txn);
+
+  void MVCCCheckWrites(Txn* txn);
+
+  void MVCCLockWriteKeys(Txn* txn);
+
+  void MVCCAbortTransaction(Txn* txn);
+
+  void MVCCUnlockWriteKeys(Txn* txn);
+
+  // Frees the versions of every key in txn's write set that are no longer
+  // visible to any active txn, using the smallest unique_id_ of any MVCC txn
+  // that has been submitted but not yet committed or restarted as the
+  // low-water mark. Called at commit with the write locks held.
+  void GarbageCollection(Txn* txn);
+
+  // Concurrency control mechanism the TxnProcessor is currently using.
+  CCMode mode_;
+
+  // Thread pool managing all threads used by TxnProcessor.
+  ThreadPool* tp_;
+
+  // Thread running RunScheduler().
+  pthread_t scheduler_thread_;
+
+  // Data storage used for all modes.
+  Storage* storage_;
+
+  // Source of unique_ids. In MVCC mode it also tracks the ids of all txns
+  // submitted but not yet finished, which bound the GC low-water mark.
+  TimestampOracle timestamps_;
+
+  // Queue of incoming transaction requests.
+  MPMCQueue<Txn*> txn_requests_;
+
+  // Admission control (see TxnProcessorConfig::max_in_flight_): txns
+  // admitted and not yet returned, and those of them not yet taken from
+  // 'txn_requests_'. Clients waiting for room wait on 'admission_'; it is
+  // only broadcast while 'admission_waiters_' is nonzero.
+  size_t max_in_flight_;
+  size_t max_queued_;
+  std::atomic<uint64> in_flight_;
+  std::atomic<uint64> queued_;
+  Condition admission_;
+  std::atomic<int> admission_waiters_;
+  std::atomic<uint64> rejected_;
+
+  // Restarted txns waiting to be retried, soonest due first (ties, and aged
+  // txns, which are due at once, oldest first), and the due time of the
+  // first, which lets PopRequests() skip 'retry_mutex_' until it comes.
+  struct Retry {
+    uint64 due_;
+    uint64 submitted_;
+    Txn* txn_;
+    bool operator<(const Retry& other) const {
+      // std::priority_queue puts the largest first.
+      if (due_ != other.due_)
+        return due_ > other.due_;
+      return submitted_ > other.submitted_;
+    }
+  };
+  std::priority_queue<Retry> retry_queue_;
+  Mutex retry_mutex_;
+  std::atomic<uint64> retry_due_;
+  uint64 retry_backoff_cycles_;
+  uint64 retry_backoff_max_cycles_;
+
+  // Queue of txns that have acquired all locks and are ready to be executed.
+  //
+  // Does not need to be atomic because RunScheduler is the only thread that
+  // will ever access this queue.
+  RingDeque<Txn*> ready_txns_;
+
+  // Queue of completed (but not yet committed/aborted) transactions.
+  MPMCQueue<Txn*> completed_txns_;
+
+  // Writes of the batch CommitLockedTxns() is committing, not yet applied.
+  // Only touched by the scheduler thread.
+  struct PendingWrite {
+    Key key_;
+    Value value_;
+    uint64 txn_unique_id_;
+    bool operator<(const PendingWrite& other) const {
+      return key_ < other.key_;
+    }
+  };
+  vector<PendingWrite> pending_writes_;
+
+  // Queue of transaction results (already committed or aborted) to be returned
+  // to client.
+  MPMCQueue<Txn*> txn_results_;
+
+  // Clients sleeping in GetTxnResults() wait on 'results_ready_'. Producers
+  // only signal it when 'result_waiters_' is nonzero, so a busy client that
+  // always finds results costs producers nothing extra.
+  Condition results_ready_;
+  std::atomic<int> result_waiters_;
+
+  // Transactions that are currently in the process of parallel validation,
+  // in no particular order. Guarded by active_set_mutex_; its storage is
+  // kept, so joining and leaving it do not allocate once it has grown.
+  vector<Txn*> active_set_;
+
+  // Makes snapshotting active_set_ and joining it one atomic step, and keeps
+  // txns from leaving the set while a snapshot is being taken.
+  Mutex active_set_mutex_;
+
+  // State of the apply gate (see BeginApply): writers between BeginApply()
+  // and EndApply(), writers done, and SnapshotRead() calls waiting for
+  // 'applying_' to drain, which keep new writers out meanwhile.
+  std::atomic<int> applying_;
+  std::atomic<uint64> applied_;
+  std::atomic<int> blocking_readers_;
+
+  // Redo log of durable commit mode, or NULL.
+  RedoLog* log_;
+
+  // Passes txns made durable by 'log_' on to PushResult().
+  class LogCallback : public TxnCallback {
+   public:
+    explicit LogCallback(TxnProcessor* processor) : processor_(processor) {}
+    virtual void Done(Txn* txn) { processor_->PushResult(txn); }
+
+   private:
+    TxnProcessor* processor_;
+  };
+  LogCallback log_callback_;
+
+  // Reads txns' scans (see ScanSeek()). Set as every txn's scan_source_.
+  class ScanReader : public ScanSource {
+   public:
+    explicit ScanReader(TxnProcessor* processor) : processor_(processor) {}
+    virtual void ScanSeek(ScanCursor* cursor, Key lo, Key hi) {
+      processor_->ScanSeek(cursor, lo, hi);
+    }
+    virtual bool ScanNext(ScanCursor* cursor) {
+      return processor_->ScanNext(cursor);
+    }
+
+   private:
+    TxnProcessor* processor_;
+  };
+  ScanReader scan_reader_;
+
+  // Destination of Checkpoint(), or empty.
+  string checkpoint_path_;
+
+  // Lock Manager used for LOCKING concurrency implementations.
+  LockManager* lm_;
+
+  // Txns that waited for locks in LOCKING_PARTITIONED mode and now hold all
+  // of them.
+  MPMCQueue<Txn*> lock_ready_txns_;
+
+  // Conflict handling and its counters for the LOCKING modes. The counters
+  // are only written by the scheduler thread.
+  LockConflictPolicy lock_policy_;
+
+  // CALVIN epoch limits, with the limit in cycles.
+  size_t batch_size_;
+  uint64 batch_cycles_;
+
+  // ADAPTIVE state, only used by the scheduler thread except for the
+  // counters GetAdaptiveStats() reports. The window counts are of writer
+  // attempts: run under OCC and restarted, and run under locks and blocked.
+  KeyHotness hotness_;
+  int window_optimistic_;
+  int window_restarted_;
+  int window_locked_;
+  int window_waited_;
+  std::atomic<uint64> optimistic_;
+  std::atomic<uint64> locked_;
+  std::atomic<uint64> hot_key_locked_;
+  std::atomic<uint64> switches_;
+  std::atomic<bool> pessimistic_;
+  std::atomic<double> restart_rate_;
+  std::atomic<double> wait_rate_;
+  std::atomic<uint64> restarts_;
+  std::atomic<uint64> restarts_avoided_;
+
+  // What GetTxnStats() reports, split into shards that are each written by
+  // the threads whose ThreadIndex() maps to them and guarded by 'mutex_'.
+  struct TxnStatsShard {
+    TxnStatsShard()
+        : committed_(0), aborted_(0), restarts_(0), backoffs_(0),
+          read_only_committed_(0) {}
+    Mutex mutex_;
+    uint64 committed_;
+    uint64 aborted_;
+    uint64 restarts_;
+    uint64 backoffs_;
+    uint64 read_only_committed_;
+    Histogram latency_[TXN_PHASES];
+  };
+  TxnStatsShard* ThreadStatsShard();
+  // Counts finished 'txn' in '*shard', which must be locked; 'now' is when
+  // it finished.
+  void RecordResult(TxnStatsShard* shard, const Txn& txn, uint64 now);
+  TxnStatsShard* stats_shards_;
+  int stats_shard_count_;
+  double nanos_per_cycle_;
+
+  // Set by the destructor to make the scheduler loop exit.
+  std::atomic<bool> stopped_;
+
+};
+
+#endif  // _TXN_PROCESSOR_H_
+
@@ -1,266 +1,920 @@
-// Author: Alexander Thomson (thomson@cs.yale.edu)
-// Modified by: Kun Ren (kun.ren@yale.edu)
-
-#include "txn/txn_processor.h"
-
-#include <vector>
-
-#include "txn/txn_types.h"
-#include "utils/testing.h"
-
-// Returns a human-readable string naming of the providing mode.
-string ModeToString(CCMode mode) {
-  switch (mode) {
-    case SERIAL:                 return " Serial   ";
-    case LOCKING_EXCLUSIVE_ONLY: return " Locking A";
-    case LOCKING:                return " Locking B";
-    case OCC:                    return " OCC      ";
-    case P_OCC:                  return " OCC-P    ";
-    case MVCC:                   return " MVCC     ";
-    default:                     return "INVALID MODE";
-  }
-}
-
-class LoadGen {
- public:
-  virtual ~LoadGen() {}
-  virtual Txn* NewTxn() = 0;
-};
-
-class RMWLoadGen : public LoadGen {
- public:
-  RMWLoadGen(int dbsize, int rsetsize, int wsetsize, double wait_time)
-    : dbsize_(dbsize),
-      rsetsize_(rsetsize),
-      wsetsize_(wsetsize),
-      wait_time_(wait_time) {
-  }
-
-  virtual Txn* NewTxn() {
-    return new RMW(dbsize_, rsetsize_, wsetsize_, wait_time_);
-  }
-
- private:
-  int dbsize_;
-  int rsetsize_;
-  int wsetsize_;
-  double wait_time_;
-};
-
-class RMWLoadGen2 : public LoadGen {
- public:
-  RMWLoadGen2(int dbsize, int rsetsize, int wsetsize, double wait_time)
-    : dbsize_(dbsize),
-      rsetsize_(rsetsize),
-      wsetsize_(wsetsize),
-      wait_time_(wait_time) {
-  }
-
-  virtual Txn* NewTxn() {
-    // 80% of transactions are READ only transactions and run for the full
-    // transaction duration. The rest are very fast (< 0.1ms), high-contention
-    // updates.
-    if (rand() % 100 < 80)
-      return new RMW(dbsize_, rsetsize_, 0, wait_time_);
-    else
-      return new RMW(dbsize_, 0, wsetsize_, 0);
-  }
-
- private:
-  int dbsize_;
-  int rsetsize_;
-  int wsetsize_;
-  double wait_time_;
-};
-
-void Benchmark(const vector<LoadGen*>& lg) {
-  // Number of transaction requests that can be active at any given time.
-  int active_txns = 100;
-  deque<Txn*> doneTxns;
-
-  // For each MODE...
-  for (CCMode mode = MVCC;
-      mode <= MVCC;
-      mode = static_cast<CCMode>(mode+2)) {
-    // Print out mode name.
-    cout << ModeToString(mode) << flush;
-
-    // For each experiment, run 3 times and get the average.
-    for (uint32 exp = 0; exp < lg.size(); exp++) {
-      double throughput[3];
-      for (uint32 round = 0; round < 3; round++) {
-
-        int txn_count = 0;
-
-        // Create TxnProcessor in next mode.
-        TxnProcessor* p = new TxnProcessor(mode);
-
-        // Record start time.
-        double start = GetTime();
-
-        // Start specified number of txns running.
-        for (int i = 0; i < active_txns; i++)
-          p->NewTxnRequest(lg[exp]->NewTxn());
-
-        // Keep 100 active txns at all times for the first full second.
-        while (GetTime() < start + 1) {
-          Txn* txn = p->GetTxnResult();
-          doneTxns.push_back(txn);
-          txn_count++;
-          p->NewTxnRequest(lg[exp]->NewTxn());
-        }
-
-        // Wait for all of them to finish.
-        for (int i = 0; i < active_txns; i++) {
-          Txn* txn = p->GetTxnResult();
-          doneTxns.push_back(txn);
-          txn_count++;
-        }
-
-        // Record end time.
-        double end = GetTime();
-      
-        throughput[round] = txn_count / (end-start);
-
-        doneTxns.clear();
-        delete p;
-      }
-      
-      // Print throughput
-      cout << "\t" << (throughput[0] + throughput[1] + throughput[2]) / 3 << "\t" << flush;
-    }
-
-    cout << endl;
-  }
-}
-
-int main(int argc, char** argv) {
-  cout << "\t\t\t    Average Transaction Duration" << endl;
-  cout << "\t\t0.1ms\t\t1ms\t\t10ms";
-  cout << endl;
-
-  cpu_set_t cs;
-  CPU_ZERO(&cs);
-  CPU_SET(3, &cs);
-  int ret = sched_setaffinity(0, sizeof(cs), &cs);
-  if (ret) {
-    perror("sched_setaffinity");
-    assert(false);
-  }
-
-  vector<LoadGen*> lg;
-
-  cout << "'Low contention' Read only (5 records)" << endl;
-  lg.push_back(new RMWLoadGen(1000000, 5, 0, 0.0001));
-  lg.push_back(new RMWLoadGen(1000000, 5, 0, 0.001));
-  lg.push_back(new RMWLoadGen(1000000, 5, 0, 0.01));
-
-  Benchmark(lg);
-
-  for (uint32 i = 0; i < lg.size(); i++)
-    delete lg[i];
-  lg.clear();
-  
-  cout << "'Low contention' Read only (20 records) " << endl;
-  lg.push_back(new RMWLoadGen(1000000, 20, 0, 0.0001));
-  lg.push_back(new RMWLoadGen(1000000, 20, 0, 0.001));
-  lg.push_back(new RMWLoadGen(1000000, 20, 0, 0.01));
-
-  Benchmark(lg);
-
-  for (uint32 i = 0; i < lg.size(); i++)
-    delete lg[i];
-  lg.clear();
-  
-  cout << "'High contention' Read only (5 records)" << endl;
-  lg.push_back(new RMWLoadGen(100, 5, 0, 0.0001));
-  lg.push_back(new RMWLoadGen(100, 5, 0, 0.001));
-  lg.push_back(new RMWLoadGen(100, 5, 0, 0.01));
-
-  Benchmark(lg);
-
-  for (uint32 i = 0; i < lg.size(); i++)
-    delete lg[i];
-  lg.clear();
-
-  cout << "'High contention' Read only (20 records)" << endl;
-  lg.push_back(new RMWLoadGen(100, 20, 0, 0.0001));
-  lg.push_back(new RMWLoadGen(100, 20, 0, 0.001));
-  lg.push_back(new RMWLoadGen(100, 20, 0, 0.01));
-
-  Benchmark(lg);
-
-  for (uint32 i = 0; i < lg.size(); i++)
-    delete lg[i];
-  lg.clear();
-  
-  cout << "Low contention read-write (5 records)" << endl;
-  lg.push_back(new RMWLoadGen(1000000, 0, 5, 0.0001));
-  lg.push_back(new RMWLoadGen(1000000, 0, 5, 0.001));
-  lg.push_back(new RMWLoadGen(1000000, 0, 5, 0.01));
-
-  Benchmark(lg);
-
-  for (uint32 i = 0; i < lg.size(); i++)
-    delete lg[i];
-  lg.clear();
-  
-  cout << "Low contention read-write (10 records)" << endl;
-  lg.push_back(new RMWLoadGen(1000000, 0, 10, 0.0001));
-  lg.push_back(new RMWLoadGen(1000000, 0, 10, 0.001));
-  lg.push_back(new RMWLoadGen(1000000, 0, 10, 0.01));
-
-  Benchmark(lg);
-
-  for (uint32 i = 0; i < lg.size(); i++)
-    delete lg[i];
-  lg.clear();
-  
-  cout << "High contention read-write (1 records)" << endl;
-  lg.push_back(new RMWLoadGen(5, 0, 1, 0.0001));
-  lg.push_back(new RMWLoadGen(5, 0, 1, 0.001));
-  lg.push_back(new RMWLoadGen(5, 0, 1, 0.01));
-
-  Benchmark(lg);
-
-  for (uint32 i = 0; i < lg.size(); i++)
-    delete lg[i];
-  lg.clear();
-  
-  cout << "High contention read-write (5 records)" << endl;
-  lg.push_back(new RMWLoadGen(100, 0, 5, 0.0001));
-  lg.push_back(new RMWLoadGen(100, 0, 5, 0.001));
-  lg.push_back(new RMWLoadGen(100, 0, 5, 0.01));
-
-  Benchmark(lg);
-
-  for (uint32 i = 0; i < lg.size(); i++)
-    delete lg[i];
-  lg.clear();
-
-  cout << "High contention read-write (10 records)" << endl;
-  lg.push_back(new RMWLoadGen(100, 0, 10, 0.0001));
-  lg.push_back(new RMWLoadGen(100, 0, 10, 0.001));
-  lg.push_back(new RMWLoadGen(100, 0, 10, 0.01));
-
-  Benchmark(lg);
-
-  for (uint32 i = 0; i < lg.size(); i++)
-    delete lg[i];
-  lg.clear();
-  
-  // 80% of transactions are READ only transactions and run for the full
-  // transaction duration. The rest are very fast (< 0.1ms), high-contention
-  // updates.
-  cout << "High contention mixed read only/read-write " << endl;
-  lg.push_back(new RMWLoadGen2(50, 30, 10, 0.0001));
-  lg.push_back(new RMWLoadGen2(50, 30, 10, 0.001));
-  lg.push_back(new RMWLoadGen2(50, 30, 10, 0.01));
-
-  Benchmark(lg);
-
-  for (uint32 i = 0; i < lg.size(); i++)
-    delete lg[i];
-  lg.clear();
-}
-
+// Author: Alexander Thomson (thomson@cs.yale.edu)
+// Modified by: Kun Ren (kun.ren@yale.edu)
+
+#include "txn/txn_processor.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#include "txn/txn_pool.h"
+#include "txn/txn_types.h"
+#include "utils/testing.h"
+
+// Number of heap allocations made so far by the whole process. Counted by
+// replacing the global operator new (operator new[] forwards to it).
+static std::atomic<uint64> allocation_count(0);
+
+void* operator new(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* memory = malloc(size);
+  if (memory == NULL)
+    throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void* memory) noexcept {
+  free(memory);
+}
+
+// Returns a human-readable string naming of the providing mode.
+string ModeToString(CCMode mode) {
+  switch (mode) {
+    case SERIAL:                 return " Serial   ";
+    case LOCKING_EXCLUSIVE_ONLY: return " Locking A";
+    case LOCKING:                return " Locking B";
+    case OCC:                    return " OCC      ";
+    case P_OCC:                  return " OCC-P    ";
+    case MVCC:                   return " MVCC     ";
+    case LOCKING_PARTITIONED:    return " Locking P";
+    case CALVIN:                 return " Calvin   ";
+    case ADAPTIVE:               return " Adaptive ";
+    default:                     return "INVALID MODE";
+  }
+}
+
+class LoadGen {
+ public:
+  virtual ~LoadGen() {}
+  virtual Txn* NewTxn() = 0;
+
+  // Recycles a txn returned by NewTxn() once its result has been consumed.
+  void Release(Txn* txn) { pool_.Release(txn); }
+
+ protected:
+  TxnPool<RMW> pool_;
+};
+
+class RMWLoadGen : public LoadGen {
+ public:
+  RMWLoadGen(int dbsize, int rsetsize, int wsetsize, double wait_time)
+    : dbsize_(dbsize),
+      rsetsize_(rsetsize),
+      wsetsize_(wsetsize),
+      wait_time_(wait_time) {
+  }
+
+  virtual Txn* NewTxn() {
+    RMW* txn = pool_.Acquire();
+    txn->Init(dbsize_, rsetsize_, wsetsize_, wait_time_);
+    return txn;
+  }
+
+ private:
+  int dbsize_;
+  int rsetsize_;
+  int wsetsize_;
+  double wait_time_;
+};
+
+class RMWLoadGen2 : public LoadGen {
+ public:
+  RMWLoadGen2(int dbsize, int rsetsize, int wsetsize, double wait_time)
+    : dbsize_(dbsize),
+      rsetsize_(rsetsize),
+      wsetsize_(wsetsize),
+      wait_time_(wait_time) {
+  }
+
+  virtual Txn* NewTxn() {
+    // 80% of transactions are READ only transactions and run for the full
+    // transaction duration. The rest are very fast (< 0.1ms), high-contention
+    // updates.
+    RMW* txn = pool_.Acquire();
+    if (ThreadRandom()->Uniform(100) < 80)
+      txn->Init(dbsize_, rsetsize_, 0, wait_time_);
+    else
+      txn->Init(dbsize_, 0, wsetsize_, 0);
+    return txn;
+  }
+
+ private:
+  int dbsize_;
+  int rsetsize_;
+  int wsetsize_;
+  double wait_time_;
+};
+
+TEST(TxnProcessor_BatchedRequests) {
+  TxnProcessor p(SERIAL);
+  Txn* txns[10];
+  Txn* results[10];
+
+  // Nothing has been submitted yet, so both calls time out.
+  EXPECT_EQ(0, p.GetTxnResults(results, 10, 0));
+  EXPECT_EQ(0, p.GetTxnResults(results, 10, 0.001));
+
+  for (int i = 0; i < 10; i++)
+    txns[i] = new Noop();
+  p.NewTxnRequests(txns, 10);
+
+  // All ten come back (in some number of batches), committed.
+  int count = 0;
+  while (count < 10)
+    count += p.GetTxnResults(results + count, 10 - count, 1);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(COMMITTED, results[i]->Status());
+    delete results[i];
+  }
+
+  // Without a timeout, the client sleeps until the result is there.
+  Noop txn;
+  p.NewTxnRequest(&txn);
+  EXPECT_EQ(1, p.GetTxnResults(results, 10));
+  EXPECT_EQ(&txn, results[0]);
+
+  END;
+}
+
+// Counts the txns handed to it.
+class CountingCallback : public TxnCallback {
+ public:
+  CountingCallback() : committed_(0) {}
+  virtual void Done(Txn* txn) {
+    if (txn->Status() == COMMITTED)
+      committed_++;
+  }
+  std::atomic<int> committed_;
+};
+
+TEST(TxnProcessor_Callbacks) {
+  TxnProcessor p(MVCC);
+
+  // Results with a callback bypass the result queue.
+  RMW txns[20];
+  CountingCallback callback;
+  for (int i = 0; i < 20; i++) {
+    txns[i].Init(10, 0, 2);
+    p.NewTxnRequest(&txns[i], &callback);
+  }
+
+  Noop noop;
+  TxnFuture future;
+  p.NewTxnRequest(&noop, &future);
+  EXPECT_EQ(&noop, future.Get());
+  EXPECT_TRUE(future.Ready());
+  EXPECT_EQ(COMMITTED, noop.Status());
+
+  while (callback.committed_ < 20) {}
+  Txn* result;
+  EXPECT_EQ(0, p.GetTxnResults(&result, 1, 0));
+
+  END;
+}
+
+void Benchmark(const vector<LoadGen*>& lg) {
+  // Number of transaction requests that can be active at any given time.
+  const int active_txns = 100;
+  Txn* batch[active_txns];
+
+  // For each MODE...
+  for (CCMode mode = SERIAL;
+      mode <= ADAPTIVE;
+      mode = static_cast<CCMode>(mode+1)) {
+    // Print out mode name.
+    cout << ModeToString(mode) << flush;
+
+    // For each experiment, run 3 times and get the average.
+    vector<double> allocations_per_txn;
+    vector<uint64> p50, p99, p999;
+    vector<double> restarts_per_txn;
+    for (uint32 exp = 0; exp < lg.size(); exp++) {
+      double throughput[3];
+      uint64 allocations = 0;
+      uint64 txns = 0;
+      Histogram latency;
+      uint64 restarts = 0;
+      for (uint32 round = 0; round < 3; round++) {
+
+        int txn_count = 0;
+
+        // Create TxnProcessor in next mode.
+        TxnProcessor* p = new TxnProcessor(mode);
+
+        // Record start time.
+        double start = GetTime();
+        uint64 start_allocations = allocation_count;
+
+        // Start specified number of txns running.
+        for (int i = 0; i < active_txns; i++)
+          batch[i] = lg[exp]->NewTxn();
+        p->NewTxnRequests(batch, active_txns);
+
+        // Keep 100 active txns at all times for the first full second,
+        // replacing finished txns a batch at a time.
+        while (GetTime() < start + 1) {
+          size_t count = p->GetTxnResults(batch, active_txns);
+          for (size_t i = 0; i < count; i++) {
+            lg[exp]->Release(batch[i]);
+            batch[i] = lg[exp]->NewTxn();
+          }
+          p->NewTxnRequests(batch, count);
+          txn_count += count;
+        }
+
+        // Wait for all of them to finish.
+        for (int pending = active_txns; pending > 0; ) {
+          size_t count = p->GetTxnResults(batch, pending);
+          for (size_t i = 0; i < count; i++)
+            lg[exp]->Release(batch[i]);
+          pending -= count;
+          txn_count += count;
+        }
+
+        // Record end time.
+        double end = GetTime();
+      
+        throughput[round] = txn_count / (end-start);
+        allocations += allocation_count - start_allocations;
+        txns += txn_count;
+
+        TxnStats* stats = new TxnStats();
+        p->GetTxnStats(stats);
+        latency.Merge(stats->latency_[PHASE_TOTAL]);
+        restarts += stats->restarts_;
+        delete stats;
+
+        delete p;
+      }
+      
+      // Print throughput
+      cout << "\t" << (throughput[0] + throughput[1] + throughput[2]) / 3 << "\t" << flush;
+      allocations_per_txn.push_back(static_cast<double>(allocations) / txns);
+      p50.push_back(latency.Percentile(0.5));
+      p99.push_back(latency.Percentile(0.99));
+      p999.push_back(latency.Percentile(0.999));
+      restarts_per_txn.push_back(static_cast<double>(restarts) / txns);
+    }
+
+    // Print heap allocations per txn (including the load generator's).
+    cout << endl << "  allocs/txn";
+    for (uint32 exp = 0; exp < allocations_per_txn.size(); exp++)
+      cout << "\t" << allocations_per_txn[exp] << "\t";
+
+    // Print latency percentiles (in microseconds) and restarts per txn.
+    cout << endl << "  p50/99/999us";
+    for (uint32 exp = 0; exp < p50.size(); exp++) {
+      cout << "\t" << p50[exp] / 1000 << "/" << p99[exp] / 1000 << "/"
+           << p999[exp] / 1000;
+    }
+    cout << endl << "  restarts/txn";
+    for (uint32 exp = 0; exp < restarts_per_txn.size(); exp++)
+      cout << "\t" << restarts_per_txn[exp] << "\t";
+    cout << endl;
+  }
+}
+
+TEST(TxnProcessor_Stats) {
+  Histogram histogram;
+  for (uint64 value = 1; value <= 1000; value++)
+    histogram.Record(value);
+  EXPECT_EQ(1000, histogram.Count());
+  EXPECT_EQ(1000, histogram.Max());
+  // Every percentile is within one bucket (about 3%) above the true value.
+  EXPECT_TRUE(histogram.Percentile(0.5) >= 500);
+  EXPECT_TRUE(histogram.Percentile(0.5) <= 516);
+  EXPECT_TRUE(histogram.Percentile(0.99) >= 990);
+  EXPECT_EQ(1000, histogram.Percentile(1));
+
+  CCMode modes[] = {LOCKING, MVCC};
+  for (int i = 0; i < 2; i++) {
+    TxnProcessor p(modes[i]);
+    Txn* txns[50];
+    for (int j = 0; j < 50; j++) {
+      // Half of them abort themselves.
+      if (j % 2 == 0)
+        txns[j] = new RMW(10, 0, 2);
+      else
+        txns[j] = new Expect(map<Key, Value>{{100, 1}});
+    }
+    p.NewTxnRequests(txns, 50);
+    for (size_t done = 0; done < 50; )
+      done += p.GetTxnResults(txns + done, 50 - done);
+
+    TxnStats stats;
+    p.GetTxnStats(&stats);
+    EXPECT_EQ(25, stats.committed_);
+    EXPECT_EQ(25, stats.aborted_);
+    EXPECT_EQ(50, stats.latency_[PHASE_TOTAL].Count());
+    EXPECT_EQ(50, stats.latency_[PHASE_EXECUTE].Count());
+    // The read-only Expect txns take no locks.
+    uint64 lock_waits = modes[i] == LOCKING ? 25 : 0;
+    EXPECT_EQ(lock_waits, stats.latency_[PHASE_LOCK_WAIT].Count());
+    EXPECT_TRUE(stats.latency_[PHASE_TOTAL].Percentile(0.5) > 0);
+    EXPECT_TRUE(stats.latency_[PHASE_TOTAL].Max() >=
+                stats.latency_[PHASE_EXECUTE].Max());
+
+    for (int j = 0; j < 50; j++)
+      delete txns[j];
+  }
+
+  END;
+}
+
+// Reads 'keys' and commits iff they all have the same value.
+class AllEqual : public Txn {
+ public:
+  explicit AllEqual(const vector<Key>& keys) {
+    for (size_t i = 0; i < keys.size(); i++)
+      readset_.insert(keys[i]);
+  }
+
+  AllEqual* clone() const {
+    AllEqual* clone = new AllEqual(vector<Key>());
+    this->CopyTxnInternals(clone);
+    return clone;
+  }
+
+  virtual void Run() {
+    Value first = 0, value = 0;
+    for (KeySet::const_iterator it = readset_.begin(); it != readset_.end();
+         ++it) {
+      if (!Read(*it, &value) || (it != readset_.begin() && value != first))
+        ABORT;
+      first = value;
+    }
+    COMMIT;
+  }
+};
+
+TEST(TxnProcessor_ReadOnly) {
+  // Writers keep keys 0-19 equal; readers must never see them differ.
+  vector<Key> keys;
+  for (Key key = 0; key < 20; key++)
+    keys.push_back(key);
+  for (int mode = LOCKING_EXCLUSIVE_ONLY; mode <= ADAPTIVE; mode++) {
+    TxnProcessor p(static_cast<CCMode>(mode));
+    const int kTxns = 400;
+    Txn* txns[kTxns];
+    for (int j = 0; j < kTxns; j++) {
+      if (j % 2 == 0) {
+        map<Key, Value> writes;
+        for (size_t k = 0; k < keys.size(); k++)
+          writes[keys[k]] = j;
+        txns[j] = new Put(writes);
+      } else {
+        txns[j] = new AllEqual(keys);
+      }
+    }
+    p.NewTxnRequests(txns, kTxns);
+    for (int done = 0; done < kTxns; )
+      done += p.GetTxnResults(txns + done, kTxns - done);
+
+    TxnStats stats;
+    p.GetTxnStats(&stats);
+    EXPECT_EQ(kTxns, stats.committed_);
+    EXPECT_EQ(kTxns / 2, stats.read_only_committed_);
+    for (int j = 0; j < kTxns; j++)
+      delete txns[j];
+  }
+
+  END;
+}
+
+// Runs 'txn' in 'p' and returns its status.
+static TxnStatus RunTxn(TxnProcessor* p, Txn* txn) {
+  TxnFuture future;
+  p->NewTxnRequest(txn, &future);
+  return future.Get()->Status();
+}
+
+TEST(TxnProcessor_Recovery) {
+  CCMode modes[] = {LOCKING, MVCC};
+  for (int i = 0; i < 2; i++) {
+    TxnProcessorConfig config;
+    config.log_path_ = "/tmp/txn_processor_recovery_test.log";
+    config.checkpoint_path_ = "/tmp/txn_processor_recovery_test.ckpt";
+    unlink(config.log_path_.c_str());
+    unlink(config.checkpoint_path_.c_str());
+
+    map<Key, Value> before, after, expected;
+    before[1] = 11;
+    before[2] = 12;
+    after[2] = 22;
+    after[3] = 33;
+    expected[1] = 11;
+    expected[2] = 22;
+    expected[3] = 33;
+    expected[4] = 0;
+
+    {
+      TxnProcessor p(modes[i], config);
+      Put put_before(before);
+      EXPECT_EQ(COMMITTED, RunTxn(&p, &put_before));
+      p.Checkpoint();
+      Put put_after(after);
+      EXPECT_EQ(COMMITTED, RunTxn(&p, &put_after));
+    }
+
+    // The checkpoint holds the first Put and the log tail the second.
+    {
+      TxnProcessor p(modes[i], config);
+      Expect expect(expected);
+      EXPECT_EQ(COMMITTED, RunTxn(&p, &expect));
+    }
+
+    unlink(config.log_path_.c_str());
+    unlink(config.checkpoint_path_.c_str());
+  }
+
+  END;
+}
+
+TEST(TxnProcessor_RecoveryLargeIds) {
+  CCMode modes[] = {LOCKING, MVCC};
+  for (int i = 0; i < 2; i++) {
+    TxnProcessorConfig config;
+    config.log_path_ = "/tmp/txn_processor_recovery_test.log";
+    config.checkpoint_path_ = "/tmp/txn_processor_recovery_test.ckpt";
+    unlink(config.log_path_.c_str());
+
+    // A checkpoint left by a processor whose ids got close to INT_MAX, so
+    // that the ids handed out after recovery cross it.
+    vector<KeyValue> records(1);
+    records[0].key_ = 7;
+    records[0].value_ = 1;
+    WriteCheckpoint(config.checkpoint_path_, 0, INT_MAX - 5, &records);
+
+    {
+      TxnProcessor p(modes[i], config);
+      for (int j = 0; j < 10; j++) {
+        RMW rmw(set<Key>{7});
+        EXPECT_EQ(COMMITTED, RunTxn(&p, &rmw));
+      }
+      Expect expect(map<Key, Value>{{7, 11}});
+      EXPECT_EQ(COMMITTED, RunTxn(&p, &expect));
+
+      // The next checkpoint's snapshot id is past INT_MAX as well.
+      p.Checkpoint();
+      RMW rmw(set<Key>{7});
+      EXPECT_EQ(COMMITTED, RunTxn(&p, &rmw));
+    }
+    MappedCheckpoint checkpoint;
+    EXPECT_TRUE(checkpoint.Open(config.checkpoint_path_));
+    EXPECT_TRUE(checkpoint.Header().snapshot_id_ > INT_MAX);
+
+    {
+      TxnProcessor p(modes[i], config);
+      Expect expect(map<Key, Value>{{7, 12}});
+      EXPECT_EQ(COMMITTED, RunTxn(&p, &expect));
+    }
+
+    unlink(config.log_path_.c_str());
+    unlink(config.checkpoint_path_.c_str());
+  }
+
+  END;
+}
+
+TEST(TxnProcessor_Calvin) {
+  TxnProcessorConfig config;
+  config.batch_size_ = 16;
+  TxnProcessor p(CALVIN, config);
+
+  // Conflicting writers of one key take effect in submission order, across
+  // epochs, and none of them restarts.
+  const int kTxns = 100;
+  Txn* txns[kTxns];
+  for (int j = 0; j < kTxns; j++)
+    txns[j] = new Put(map<Key, Value>{{1, j}, {2, j}});
+  p.NewTxnRequests(txns, kTxns);
+  for (int done = 0; done < kTxns; )
+    done += p.GetTxnResults(txns + done, kTxns - done);
+  for (int j = 0; j < kTxns; j++) {
+    EXPECT_EQ(COMMITTED, txns[j]->Status());
+    delete txns[j];
+  }
+
+  // A lone writer is let through once its epoch times out.
+  Put put(map<Key, Value>{{3, 3}});
+  EXPECT_EQ(COMMITTED, RunTxn(&p, &put));
+  Expect expect(map<Key, Value>{{1, kTxns - 1}, {2, kTxns - 1}, {3, 3}});
+  EXPECT_EQ(COMMITTED, RunTxn(&p, &expect));
+
+  TxnStats stats;
+  p.GetTxnStats(&stats);
+  EXPECT_EQ(0, stats.restarts_);
+  LockStats lock_stats;
+  p.GetLockStats(&lock_stats);
+  EXPECT_EQ(0, lock_stats.restarts_);
+
+  END;
+}
+
+TEST(TxnProcessor_Adaptive) {
+  TxnProcessor p(ADAPTIVE);
+
+  // Writers spread over a million keys rarely conflict and stay optimistic.
+  const int kTxns = 1000;
+  Txn* txns[kTxns];
+  for (int j = 0; j < kTxns; j++)
+    txns[j] = new RMW(1000000, 0, 2, 0);
+  p.NewTxnRequests(txns, kTxns);
+  for (int done = 0; done < kTxns; )
+    done += p.GetTxnResults(txns + done, kTxns - done);
+  for (int j = 0; j < kTxns; j++)
+    delete txns[j];
+
+  AdaptiveStats stats;
+  p.GetAdaptiveStats(&stats);
+  EXPECT_TRUE(stats.optimistic_ >= kTxns);
+  EXPECT_FALSE(stats.pessimistic_);
+
+  // Writers of two keys only: they conflict, their keys turn hot, and from
+  // then on they wait for locks. Every increment still counts once.
+  Put reset(map<Key, Value>{{1, 0}, {2, 0}});
+  EXPECT_EQ(COMMITTED, RunTxn(&p, &reset));
+  const int kHotTxns = 300;
+  for (int j = 0; j < kHotTxns; j++)
+    txns[j] = new RMW(set<Key>{1, 2}, 0.001);
+  p.NewTxnRequests(txns, kHotTxns);
+  for (int done = 0; done < kHotTxns; )
+    done += p.GetTxnResults(txns + done, kHotTxns - done);
+  for (int j = 0; j < kHotTxns; j++) {
+    EXPECT_EQ(COMMITTED, txns[j]->Status());
+    delete txns[j];
+  }
+
+  p.GetAdaptiveStats(&stats);
+  EXPECT_TRUE(stats.locked_ > 0);
+  EXPECT_TRUE(stats.hot_key_locked_ > 0 || stats.switches_ > 0);
+  Expect expect(map<Key, Value>{{1, kHotTxns}, {2, kHotTxns}});
+  EXPECT_EQ(COMMITTED, RunTxn(&p, &expect));
+
+  END;
+}
+
+TEST(TxnProcessor_Scan) {
+  // Writers keep [kLo, kHi), which straddles the end of the record array,
+  // adding up to 0: they overwrite pairs of records with j and -j, and,
+  // past the array, insert such pairs, which scans must see both or
+  // neither of. A scan that misses a write or an insert aborts. MVCC txns
+  // cannot create records, so there are no inserts in MVCC mode.
+  const Key kLo = INIT_STORAGE_SIZE - 64;
+  const Key kHi = INIT_STORAGE_SIZE + 4096;
+  for (int mode = SERIAL; mode <= ADAPTIVE; mode++) {
+    if (mode == LOCKING_PARTITIONED)
+      continue;
+    TxnProcessor p(static_cast<CCMode>(mode));
+
+    // Records past the array live in hash maps, which must not grow while
+    // other threads read them; seeding them first leaves room for the few
+    // inserted below.
+    bool inserts = mode != MVCC;
+    if (inserts) {
+      map<Key, Value> seed;
+      for (Key i = 0; i < 1536; i++)
+        seed[INIT_STORAGE_SIZE + 2 * i] = 0;
+      Put put_seed(seed);
+      EXPECT_EQ(COMMITTED, RunTxn(&p, &put_seed));
+    }
+
+    const int kTxns = 300;
+    Txn* txns[kTxns];
+    for (int j = 0; j < kTxns; j++) {
+      Value v = j + 1;
+      if (j % 3 == 2) {
+        txns[j] = new ScanSum(kLo, kHi, 0);
+      } else if (j % 3 == 1 && inserts) {
+        Key a = INIT_STORAGE_SIZE + 2 * j + 1;
+        Key b = INIT_STORAGE_SIZE + 2 * (j + 700) + 1;
+        txns[j] = new Put(map<Key, Value>{{a, v}, {b, -v}});
+      } else {
+        Key a = kLo + 2 * (j % 32);
+        txns[j] = new Put(map<Key, Value>{{a, v}, {a + 1, -v}});
+      }
+    }
+    p.NewTxnRequests(txns, kTxns);
+    for (int done = 0; done < kTxns; )
+      done += p.GetTxnResults(txns + done, kTxns - done);
+    for (int j = 0; j < kTxns; j++) {
+      EXPECT_EQ(COMMITTED, txns[j]->Status());
+      delete txns[j];
+    }
+
+    ScanSum scan(kLo, kHi, 0);
+    EXPECT_EQ(COMMITTED, RunTxn(&p, &scan));
+  }
+
+  END;
+}
+
+TEST(TxnProcessor_Increment) {
+  const int kTxns = 300;
+  Txn* txns[kTxns];
+  for (int mode = SERIAL; mode <= ADAPTIVE; mode++) {
+    TxnProcessor p(static_cast<CCMode>(mode));
+    Put reset(map<Key, Value>{{1, 0}, {2, 0}});
+    EXPECT_EQ(COMMITTED, RunTxn(&p, &reset));
+
+    // Txns that only increment two hot keys never conflict with each other,
+    // except in the modes that hold increments exclusively.
+    for (int j = 0; j < kTxns; j++)
+      txns[j] = new RMW(set<Key>(), set<Key>(), set<Key>{1, 2});
+    p.NewTxnRequests(txns, kTxns);
+    for (int done = 0; done < kTxns; )
+      done += p.GetTxnResults(txns + done, kTxns - done);
+    for (int j = 0; j < kTxns; j++) {
+      EXPECT_EQ(COMMITTED, txns[j]->Status());
+      delete txns[j];
+    }
+    TxnStats stats;
+    p.GetTxnStats(&stats);
+    if (mode == LOCKING || mode == OCC || mode == MVCC || mode == CALVIN)
+      EXPECT_EQ(0, stats.restarts_);
+
+    // Mixed with txns that read and write the same keys, every increment
+    // still counts once.
+    for (int j = 0; j < kTxns; j++) {
+      if (j % 3 == 0)
+        txns[j] = new RMW(set<Key>{1, 2});
+      else
+        txns[j] = new RMW(set<Key>(), set<Key>(), set<Key>{1, 2});
+    }
+    p.NewTxnRequests(txns, kTxns);
+    for (int done = 0; done < kTxns; )
+      done += p.GetTxnResults(txns + done, kTxns - done);
+    for (int j = 0; j < kTxns; j++) {
+      EXPECT_EQ(COMMITTED, txns[j]->Status());
+      delete txns[j];
+    }
+    Expect expect(map<Key, Value>{{1, 2 * kTxns}, {2, 2 * kTxns}});
+    EXPECT_EQ(COMMITTED, RunTxn(&p, &expect));
+  }
+
+  END;
+}
+
+TEST(TxnProcessor_Admission) {
+  TxnProcessorConfig config;
+  config.max_in_flight_ = 4;
+  TxnProcessor p(LOCKING, config);
+
+  // Once four slow txns are in flight, no more are taken until one is
+  // returned.
+  Txn* txns[200];
+  for (int j = 0; j < 4; j++) {
+    txns[j] = new RMW(set<Key>{static_cast<Key>(j)}, 0.05);
+    EXPECT_TRUE(p.TryNewTxnRequest(txns[j]));
+  }
+  Noop noop;
+  EXPECT_FALSE(p.TryNewTxnRequest(&noop));
+  for (int done = 0; done < 4; )
+    done += p.GetTxnResults(txns + done, 4 - done);
+  for (int j = 0; j < 4; j++)
+    delete txns[j];
+  EXPECT_TRUE(p.TryNewTxnRequest(&noop));
+  EXPECT_EQ(&noop, p.GetTxnResult());
+  TxnStats stats;
+  p.GetTxnStats(&stats);
+  EXPECT_EQ(1, stats.rejected_);
+
+  // NewTxnRequest() waits for room instead, and a batch larger than the
+  // limit goes in once the processor is empty.
+  for (int j = 0; j < 20; j++)
+    txns[j] = new RMW(set<Key>{static_cast<Key>(j)}, 0.001);
+  for (int j = 0; j < 20; j++)
+    p.NewTxnRequest(txns[j]);
+  for (int done = 0; done < 20; )
+    done += p.GetTxnResults(txns + done, 20 - done);
+  for (int j = 0; j < 20; j++)
+    delete txns[j];
+  for (int j = 0; j < 10; j++)
+    txns[j] = new Noop();
+  p.NewTxnRequests(txns, 10);
+  for (int done = 0; done < 10; )
+    done += p.GetTxnResults(txns + done, 10 - done);
+  for (int j = 0; j < 10; j++)
+    delete txns[j];
+
+  // Txns fighting over one key all commit in the end, however often they
+  // are restarted and backed off.
+  CCMode modes[] = {LOCKING, OCC, MVCC};
+  for (int m = 0; m < 3; m++) {
+    TxnProcessorConfig hot_config;
+    hot_config.max_in_flight_ = 16;
+    TxnProcessor hot(modes[m], hot_config);
+    Put reset(map<Key, Value>{{1, 0}});
+    EXPECT_EQ(COMMITTED, RunTxn(&hot, &reset));
+    for (int j = 0; j < 200; j++) {
+      txns[j] = new RMW(set<Key>{1, 2});
+      hot.NewTxnRequest(txns[j]);
+    }
+    for (int done = 0; done < 200; )
+      done += hot.GetTxnResults(txns + done, 200 - done);
+    for (int j = 0; j < 200; j++) {
+      EXPECT_EQ(COMMITTED, txns[j]->Status());
+      delete txns[j];
+    }
+    Expect expect(map<Key, Value>{{1, 200}});
+    EXPECT_EQ(COMMITTED, RunTxn(&hot, &expect));
+    hot.GetTxnStats(&stats);
+    EXPECT_TRUE(stats.backoffs_ <= stats.restarts_);
+  }
+
+  END;
+}
+
+TEST(TxnProcessor_ContendedAllocations) {
+  // Txns writing 4 of 20 keys keep handing locks on to each other and
+  // restarting. Once the processor and the txn pool are warm, that must not
+  // touch the heap. MVCC allocates the versions it installs, so it is left
+  // out.
+  const int kActive = 100;
+  RMWLoadGen load(20, 0, 4, 0);
+  Txn* batch[kActive];
+  for (CCMode mode = SERIAL; mode <= ADAPTIVE;
+       mode = static_cast<CCMode>(mode + 1)) {
+    if (mode == MVCC)
+      continue;
+    TxnProcessor p(mode);
+    for (int i = 0; i < kActive; i++)
+      batch[i] = load.NewTxn();
+    p.NewTxnRequests(batch, kActive);
+
+    uint64 start_allocations = 0;
+    int done = 0;
+    while (done < 20000) {
+      if (done >= 5000 && start_allocations == 0)
+        start_allocations = allocation_count;
+      size_t count = p.GetTxnResults(batch, kActive);
+      for (size_t i = 0; i < count; i++) {
+        load.Release(batch[i]);
+        batch[i] = load.NewTxn();
+      }
+      p.NewTxnRequests(batch, count);
+      done += count;
+    }
+    double allocations =
+        static_cast<double>(allocation_count - start_allocations) /
+        (done - 5000);
+    if (allocations >= 0.01)
+      cout << ModeToString(mode) << "\t" << allocations << " allocations/txn"
+           << endl;
+    EXPECT_TRUE(allocations < 0.01);
+
+    for (int pending = kActive; pending > 0; ) {
+      size_t count = p.GetTxnResults(batch, pending);
+      for (size_t i = 0; i < count; i++)
+        load.Release(batch[i]);
+      pending -= count;
+    }
+  }
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  TxnProcessor_BatchedRequests();
+  TxnProcessor_Callbacks();
+  TxnProcessor_Recovery();
+  TxnProcessor_RecoveryLargeIds();
+  TxnProcessor_Stats();
+  TxnProcessor_ReadOnly();
+  TxnProcessor_Calvin();
+  TxnProcessor_Adaptive();
+  TxnProcessor_Scan();
+  TxnProcessor_Increment();
+  TxnProcessor_Admission();
+  TxnProcessor_ContendedAllocations();
+
+  cout << "\t\t\t    Average Transaction Duration" << endl;
+  cout << "\t\t0.1ms\t\t1ms\t\t10ms";
+  cout << endl;
+
+  cpu_set_t cs;
+  CPU_ZERO(&cs);
+  CPU_SET(3, &cs);
+  int ret = sched_setaffinity(0, sizeof(cs), &cs);
+  if (ret) {
+    perror("sched_setaffinity");
+    assert(false);
+  }
+
+  vector<LoadGen*> lg;
+
+  cout << "'Low contention' Read only (5 records)" << endl;
+  lg.push_back(new RMWLoadGen(1000000, 5, 0, 0.0001));
+  lg.push_back(new RMWLoadGen(1000000, 5, 0, 0.001));
+  lg.push_back(new RMWLoadGen(1000000, 5, 0, 0.01));
+
+  Benchmark(lg);
+
+  for (uint32 i = 0; i < lg.size(); i++)
+    delete lg[i];
+  lg.clear();
+  
+  cout << "'Low contention' Read only (20 records) " << endl;
+  lg.push_back(new RMWLoadGen(1000000, 20, 0, 0.0001));
+  lg.push_back(new RMWLoadGen(1000000, 20, 0, 0.001));
+  lg.push_back(new RMWLoadGen(1000000, 20, 0, 0.01));
+
+  Benchmark(lg);
+
+  for (uint32 i = 0; i < lg.size(); i++)
+    delete lg[i];
+  lg.clear();
+  
+  cout << "'High contention' Read only (5 records)" << endl;
+  lg.push_back(new RMWLoadGen(100, 5, 0, 0.0001));
+  lg.push_back(new RMWLoadGen(100, 5, 0, 0.001));
+  lg.push_back(new RMWLoadGen(100, 5, 0, 0.01));
+
+  Benchmark(lg);
+
+  for (uint32 i = 0; i < lg.size(); i++)
+    delete lg[i];
+  lg.clear();
+
+  cout << "'High contention' Read only (20 records)" << endl;
+  lg.push_back(new RMWLoadGen(100, 20, 0, 0.0001));
+  lg.push_back(new RMWLoadGen(100, 20, 0, 0.001));
+  lg.push_back(new RMWLoadGen(100, 20, 0, 0.01));
+
+  Benchmark(lg);
+
+  for (uint32 i = 0; i < lg.size(); i++)
+    delete lg[i];
+  lg.clear();
+  
+  cout << "Low contention read-write (5 records)" << endl;
+  lg.push_back(new RMWLoadGen(1000000, 0, 5, 0.0001));
+  lg.push_back(new RMWLoadGen(1000000, 0, 5, 0.001));
+  lg.push_back(new RMWLoadGen(1000000, 0, 5, 0.01));
+
+  Benchmark(lg);
+
+  for (uint32 i = 0; i < lg.size(); i++)
+    delete lg[i];
+  lg.clear();
+  
+  cout << "Low contention read-write (10 records)" << endl;
+  lg.push_back(new RMWLoadGen(1000000, 0, 10, 0.0001));
+  lg.push_back(new RMWLoadGen(1000000, 0, 10, 0.001));
+  lg.push_back(new RMWLoadGen(1000000, 0, 10, 0.01));
+
+  Benchmark(lg);
+
+  for (uint32 i = 0; i < lg.size(); i++)
+    delete lg[i];
+  lg.clear();
+  
+  cout << "High contention read-write (1 records)" << endl;
+  lg.push_back(new RMWLoadGen(5, 0, 1, 0.0001));
+  lg.push_back(new RMWLoadGen(5, 0, 1, 0.001));
+  lg.push_back(new RMWLoadGen(5, 0, 1, 0.01));
+
+  Benchmark(lg);
+
+  for (uint32 i = 0; i < lg.size(); i++)
+    delete lg[i];
+  lg.clear();
+  
+  cout << "High contention read-write (5 records)" << endl;
+  lg.push_back(new RMWLoadGen(100, 0, 5, 0.0001));
+  lg.push_back(new RMWLoadGen(100, 0, 5, 0.001));
+  lg.push_back(new RMWLoadGen(100, 0, 5, 0.01));
+
+  Benchmark(lg);
+
+  for (uint32 i = 0; i < lg.size(); i++)
+    delete lg[i];
+  lg.clear();
+
+  cout << "High contention read-write (10 records)" << endl;
+  lg.push_back(new RMWLoadGen(100, 0, 10, 0.0001));
+  lg.push_back(new RMWLoadGen(100, 0, 10, 0.001));
+  lg.push_back(new RMWLoadGen(100, 0, 10, 0.01));
+
+  Benchmark(lg);
+
+  for (uint32 i = 0; i < lg.size(); i++)
+    delete lg[i];
+  lg.clear();
+  
+  // 80% of transactions are READ only transactions and run for the full
+  // transaction duration. The rest are very fast (< 0.1ms), high-contention
+  // updates.
+  cout << "High contention mixed read only/read-write " << endl;
+  lg.push_back(new RMWLoadGen2(50, 30, 10, 0.0001));
+  lg.push_back(new RMWLoadGen2(50, 30, 10, 0.001));
+  lg.push_back(new RMWLoadGen2(50, 30, 10, 0.01));
+
+  Benchmark(lg);
+
+  for (uint32 i = 0; i < lg.size(); i++)
+    delete lg[i];
+  lg.clear();
+}
+
@@ -0,0 +1,34 @@
+#include "txn/txn.h"
+
+#include "txn/txn_pool.h"
+#include "txn/txn_types.h"
+#include "utils/testing.h"
+
+TEST(TxnPool_Recycle) {
+  TxnPool<RMW> pool;
+
+  RMW* txn = pool.Acquire();
+  txn->Init(100, 3, 2);
+  EXPECT_EQ(INCOMPLETE, txn->Status());
+
+  // A released txn is handed out again.
+  pool.Release(txn);
+  EXPECT_EQ(1, pool.Available());
+  RMW* reused = pool.Acquire();
+  EXPECT_EQ(txn, reused);
+  EXPECT_EQ(0, pool.Available());
+  reused->Init(100, 0, 0);
+  reused->Run();
+  EXPECT_EQ(COMPLETED_C, reused->Status());
+
+  // Reset() returns the txn to INCOMPLETE.
+  pool.Release(reused);
+  EXPECT_EQ(INCOMPLETE, pool.Acquire()->Status());
+  delete reused;
+
+  END;
+}
+
+int main(int argc, char** argv) {
+  TxnPool_Recycle();
+}
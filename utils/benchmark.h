@@ -0,0 +1,207 @@
+/// @file
+///
+/// Microbenchmark harness. A benchmark is an operation, called as
+/// op(thread, iteration), that the harness runs a fixed number of times on
+/// each of 1 or more threads. Every run of a benchmark starts with a warmup
+/// (so that caches, allocators and branch predictors settle and lazily
+/// built state exists), after which all its threads are released at once
+/// and the time until the last one finishes is measured. A benchmark is run
+/// several times and its median run reported, as one JSON record per
+/// benchmark and thread count. Options, all --name=value:
+///
+///   --filter=mutex      Only run benchmarks whose name contains this
+///   --threads=1,2,4     Thread counts to run each multi-threaded benchmark at
+///   --repetitions=5     Timed runs per benchmark; the median is reported
+///   --warmup=0.1        Untimed iterations before each run, as a fraction
+///                       of the timed ones
+///   --scale=1           Multiplies every benchmark's iteration count
+
+#ifndef _DB_UTILS_BENCHMARK_H_
+#define _DB_UTILS_BENCHMARK_H_
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <vector>
+
+using std::map;
+using std::string;
+using std::vector;
+
+/// @class Benchmarks
+///
+/// Parses the options above and runs benchmarks on request, printing their
+/// results to stdout as a JSON array:
+///
+///   Benchmarks bench(argc, argv);
+///   bench.Run("mutex/lock_unlock", 1000000, [&](int thread, uint64_t i) {
+///     mutex.Lock();
+///     mutex.Unlock();
+///   });
+///
+/// Each record gives the thread count, the iterations per thread, the
+/// median, fastest and slowest run's wall time divided by the iterations
+/// per thread (what one operation costs each thread), and the median run's
+/// total throughput over all threads.
+class Benchmarks {
+ public:
+  Benchmarks(int argc, char** argv)
+      : repetitions_(5), warmup_(0.1), scale_(1), records_(0) {
+    map<string, string> options;
+    for (int i = 1; i < argc; i++) {
+      const char* eq = strchr(argv[i], '=');
+      if (strncmp(argv[i], "--", 2) != 0 || eq == NULL)
+        Fail("Bad option", argv[i]);
+      options[string(argv[i] + 2, eq - argv[i] - 2)] = eq + 1;
+    }
+
+    string threads = "1,2,4";
+    for (map<string, string>::iterator it = options.begin();
+         it != options.end(); ++it) {
+      if (it->first == "filter")
+        filter_ = it->second;
+      else if (it->first == "threads")
+        threads = it->second;
+      else if (it->first == "repetitions")
+        repetitions_ = atoi(it->second.c_str());
+      else if (it->first == "warmup")
+        warmup_ = atof(it->second.c_str());
+      else if (it->first == "scale")
+        scale_ = atof(it->second.c_str());
+      else
+        Fail("Unknown option", it->first.c_str());
+    }
+    for (const char* s = threads.c_str(); *s != '\0'; ) {
+      thread_counts_.push_back(atoi(s));
+      s += strcspn(s, ",");
+      if (*s == ',')
+        s++;
+    }
+    if (repetitions_ < 1 || warmup_ < 0 || scale_ <= 0 ||
+        thread_counts_.empty())
+      Fail("Bad option value", "");
+    for (size_t i = 0; i < thread_counts_.size(); i++) {
+      if (thread_counts_[i] < 1)
+        Fail("Bad thread count in", threads.c_str());
+    }
+    printf("[");
+  }
+
+  ~Benchmarks() {
+    printf("\n]\n");
+  }
+
+  /// Thread counts requested with --threads.
+  const vector<int>& ThreadCounts() const { return thread_counts_; }
+
+  /// Runs 'op' 'iterations' times (times --scale) on one thread.
+  template<typename F>
+  void Run(const string& name, uint64_t iterations, F op) {
+    Run(name, 1, iterations, op);
+  }
+
+  /// Runs 'op' 'iterations' times (times --scale) on each of 'threads'
+  /// threads at once. 'op' must be safe to call concurrently.
+  template<typename F>
+  void Run(const string& name, int threads, uint64_t iterations, F op) {
+    if (name.find(filter_) == string::npos)
+      return;
+    iterations = std::max<uint64_t>(1, iterations * scale_);
+    uint64_t warmup = iterations * warmup_;
+
+    vector<double> seconds;
+    for (int r = 0; r < repetitions_; r++)
+      seconds.push_back(TimeRun(threads, warmup, iterations, op));
+    sort(seconds.begin(), seconds.end());
+    double median = seconds[seconds.size() / 2];
+
+    double ops = static_cast<double>(iterations) * threads;
+    printf("%s\n  {\"name\": \"%s\", \"threads\": %d, \"iterations\": %llu, "
+           "\"repetitions\": %d, \"ns_per_op\": %.2f, \"min_ns_per_op\": "
+           "%.2f, \"max_ns_per_op\": %.2f, \"ops_per_sec\": %.0f}",
+           records_++ > 0 ? "," : "", name.c_str(), threads,
+           static_cast<unsigned long long>(iterations), repetitions_,
+           median * 1e9 / iterations, seconds.front() * 1e9 / iterations,
+           seconds.back() * 1e9 / iterations, ops / median);
+    fflush(stdout);
+  }
+
+ private:
+  static void Fail(const char* message, const char* what) {
+    fprintf(stderr, "%s %s\n", message, what);
+    exit(1);
+  }
+
+  static double Now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+  }
+
+  // State shared by the threads of one run.
+  template<typename F>
+  struct RunState {
+    F* op_;
+    uint64_t warmup_;
+    uint64_t iterations_;
+    std::atomic<int> next_thread_;
+    std::atomic<int> ready_;
+    std::atomic<bool> go_;
+  };
+
+  template<typename F>
+  static void* RunThread(void* arg) {
+    RunState<F>* state = reinterpret_cast<RunState<F>*>(arg);
+    int thread = state->next_thread_.fetch_add(1);
+    for (uint64_t i = 0; i < state->warmup_; i++)
+      (*state->op_)(thread, i);
+    state->ready_.fetch_add(1);
+    while (!state->go_.load())
+      sched_yield();
+    for (uint64_t i = 0; i < state->iterations_; i++)
+      (*state->op_)(thread, i);
+    return NULL;
+  }
+
+  // Returns the seconds from releasing the threads of one run to the last
+  // of them finishing.
+  template<typename F>
+  static double TimeRun(int threads, uint64_t warmup, uint64_t iterations,
+                        F& op) {
+    RunState<F> state;
+    state.op_ = &op;
+    state.warmup_ = warmup;
+    state.iterations_ = iterations;
+    state.next_thread_ = 0;
+    state.ready_ = 0;
+    state.go_ = false;
+
+    vector<pthread_t> handles(threads);
+    for (int i = 0; i < threads; i++)
+      pthread_create(&handles[i], NULL, RunThread<F>, &state);
+    while (state.ready_.load() < threads)
+      sched_yield();
+    double start = Now();
+    state.go_ = true;
+    for (int i = 0; i < threads; i++)
+      pthread_join(handles[i], NULL);
+    return Now() - start;
+  }
+
+  string filter_;
+  vector<int> thread_counts_;
+  int repetitions_;
+  double warmup_;
+  double scale_;
+  int records_;
+};
+
+#endif  // _DB_UTILS_BENCHMARK_H_
@@ -0,0 +1,126 @@
+/// @file
+///
+/// Helpers for pinning threads to CPUs and NUMA nodes, and for placing large
+/// allocations on the nodes of the threads that will use them. NUMA topology
+/// is read from Linux sysfs, and memory placement relies on the kernel's
+/// default first-touch policy: a page lives on the node of the thread that
+/// first writes it.
+
+#ifndef _DB_UTILS_CPU_AFFINITY_H_
+#define _DB_UTILS_CPU_AFFINITY_H_
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <vector>
+
+using std::vector;
+
+// Returns a cpu set containing only 'cpu'.
+inline cpu_set_t SingleCpu(int cpu) {
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  return cpus;
+}
+
+// Sets '*cpus' to the CPUs of NUMA node 'node'. Returns false if the node
+// does not exist.
+inline bool NodeCpus(int node, cpu_set_t* cpus) {
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+  FILE* file = fopen(path, "r");
+  if (file == NULL)
+    return false;
+
+  // The list looks like "0-15,32-47".
+  CPU_ZERO(cpus);
+  int first, last;
+  while (fscanf(file, "%d", &first) == 1) {
+    last = first;
+    int c = fgetc(file);
+    if (c == '-') {
+      if (fscanf(file, "%d", &last) != 1)
+        break;
+      c = fgetc(file);
+    }
+    for (int cpu = first; cpu <= last; cpu++)
+      CPU_SET(cpu, cpus);
+    if (c != ',')
+      break;
+  }
+  fclose(file);
+  return CPU_COUNT(cpus) > 0;
+}
+
+// Starts 'start(arg)' on a new thread. If 'cpus' is not NULL the thread only
+// runs on those CPUs.
+inline int CreatePinnedThread(pthread_t* thread, const cpu_set_t* cpus,
+                              void* (*start)(void*), void* arg) {
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  if (cpus != NULL)
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), cpus);
+  int ret = pthread_create(thread, &attr, start, arg);
+  pthread_attr_destroy(&attr);
+  return ret;
+}
+
+// Alignment for an array of elements that RunPartitioned will place, so that
+// partition boundaries fall on page boundaries.
+inline size_t PartitionAlignment() {
+  return sysconf(_SC_PAGESIZE);
+}
+
+struct PartitionArgs {
+  void (*init)(void* arg, uint64_t begin, uint64_t end);
+  void* arg;
+  uint64_t begin;
+  uint64_t end;
+};
+
+inline void* RunPartition(void* arg) {
+  PartitionArgs* partition = reinterpret_cast<PartitionArgs*>(arg);
+  partition->init(partition->arg, partition->begin, partition->end);
+  return NULL;
+}
+
+// Calls 'init(arg, begin, end)' to initialize 'count' array elements of
+// 'elem_size' bytes each. The array is split into one contiguous range per
+// entry of 'affinity' (rounded to whole pages), and each range is
+// initialized by a thread pinned to that entry, so its memory ends up on that
+// thread's node. With an empty 'affinity', runs init(arg, 0, count) inline.
+//
+// Requires: the array is aligned to PartitionAlignment() and has not been
+// written yet.
+inline void RunPartitioned(const vector<cpu_set_t>& affinity, uint64_t count,
+                           size_t elem_size,
+                           void (*init)(void* arg, uint64_t begin, uint64_t end),
+                           void* arg) {
+  if (affinity.empty()) {
+    init(arg, 0, count);
+    return;
+  }
+
+  uint64_t per_page = PartitionAlignment() / elem_size;
+  if (per_page == 0)
+    per_page = 1;
+
+  int partitions = affinity.size();
+  vector<PartitionArgs> args(partitions);
+  vector<pthread_t> threads(partitions);
+  for (int i = 0; i < partitions; i++) {
+    args[i].init = init;
+    args[i].arg = arg;
+    args[i].begin = count * i / partitions / per_page * per_page;
+    args[i].end = (i == partitions - 1) ? count
+                  : count * (i + 1) / partitions / per_page * per_page;
+    CreatePinnedThread(&threads[i], &affinity[i], RunPartition, &args[i]);
+  }
+  for (int i = 0; i < partitions; i++)
+    pthread_join(threads[i], NULL);
+}
+
+#endif  // _DB_UTILS_CPU_AFFINITY_H_
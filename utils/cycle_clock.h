@@ -0,0 +1,51 @@
+/// @file
+///
+/// Cheap monotonic clock for timing short intervals on hot paths, where a
+/// gettimeofday() per measurement (as in GetTime()) would cost more than what
+/// is being measured.
+
+#ifndef _DB_UTILS_CYCLE_CLOCK_H_
+#define _DB_UTILS_CYCLE_CLOCK_H_
+
+#include <stdint.h>
+#include <time.h>
+
+/// Returns a tick count that never goes backwards. On x86 this is the time
+/// stamp counter, which modern CPUs advance at a constant rate, in sync
+/// across cores; elsewhere it is CLOCK_MONOTONIC in nanoseconds.
+static inline uint64_t CycleClock() {
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return (static_cast<uint64_t>(hi) << 32) | lo;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+#endif
+}
+
+/// Measures how many nanoseconds a CycleClock() tick takes, over about 10ms.
+static inline double MeasureNanosPerCycle() {
+#if defined(__x86_64__) || defined(__i386__)
+  struct timespec start, now;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  uint64_t start_cycles = CycleClock();
+  double elapsed;
+  do {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (now.tv_sec - start.tv_sec) * 1e9 + (now.tv_nsec - start.tv_nsec);
+  } while (elapsed < 1e7);
+  return elapsed / (CycleClock() - start_cycles);
+#else
+  return 1;
+#endif
+}
+
+/// Nanoseconds per CycleClock() tick, measured on the first call.
+inline double NanosPerCycle() {
+  static double nanos_per_cycle = MeasureNanosPerCycle();
+  return nanos_per_cycle;
+}
+
+#endif  // _DB_UTILS_CYCLE_CLOCK_H_
@@ -0,0 +1,95 @@
+/// @file
+///
+/// @class Histogram
+///
+/// Fixed-size histogram of non-negative integers, laid out like
+/// HdrHistogram: values below 2^HISTOGRAM_SUB_BUCKET_BITS get a bucket each,
+/// and every larger power of two is split into 2^HISTOGRAM_SUB_BUCKET_BITS
+/// equal buckets. Recording is a few instructions and never allocates, and
+/// every percentile is reported to within 1/2^HISTOGRAM_SUB_BUCKET_BITS
+/// (about 3%) of the true value. Not thread-safe; keep one per thread and
+/// Merge() them to read them.
+
+#ifndef _DB_UTILS_HISTOGRAM_H_
+#define _DB_UTILS_HISTOGRAM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define HISTOGRAM_SUB_BUCKET_BITS 5
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKETS ((65 - HISTOGRAM_SUB_BUCKET_BITS) * HISTOGRAM_SUB_BUCKETS)
+
+class Histogram {
+ public:
+  Histogram() { Clear(); }
+
+  inline void Record(uint64_t value) {
+    counts_[BucketOf(value)]++;
+    count_++;
+    if (value > max_)
+      max_ = value;
+  }
+
+  /// Adds every value recorded in 'other' to this histogram.
+  void Merge(const Histogram& other) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+      counts_[i] += other.counts_[i];
+    count_ += other.count_;
+    if (other.max_ > max_)
+      max_ = other.max_;
+  }
+
+  void Clear() {
+    memset(counts_, 0, sizeof(counts_));
+    count_ = 0;
+    max_ = 0;
+  }
+
+  uint64_t Count() const { return count_; }
+  uint64_t Max() const { return max_; }
+
+  /// Returns the smallest value v such that a fraction 'p' (in [0, 1]) of
+  /// the recorded values is at most v, rounded up to the end of its bucket.
+  /// Returns 0 if nothing has been recorded.
+  uint64_t Percentile(double p) const {
+    uint64_t rank = static_cast<uint64_t>(p * count_ + 0.5);
+    if (rank < 1)
+      rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS && count_ > 0; i++) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        uint64_t end = BucketEnd(i);
+        return end < max_ ? end : max_;
+      }
+    }
+    return max_;
+  }
+
+ private:
+  static inline int BucketOf(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS)
+      return value;
+    // 'exponent' is the position of the top bit, and the bucket within its
+    // power of two is given by the HISTOGRAM_SUB_BUCKET_BITS bits below it.
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - HISTOGRAM_SUB_BUCKET_BITS;
+    return shift * HISTOGRAM_SUB_BUCKETS + (value >> shift);
+  }
+
+  // Returns the largest value that falls in bucket 'bucket'.
+  static inline uint64_t BucketEnd(int bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS)
+      return bucket;
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t top = bucket % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS;
+    return ((top + 1) << shift) - 1;
+  }
+
+  uint64_t counts_[HISTOGRAM_BUCKETS];
+  uint64_t count_;
+  uint64_t max_;
+};
+
+#endif  // _DB_UTILS_HISTOGRAM_H_
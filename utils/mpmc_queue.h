@@ -0,0 +1,210 @@
+/// @file
+///
+/// Lock-free replacement for AtomicQueue on hot paths. Run bin/queue_bench to
+/// compare the two with 1-16 producers and consumers.
+
+#ifndef _DB_UTILS_MPMC_QUEUE_H_
+#define _DB_UTILS_MPMC_QUEUE_H_
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <queue>
+
+#include "utils/mutex.h"
+
+using std::queue;
+
+/// @class MPMCQueue<T>
+///
+/// Multi-producer multi-consumer queue with the same interface as
+/// AtomicQueue<T>, implemented as Dmitry Vyukov's bounded lock-free ring
+/// buffer: every slot carries a sequence number telling producers and
+/// consumers whose turn it is, so Push and Pop each cost a single CAS on
+/// the shared head or tail index.
+///
+/// Push never fails. If the ring is full, items spill into a mutex-guarded
+/// overflow queue, and new items keep going there until consumers have
+/// drained it, so items are still handed out in (roughly) FIFO order. The
+/// overflow keeps producers that also consume (e.g. the scheduler thread
+/// restarting txns) from deadlocking on a full ring.
+///
+/// T must be a trivially copyable type (pointers, ints, ...).
+template<typename T>
+class MPMCQueue {
+ public:
+  // 'capacity' is rounded up to a power of two.
+  explicit MPMCQueue(size_t capacity = 1 << 16)
+      : enqueue_pos_(0), dequeue_pos_(0), overflow_size_(0) {
+    size_t size = 2;
+    while (size < capacity)
+      size *= 2;
+    mask_ = size - 1;
+    cells_ = new Cell[size];
+    for (size_t i = 0; i < size; i++)
+      cells_[i].sequence_.store(i, std::memory_order_relaxed);
+  }
+
+  ~MPMCQueue() {
+    delete[] cells_;
+  }
+
+  // Returns the number of elements currently in the queue (approximate when
+  // other threads are pushing or popping).
+  int Size() {
+    size_t enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+    int size = enqueued > dequeued ? enqueued - dequeued : 0;
+    return size + overflow_size_.load(std::memory_order_relaxed);
+  }
+
+  // Atomically pushes 'item' onto the queue.
+  void Push(const T& item) {
+    if (overflow_size_.load(std::memory_order_acquire) == 0 &&
+        RingPush(item, true)) {
+      return;
+    }
+
+    overflow_mutex_.Lock();
+    overflow_.push(item);
+    overflow_size_.fetch_add(1, std::memory_order_release);
+    overflow_mutex_.Unlock();
+  }
+
+  // If the queue is non-empty, (atomically) sets '*result' equal to the front
+  // element, pops the front element from the queue, and returns true,
+  // otherwise returns false.
+  bool Pop(T* result) {
+    if (RingPop(result, true))
+      return true;
+    if (overflow_size_.load(std::memory_order_acquire) == 0)
+      return false;
+
+    overflow_mutex_.Lock();
+    bool popped = OverflowPop(result);
+    overflow_mutex_.Unlock();
+    return popped;
+  }
+
+  // Makes a single attempt to push 'item' into the ring. Returns false if the
+  // ring is full, another producer won the race for the slot, or items are
+  // waiting in the overflow queue.
+  bool PushNonBlocking(const T& item) {
+    if (overflow_size_.load(std::memory_order_acquire) != 0)
+      return false;
+    return RingPush(item, false);
+  }
+
+  // Makes a single attempt to pop an element. Returns false if the queue is
+  // empty or another thread got in the way.
+  bool PopNonBlocking(T* result) {
+    if (RingPop(result, false))
+      return true;
+    if (overflow_size_.load(std::memory_order_acquire) == 0 ||
+        !overflow_mutex_.TryLock()) {
+      return false;
+    }
+
+    bool popped = OverflowPop(result);
+    overflow_mutex_.Unlock();
+    return popped;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence_;
+    T data_;
+  };
+
+  // Claims the slot at enqueue_pos_ and fills it. If 'retry' is false, gives
+  // up as soon as another producer wins the CAS.
+  bool RingPush(const T& item, bool retry) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence_.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+          break;
+        if (!retry)
+          return false;
+      } else if (diff < 0) {
+        // Ring is full.
+        return false;
+      } else {
+        if (!retry)
+          return false;
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data_ = item;
+    cell->sequence_.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Claims the slot at dequeue_pos_ and empties it. If 'retry' is false,
+  // gives up as soon as another consumer wins the CAS.
+  bool RingPop(T* result, bool retry) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence_.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+          break;
+        if (!retry)
+          return false;
+      } else if (diff < 0) {
+        // Ring is empty.
+        return false;
+      } else {
+        if (!retry)
+          return false;
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    *result = cell->data_;
+    cell->sequence_.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Requires: overflow_mutex_ is held.
+  bool OverflowPop(T* result) {
+    if (overflow_.empty())
+      return false;
+    *result = overflow_.front();
+    overflow_.pop();
+    overflow_size_.fetch_sub(1, std::memory_order_release);
+    return true;
+  }
+
+  // Producer and consumer indexes live on separate cache lines.
+  char pad0_[64];
+  std::atomic<size_t> enqueue_pos_;
+  char pad1_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> dequeue_pos_;
+  char pad2_[64 - sizeof(std::atomic<size_t>)];
+
+  Cell* cells_;
+  size_t mask_;
+
+  // Items that did not fit in the ring.
+  std::atomic<int> overflow_size_;
+  queue<T> overflow_;
+  Mutex overflow_mutex_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  MPMCQueue(const MPMCQueue&);
+  MPMCQueue& operator=(const MPMCQueue&);
+};
+
+#endif  // _DB_UTILS_MPMC_QUEUE_H_
@@ -0,0 +1,79 @@
+/// @file
+///
+/// Slab allocator for small fixed-size objects that are created and
+/// destroyed at a high rate (e.g. lock requests).
+
+#ifndef _DB_UTILS_OBJECT_POOL_H_
+#define _DB_UTILS_OBJECT_POOL_H_
+
+#include <stdlib.h>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+using std::vector;
+
+/// @class ObjectPool<T>
+///
+/// Hands out objects carved from slabs of 'slab_size' objects each. Deleted
+/// objects go onto a free list and are reused by later calls to New(), so
+/// after warm-up no calls reach malloc. Slabs are only returned when the pool
+/// is destroyed.
+///
+/// Not thread-safe: callers sharing a pool must serialize access to it.
+template<typename T>
+class ObjectPool {
+ public:
+  explicit ObjectPool(int slab_size = 1024)
+      : slab_size_(slab_size), free_(NULL) {}
+
+  // Objects still live when the pool is destroyed are freed without running
+  // their destructors.
+  ~ObjectPool() {
+    for (size_t i = 0; i < slabs_.size(); i++)
+      delete[] slabs_[i];
+  }
+
+  // Returns a default-constructed object.
+  T* New() {
+    if (free_ == NULL)
+      NewSlab();
+    Slot* slot = free_;
+    free_ = slot->next_;
+    return new (&slot->storage_) T();
+  }
+
+  // Destroys 'object', which must have come from New() on this pool.
+  void Delete(T* object) {
+    object->~T();
+    Slot* slot = reinterpret_cast<Slot*>(object);
+    slot->next_ = free_;
+    free_ = slot;
+  }
+
+ private:
+  union Slot {
+    Slot* next_;  // Next free slot, while the slot is free
+    typename std::aligned_storage<sizeof(T),
+                                  std::alignment_of<T>::value>::type storage_;
+  };
+
+  void NewSlab() {
+    Slot* slab = new Slot[slab_size_];
+    slabs_.push_back(slab);
+    for (int i = 0; i < slab_size_; i++) {
+      slab[i].next_ = free_;
+      free_ = &slab[i];
+    }
+  }
+
+  int slab_size_;
+  vector<Slot*> slabs_;
+  Slot* free_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  ObjectPool(const ObjectPool&);
+  ObjectPool& operator=(const ObjectPool&);
+};
+
+#endif  // _DB_UTILS_OBJECT_POOL_H_
@@ -0,0 +1,103 @@
+/// @file
+///
+/// Microbenchmark comparing AtomicQueue<T> and MPMCQueue<T> under 1-16
+/// concurrent producers and as many consumers. Each producer pushes its share
+/// of ITEM_COUNT items while the consumers pop until all of them have been
+/// seen. Prints the average cost of one push+pop pair.
+///
+/// Usage: bin/queue_bench [item_count]
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <atomic>
+
+#include "utils/atomic.h"
+#include "utils/mpmc_queue.h"
+
+#define ITEM_COUNT 1000000
+
+static double Now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec/1e6;
+}
+
+template<typename Q>
+struct Bench {
+  Q* queue;
+  int items_per_producer;
+  std::atomic<long> consumed;
+  std::atomic<long> checksum;
+  long total;
+};
+
+template<typename Q>
+static void* Produce(void* arg) {
+  Bench<Q>* bench = reinterpret_cast<Bench<Q>*>(arg);
+  for (long i = 1; i <= bench->items_per_producer; i++)
+    bench->queue->Push(i);
+  return NULL;
+}
+
+template<typename Q>
+static void* Consume(void* arg) {
+  Bench<Q>* bench = reinterpret_cast<Bench<Q>*>(arg);
+  long item;
+  long sum = 0;
+  while (bench->consumed.load(std::memory_order_relaxed) < bench->total) {
+    if (bench->queue->Pop(&item)) {
+      sum += item;
+      bench->consumed.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  bench->checksum.fetch_add(sum);
+  return NULL;
+}
+
+// Returns nanoseconds per item, or -1 if items were lost.
+template<typename Q>
+static double Run(int threads, int item_count) {
+  Q queue;
+  Bench<Q> bench;
+  bench.queue = &queue;
+  bench.items_per_producer = item_count / threads;
+  bench.consumed = 0;
+  bench.checksum = 0;
+  bench.total = static_cast<long>(bench.items_per_producer) * threads;
+
+  pthread_t producers[threads];
+  pthread_t consumers[threads];
+  double start = Now();
+  for (int i = 0; i < threads; i++) {
+    pthread_create(&consumers[i], NULL, Consume<Q>, &bench);
+    pthread_create(&producers[i], NULL, Produce<Q>, &bench);
+  }
+  for (int i = 0; i < threads; i++) {
+    pthread_join(producers[i], NULL);
+    pthread_join(consumers[i], NULL);
+  }
+  double end = Now();
+
+  long n = bench.items_per_producer;
+  if (bench.checksum != threads * n * (n + 1) / 2)
+    return -1;
+  return (end - start) * 1e9 / bench.total;
+}
+
+int main(int argc, char** argv) {
+  int item_count = argc > 1 ? atoi(argv[1]) : ITEM_COUNT;
+
+  printf("threads\tAtomicQueue(ns)\tMPMCQueue(ns)\n");
+  for (int threads = 1; threads <= 16; threads *= 2) {
+    double locked = Run<AtomicQueue<long> >(threads, item_count);
+    double lock_free = Run<MPMCQueue<long> >(threads, item_count);
+    printf("%d\t%.1f\t\t%.1f\n", threads, locked, lock_free);
+    if (locked < 0 || lock_free < 0) {
+      printf("Items lost!\n");
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,76 @@
+/// @file
+///
+/// Fast pseudo-random numbers for load generation and task placement.
+/// rand() serializes every caller on a lock inside libc, so with several
+/// threads drawing keys it becomes the bottleneck; each thread gets a
+/// generator of its own here instead.
+
+#ifndef _DB_UTILS_RANDOM_H_
+#define _DB_UTILS_RANDOM_H_
+
+#include <stdint.h>
+#include <atomic>
+
+/// @class Random
+///
+/// xoshiro256** generator (Blackman and Vigna), seeded through splitmix64.
+/// Not thread-safe; use ThreadRandom() to get one per thread.
+class Random {
+ public:
+  explicit Random(uint64_t seed) { Seed(seed); }
+
+  void Seed(uint64_t seed) {
+    for (int i = 0; i < 4; i++)
+      s_[i] = SplitMix64(&seed);
+  }
+
+  /// Returns 64 random bits.
+  inline uint64_t Next() {
+    uint64_t result = Rotl(s_[1] * 5, 7) * 9;
+    uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = Rotl(s_[3], 45);
+    return result;
+  }
+
+  /// Returns a number in [0, n), for n > 0, by Lemire's multiply-and-shift
+  /// (no division, and a bias below n / 2^64).
+  inline uint64_t Uniform(uint64_t n) {
+    return (static_cast<unsigned __int128>(Next()) * n) >> 64;
+  }
+
+  /// Returns a double in [0, 1).
+  inline double NextDouble() {
+    return (Next() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  /// Returns one output of splitmix64 and advances '*state'.
+  static inline uint64_t SplitMix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+ private:
+  static inline uint64_t Rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  uint64_t s_[4];
+};
+
+/// Returns the calling thread's generator. Threads are seeded in the order
+/// in which they first call this, so runs are repeatable as far as thread
+/// scheduling allows.
+inline Random* ThreadRandom() {
+  static std::atomic<uint64_t> next_seed(1);
+  static thread_local Random random(next_seed.fetch_add(1));
+  return &random;
+}
+
+#endif  // _DB_UTILS_RANDOM_H_
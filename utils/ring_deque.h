@@ -0,0 +1,88 @@
+/// @file
+///
+/// Double-ended queue in a single circular buffer, for queues that txns keep
+/// passing through. Unlike std::deque, which allocates and frees a block
+/// every few dozen elements as they move through it, RingDeque only
+/// allocates when it grows past its largest size so far.
+
+#ifndef _DB_UTILS_RING_DEQUE_H_
+#define _DB_UTILS_RING_DEQUE_H_
+
+#include <assert.h>
+#include <stddef.h>
+
+/// @class RingDeque<T>
+///
+/// Minimal deque whose capacity is a power of two, doubled when it is full
+/// and never shrunk. T must be default constructible and copy assignable.
+/// Not thread-safe.
+template<typename T>
+class RingDeque {
+ public:
+  RingDeque() : data_(NULL), capacity_(0), begin_(0), size_(0) {}
+  ~RingDeque() { delete[] data_; }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Returns the i-th element, counting from the front.
+  T& operator[](size_t i) { return data_[(begin_ + i) & (capacity_ - 1)]; }
+  const T& operator[](size_t i) const {
+    return data_[(begin_ + i) & (capacity_ - 1)];
+  }
+  T& at(size_t i) {
+    assert(i < size_);
+    return (*this)[i];
+  }
+
+  T& front() { return (*this)[0]; }
+  T& back() { return (*this)[size_ - 1]; }
+
+  void push_back(const T& value) {
+    if (size_ == capacity_)
+      _grow();
+    (*this)[size_++] = value;
+  }
+
+  void pop_front() {
+    assert(size_ > 0);
+    begin_ = (begin_ + 1) & (capacity_ - 1);
+    size_--;
+  }
+
+  void pop_back() {
+    assert(size_ > 0);
+    size_--;
+  }
+
+  // Keeps the buffer for reuse.
+  void clear() {
+    begin_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  // Doubles the capacity (to 16 at first), moving the elements to the
+  // front of the new buffer.
+  void _grow() {
+    size_t capacity = capacity_ == 0 ? 16 : 2 * capacity_;
+    T* data = new T[capacity];
+    for (size_t i = 0; i < size_; i++)
+      data[i] = (*this)[i];
+    delete[] data_;
+    data_ = data;
+    capacity_ = capacity;
+    begin_ = 0;
+  }
+
+  T* data_;
+  size_t capacity_;
+  size_t begin_;  // Index of the front element
+  size_t size_;
+
+  // DISALLOW_COPY_AND_ASSIGN
+  RingDeque(const RingDeque&);
+  RingDeque& operator=(const RingDeque&);
+};
+
+#endif  // _DB_UTILS_RING_DEQUE_H_
@@ -0,0 +1,227 @@
+/// @file
+///
+/// Contiguous containers with inline storage for small element counts, for
+/// per-txn data such as read and write sets. Up to N elements live inside the
+/// container itself; only larger ones touch the heap.
+
+#ifndef _DB_UTILS_SMALL_VECTOR_H_
+#define _DB_UTILS_SMALL_VECTOR_H_
+
+#include <assert.h>
+#include <algorithm>
+#include <utility>
+
+using std::pair;
+
+/// @class SmallVector<T, N>
+///
+/// Minimal vector keeping its first N elements inline. T must be default
+/// constructible and copy assignable.
+template<typename T, int N>
+class SmallVector {
+ public:
+  typedef T* iterator;
+  typedef const T* const_iterator;
+
+  SmallVector() : data_(inline_), size_(0), capacity_(N) {}
+
+  SmallVector(const SmallVector& other)
+      : data_(inline_), size_(0), capacity_(N) {
+    *this = other;
+  }
+
+  ~SmallVector() {
+    if (data_ != inline_)
+      delete[] data_;
+  }
+
+  SmallVector& operator=(const SmallVector& other) {
+    if (this != &other) {
+      size_ = 0;
+      reserve(other.size_);
+      std::copy(other.data_, other.data_ + other.size_, data_);
+      size_ = other.size_;
+    }
+    return *this;
+  }
+
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  iterator begin() { return data_; }
+  iterator end() { return data_ + size_; }
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+
+  T& operator[](int i) { return data_[i]; }
+  const T& operator[](int i) const { return data_[i]; }
+  T& back() { return data_[size_ - 1]; }
+  const T& back() const { return data_[size_ - 1]; }
+
+  // Keeps any heap storage for reuse.
+  void clear() { size_ = 0; }
+
+  void reserve(int capacity) {
+    if (capacity <= capacity_)
+      return;
+    int new_capacity = std::max(capacity, 2 * capacity_);
+    T* data = new T[new_capacity];
+    std::copy(data_, data_ + size_, data);
+    if (data_ != inline_)
+      delete[] data_;
+    data_ = data;
+    capacity_ = new_capacity;
+  }
+
+  void push_back(const T& value) {
+    if (size_ == capacity_)
+      reserve(size_ + 1);
+    data_[size_++] = value;
+  }
+
+  // Inserts 'value' before 'pos' and returns an iterator to it.
+  iterator insert(iterator pos, const T& value) {
+    int index = pos - data_;
+    if (size_ == capacity_)
+      reserve(size_ + 1);
+    std::copy_backward(data_ + index, data_ + size_, data_ + size_ + 1);
+    data_[index] = value;
+    size_++;
+    return data_ + index;
+  }
+
+  void erase(iterator pos) {
+    std::copy(pos + 1, data_ + size_, pos);
+    size_--;
+  }
+
+ private:
+  T* data_;
+  int size_;
+  int capacity_;
+  T inline_[N];
+};
+
+/// @class SmallSet<T, N>
+///
+/// Sorted SmallVector with the subset of std::set's interface used for read
+/// and write sets. Iteration is in ascending order over contiguous memory.
+template<typename T, int N>
+class SmallSet {
+ public:
+  typedef const T* iterator;
+  typedef const T* const_iterator;
+
+  SmallSet() {}
+
+  // Builds the set from any range, e.g. a std::set.
+  template<typename It>
+  SmallSet(It first, It last) {
+    for (; first != last; ++first)
+      insert(*first);
+  }
+
+  int size() const { return values_.size(); }
+  bool empty() const { return values_.empty(); }
+  const_iterator begin() const { return values_.begin(); }
+  const_iterator end() const { return values_.end(); }
+  void clear() { values_.clear(); }
+
+  // Returns 1 if 'value' is in the set, else 0.
+  int count(const T& value) const {
+    return std::binary_search(values_.begin(), values_.end(), value) ? 1 : 0;
+  }
+
+  const_iterator find(const T& value) const {
+    const_iterator it = std::lower_bound(values_.begin(), values_.end(), value);
+    return (it != end() && *it == value) ? it : end();
+  }
+
+  // Returns false if 'value' was already in the set. Appending in ascending
+  // order costs no search.
+  bool insert(const T& value) {
+    if (values_.empty() || values_.back() < value) {
+      values_.push_back(value);
+      return true;
+    }
+    typename SmallVector<T, N>::iterator it =
+        std::lower_bound(values_.begin(), values_.end(), value);
+    if (*it == value)
+      return false;
+    values_.insert(it, value);
+    return true;
+  }
+
+  int erase(const T& value) {
+    typename SmallVector<T, N>::iterator it =
+        std::lower_bound(values_.begin(), values_.end(), value);
+    if (it == values_.end() || *it != value)
+      return 0;
+    values_.erase(it);
+    return 1;
+  }
+
+ private:
+  SmallVector<T, N> values_;
+};
+
+/// @class SmallMap<K, V, N>
+///
+/// Sorted SmallVector of key-value pairs with the subset of std::map's
+/// interface used for txn reads and writes. Values are stored next to their
+/// keys, and iterators point at pair<K, V>.
+template<typename K, typename V, int N>
+class SmallMap {
+ public:
+  typedef pair<K, V>* iterator;
+  typedef const pair<K, V>* const_iterator;
+
+  int size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  iterator begin() { return entries_.begin(); }
+  iterator end() { return entries_.end(); }
+  const_iterator begin() const { return entries_.begin(); }
+  const_iterator end() const { return entries_.end(); }
+  void clear() { entries_.clear(); }
+
+  iterator find(const K& key) {
+    iterator it = LowerBound(key);
+    return (it != end() && it->first == key) ? it : end();
+  }
+
+  const_iterator find(const K& key) const {
+    return const_cast<SmallMap*>(this)->find(key);
+  }
+
+  int count(const K& key) const {
+    return find(key) != end() ? 1 : 0;
+  }
+
+  // Returns the value of 'key', inserting a default-constructed one if the
+  // key is not in the map yet.
+  V& operator[](const K& key) {
+    if (entries_.empty() || entries_.back().first < key) {
+      entries_.push_back(pair<K, V>(key, V()));
+      return entries_.back().second;
+    }
+    iterator it = LowerBound(key);
+    if (it->first != key)
+      it = entries_.insert(it, pair<K, V>(key, V()));
+    return it->second;
+  }
+
+ private:
+  struct KeyLess {
+    bool operator()(const pair<K, V>& entry, const K& key) const {
+      return entry.first < key;
+    }
+  };
+
+  iterator LowerBound(const K& key) {
+    return std::lower_bound(entries_.begin(), entries_.end(), key, KeyLess());
+  }
+
+  SmallVector<pair<K, V>, N> entries_;
+};
+
+#endif  // _DB_UTILS_SMALL_VECTOR_H_
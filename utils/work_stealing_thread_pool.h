@@ -0,0 +1,210 @@
+/// @file
+///
+/// Thread pool in which every worker owns a task deque. A worker runs its
+/// own tasks newest-first (LIFO, so they are still in cache) and, when it
+/// runs out, steals the oldest task (FIFO) from another worker. Workers with
+/// nothing to do park on a condition variable and are woken as soon as a new
+/// task arrives, instead of sleeping for fixed intervals.
+
+#ifndef _DB_UTILS_WORK_STEALING_THREAD_POOL_H_
+#define _DB_UTILS_WORK_STEALING_THREAD_POOL_H_
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "utils/cpu_affinity.h"
+#include "utils/mutex.h"
+#include "utils/ring_deque.h"
+#include "utils/thread_pool.h"
+
+using std::pair;
+using std::vector;
+
+// Number of fruitless steal rounds a worker makes before parking.
+#define STEAL_ROUNDS_BEFORE_PARKING 64
+
+class WorkStealingThreadPool : public ThreadPool {
+ public:
+  // Worker i only runs on the CPUs in affinity[i]. Workers without an entry
+  // are not pinned.
+  explicit WorkStealingThreadPool(int nthreads,
+                                  const vector<cpu_set_t>& affinity = vector<cpu_set_t>())
+      : thread_count_(nthreads), affinity_(affinity), stopped_(false),
+        pending_(0), sleepers_(0), next_worker_(0) {
+    pthread_mutex_init(&park_mutex_, NULL);
+    pthread_cond_init(&park_cv_, NULL);
+    Start();
+  }
+
+  ~WorkStealingThreadPool() {
+    Stop();
+    for (int i = 0; i < thread_count_; i++)
+      delete workers_[i];
+    pthread_cond_destroy(&park_cv_);
+    pthread_mutex_destroy(&park_mutex_);
+  }
+
+  bool Active() { return !stopped_; }
+
+  // Tasks submitted by a worker of this pool go to the bottom of its own
+  // deque. Tasks from any other thread are spread round-robin.
+  virtual void RunTask(Task* task) {
+    assert(!stopped_);
+    int worker_id = CurrentWorker(this);
+    if (worker_id < 0)
+      worker_id = next_worker_.fetch_add(1, std::memory_order_relaxed) % thread_count_;
+
+    Worker* worker = workers_[worker_id];
+    worker->mutex_.Lock();
+    worker->tasks_.push_back(task);
+    worker->mutex_.Unlock();
+
+    // Wake a parked worker. Paired with the sleepers_/pending_ check in
+    // Park(), this can't miss a worker that is about to go to sleep.
+    pending_.fetch_add(1);
+    if (sleepers_.load() > 0) {
+      pthread_mutex_lock(&park_mutex_);
+      pthread_cond_signal(&park_cv_);
+      pthread_mutex_unlock(&park_mutex_);
+    }
+  }
+
+  virtual int ThreadCount() { return thread_count_; }
+
+  // Runs every task already handed to the pool, then stops all threads.
+  // Further calls have no effect.
+  virtual void Stop() {
+    if (stopped_)
+      return;
+    pthread_mutex_lock(&park_mutex_);
+    stopped_ = true;
+    pthread_cond_broadcast(&park_cv_);
+    pthread_mutex_unlock(&park_mutex_);
+    for (int i = 0; i < thread_count_; i++)
+      pthread_join(workers_[i]->thread_, NULL);
+  }
+
+ private:
+  struct Worker {
+    Mutex mutex_;             // Guards 'tasks_'
+    RingDeque<Task*> tasks_;  // Owner pops from the back, thieves the front
+    pthread_t thread_;
+    char padding_[64];        // Keep workers' deques on separate cache lines
+  };
+
+  void Start() {
+    workers_.resize(thread_count_);
+    for (int i = 0; i < thread_count_; i++)
+      workers_[i] = new Worker();
+    for (int i = 0; i < thread_count_; i++) {
+      CreatePinnedThread(&workers_[i]->thread_,
+                         i < static_cast<int>(affinity_.size()) ? &affinity_[i] : NULL,
+                         RunThread,
+                         reinterpret_cast<void*>(new pair<int, WorkStealingThreadPool*>(i, this)));
+    }
+  }
+
+  // Returns the id of the calling worker thread in 'tp', or -1 if the caller
+  // is not one of tp's workers.
+  static int CurrentWorker(WorkStealingThreadPool* tp, int set_id = -2) {
+    static thread_local WorkStealingThreadPool* pool = NULL;
+    static thread_local int id = -1;
+    if (set_id != -2) {
+      pool = tp;
+      id = set_id;
+    }
+    return pool == tp ? id : -1;
+  }
+
+  // Pops the newest task of worker 'id'.
+  bool PopLocal(int id, Task** task) {
+    Worker* worker = workers_[id];
+    worker->mutex_.Lock();
+    bool found = !worker->tasks_.empty();
+    if (found) {
+      *task = worker->tasks_.back();
+      worker->tasks_.pop_back();
+    }
+    worker->mutex_.Unlock();
+    return found;
+  }
+
+  // Steals the oldest task of some other worker, starting with the one after
+  // 'id'. Skips victims whose deque is busy.
+  bool Steal(int id, Task** task) {
+    for (int i = 1; i < thread_count_; i++) {
+      Worker* victim = workers_[(id + i) % thread_count_];
+      if (!victim->mutex_.TryLock())
+        continue;
+      bool found = !victim->tasks_.empty();
+      if (found) {
+        *task = victim->tasks_.front();
+        victim->tasks_.pop_front();
+      }
+      victim->mutex_.Unlock();
+      if (found)
+        return true;
+    }
+    return false;
+  }
+
+  // Sleeps until a task is pending or the pool is stopped.
+  void Park() {
+    pthread_mutex_lock(&park_mutex_);
+    sleepers_.fetch_add(1);
+    while (pending_.load() == 0 && !stopped_)
+      pthread_cond_wait(&park_cv_, &park_mutex_);
+    sleepers_.fetch_sub(1);
+    pthread_mutex_unlock(&park_mutex_);
+  }
+
+  // Function executed by each pthread.
+  static void* RunThread(void* arg) {
+    int id = reinterpret_cast<pair<int, WorkStealingThreadPool*>*>(arg)->first;
+    WorkStealingThreadPool* tp =
+        reinterpret_cast<pair<int, WorkStealingThreadPool*>*>(arg)->second;
+    delete reinterpret_cast<pair<int, WorkStealingThreadPool*>*>(arg);
+    CurrentWorker(tp, id);
+
+    Task* task;
+    int idle_rounds = 0;
+    while (true) {
+      if (tp->PopLocal(id, &task) || tp->Steal(id, &task)) {
+        tp->pending_.fetch_sub(1);
+        Task::Execute(task);
+        idle_rounds = 0;
+      } else if (tp->stopped_ && tp->pending_.load() == 0) {
+        // Every task handed to the pool has been run.
+        break;
+      } else if (++idle_rounds < STEAL_ROUNDS_BEFORE_PARKING) {
+        sched_yield();
+      } else {
+        tp->Park();
+        idle_rounds = 0;
+      }
+    }
+    return NULL;
+  }
+
+  int thread_count_;
+  vector<cpu_set_t> affinity_;
+  vector<Worker*> workers_;
+
+  std::atomic<bool> stopped_;
+
+  // Number of tasks in all deques, and number of parked workers.
+  std::atomic<int> pending_;
+  std::atomic<int> sleepers_;
+
+  // Target of the next task submitted from outside the pool.
+  std::atomic<unsigned> next_worker_;
+
+  pthread_mutex_t park_mutex_;
+  pthread_cond_t park_cv_;
+};
+
+#endif  // _DB_UTILS_WORK_STEALING_THREAD_POOL_H_